@@ -1,6 +1,6 @@
 #include "config.h"
 #include "src/bikeCounter/bikeCounter.hpp"
-#include "src/hal/hal_arduino.hpp"
+#include "src/HAL/hal_arduino.hpp"
 
 BikeCounter *bc = BikeCounter::getInstance();
 HAL *hal = HAL_Arduino::getInstance();
@@ -18,6 +18,8 @@ void setup()
   bc->setLedPin(LED_BUILTIN);
   bc->setMaxBlinks(50);
   bc->setMaxCount(1000);
+  bc->setPayloadFormat(DataPackage::PayloadFormat::smallest);
+  bc->setAdaptiveInterval(true, 8); // reporting interval from the traffic profile (max. 8h latency)
 
   bc->loop();
 }
@@ -27,5 +29,4 @@ void setup()
 void loop()
 {
   bc->loop();
-  delay(50);
 }
\ No newline at end of file
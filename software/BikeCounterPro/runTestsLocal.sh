@@ -2,6 +2,6 @@
 
 BUILD_PATH="./build"
 
-cmake -S "./src/timerSchedule" -B $BUILD_PATH
+cmake -S "." -B $BUILD_PATH
 cmake --build $BUILD_PATH
-cd $BUILD_PATH && ctest --rerun-failed --output-on-failure
\ No newline at end of file
+cd $BUILD_PATH && ctest --rerun-failed --output-on-failure
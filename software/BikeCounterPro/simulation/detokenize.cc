@@ -0,0 +1,127 @@
+// Turns a binary trace of tokenized log messages back into text.
+//
+// usage: detokenize [options] [trace file]
+//   --source <file>        adds the format strings of the LOG_ macros in the source file to the token table
+//   --table <file>         reads a token table written by --write-table
+//   --write-table <file>   writes the token table ("<token in hex> <format>" per line)
+//
+// Trace file: sequence of records "length byte, level, token, arguments" (see src/statusLogger/traceRecord.hpp)
+// as written to the serial port by a BIKECOUNTER_LOG_TOKENIZED firmware or by StatusLogger::dumpTrace().
+// The text output which follows the dump (debug and config switch set) has to be removed.
+//
+// Output: one line per record "<level> <message>".
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/statusLogger/traceDecoder.hpp"
+
+namespace
+{
+    bool readFile(const char *path, std::string *content)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            fprintf(stderr, "can not open %s\n", path);
+            return false;
+        }
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        *content = ss.str();
+        return true;
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "usage: detokenize [--source <file>]... [--table <file>] [--write-table <file>] [trace file]\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    TraceDecoder decoder;
+    const char *tracePath = nullptr;
+    const char *tablePath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--source") && i + 1 < argc)
+        {
+            std::string source;
+            if (!readFile(argv[++i], &source))
+            {
+                return 1;
+            }
+            decoder.addSource(source);
+        }
+        else if (!strcmp(argv[i], "--table") && i + 1 < argc)
+        {
+            std::ifstream in(argv[++i]);
+            if (!in)
+            {
+                fprintf(stderr, "can not open %s\n", argv[i]);
+                return 1;
+            }
+            decoder.readTable(in);
+        }
+        else if (!strcmp(argv[i], "--write-table") && i + 1 < argc)
+        {
+            tablePath = argv[++i];
+        }
+        else if (argv[i][0] != '-' && tracePath == nullptr)
+        {
+            tracePath = argv[i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (tablePath)
+    {
+        std::ofstream out(tablePath);
+        if (!out)
+        {
+            fprintf(stderr, "can not write %s\n", tablePath);
+            return 1;
+        }
+        decoder.writeTable(out);
+    }
+    if (tracePath == nullptr)
+    {
+        if (tablePath == nullptr)
+        {
+            usage();
+            return 1;
+        }
+        return 0;
+    }
+
+    std::string trace;
+    if (!readFile(tracePath, &trace))
+    {
+        return 1;
+    }
+    const uint8_t *data = (const uint8_t *)trace.data();
+    size_t position = 0;
+    while (position < trace.size())
+    {
+        size_t length = data[position];
+        if (position + 1 + length > trace.size())
+        {
+            fprintf(stderr, "incomplete record at offset %zu\n", position);
+            return 1;
+        }
+        StatusLogger::Level level = StatusLogger::Level::info;
+        std::string text = decoder.decode(data + position + 1, length, &level);
+        printf("%-8s%s\n", TraceDecoder::getLevelName(level), text.c_str());
+        position += 1 + length;
+    }
+    return 0;
+}
@@ -0,0 +1,380 @@
+// Replays a recorded PIR trace through the firmware state machine on the simulated HAL.
+//
+// usage: replay [options] <trace file>
+//   --binary          trace is a sequence of little-endian uint32 epochs (default: csv)
+//   --start <epoch>   simulation start (default: midnight one day before the first trigger)
+//   --end <epoch>     simulation end (default: midnight one day after the last trigger)
+//   --format <name>   payload format: fixed, delta, histogram or smallest (default: fixed)
+//   --dr <n>          data rate the ADR of the network assigns (0 - 7, default: no data rate model)
+//   --quiet           only print the summary
+//
+// CSV trace: one trigger per line "timestamp[,count]". The timestamp is either an epoch in seconds
+// or an ISO 8601 UTC time as exported from Firestore (e.g. 2023-06-18T10:15:00.000Z). A count > 1
+// (the Firestore documents aggregate per minute) is spread evenly over the following minute.
+// Lines which can not be parsed (header, comments) are skipped.
+//
+// Output: one line per uplink with the real time, device time, send reason and the payload bytes
+// exactly as DataPackage::encodePayload() produced them, followed by a summary (lost triggers, send
+// reasons, airtime, energy).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/HAL/sim_hal.hpp"
+#include "../src/HAL/energy_hal.hpp"
+#include "../src/bikeCounter/bikeCounter.hpp"
+
+namespace
+{
+    // pin configuration of BikeCounterPro.ino (LED_BUILTIN = 6, A0 = 15)
+    const int interruptPin = 0;
+    const int pirPowerPin = 3;
+    const int ledPin = 6;
+    const int batteryPin = 15;
+    // longest interval of an interval id (DataPackage::setTimerInterval)
+    const unsigned int intervalMinutes[5] = {60, 120, 240, 480, 1020};
+    // a delta or histogram package is full if less than this many bytes of the payload are left (DataPackage::isPayloadFull)
+    const size_t fullPackageMargin = 3;
+
+    struct Trigger
+    {
+        uint64_t epochMillis;
+    };
+
+    bool parseIsoTime(const std::string &s, uint64_t *epochMillis)
+    {
+        int y, mo, d, h, mi;
+        double sec;
+        if (sscanf(s.c_str(), "%d-%d-%dT%d:%d:%lf", &y, &mo, &d, &h, &mi, &sec) != 6)
+        {
+            return false;
+        }
+        date::sys_days day = date::year_month_day{date::year{y}, date::month{(unsigned)mo}, date::day{(unsigned)d}};
+        int64_t seconds = day.time_since_epoch().count() * 86400ll + h * 3600ll + mi * 60ll;
+        *epochMillis = (uint64_t)(seconds * 1000ll + (int64_t)(sec * 1000.0 + 0.5));
+        return true;
+    }
+
+    bool parseTimestamp(const std::string &s, uint64_t *epochMillis)
+    {
+        if (s.find('-') != std::string::npos)
+        {
+            return parseIsoTime(s, epochMillis);
+        }
+        char *end = nullptr;
+        double value = strtod(s.c_str(), &end);
+        if (end == s.c_str() || value <= 0.0)
+        {
+            return false;
+        }
+        *epochMillis = (uint64_t)(value * 1000.0 + 0.5);
+        return true;
+    }
+
+    bool readCsvTrace(const char *path, std::vector<Trigger> *triggers)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::stringstream ss(line);
+            std::string timestamp, count;
+            std::getline(ss, timestamp, ',');
+            std::getline(ss, count, ',');
+            // strip quotes and white space of spreadsheet exports
+            std::string clean;
+            for (size_t i = 0; i < timestamp.size(); ++i)
+            {
+                if (timestamp[i] != '"' && timestamp[i] != ' ' && timestamp[i] != '\r')
+                {
+                    clean += timestamp[i];
+                }
+            }
+            uint64_t t;
+            if (!parseTimestamp(clean, &t))
+            {
+                continue;
+            }
+            int n = count.empty() ? 1 : std::max(1, atoi(count.c_str()));
+            for (int i = 0; i < n; ++i)
+            {
+                triggers->push_back(Trigger{t + (uint64_t)(i * 60000 / n)});
+            }
+        }
+        return true;
+    }
+
+    bool readBinaryTrace(const char *path, std::vector<Trigger> *triggers)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        uint8_t b[4];
+        while (file.read((char *)b, 4))
+        {
+            uint32_t epoch = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+            triggers->push_back(Trigger{(uint64_t)epoch * 1000ull});
+        }
+        return true;
+    }
+
+    std::string formatTime(uint32_t epoch)
+    {
+        std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> tp{std::chrono::seconds{epoch}};
+        date::year_month_day ymd{date::floor<date::days>(tp)};
+        date::hh_mm_ss<std::chrono::seconds> hms = date::make_time(tp - date::floor<date::days>(tp));
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%04d-%02u-%02uT%02d:%02d:%02dZ", int{ymd.year()}, unsigned{ymd.month()}, unsigned{ymd.day()},
+                 (int)hms.hours().count(), (int)hms.minutes().count(), (int)hms.seconds().count());
+        return buffer;
+    }
+
+    std::string toHex(const std::vector<uint8_t> &payload)
+    {
+        std::string hex;
+        char buffer[3];
+        for (size_t i = 0; i < payload.size(); ++i)
+        {
+            snprintf(buffer, sizeof(buffer), "%02X", payload[i]);
+            hex += buffer;
+        }
+        return hex;
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "usage: replay [--binary] [--start <epoch>] [--end <epoch>] [--format fixed|delta|histogram|smallest] [--dr <n>] [--quiet] <trace file>\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool binary = false;
+    bool quiet = false;
+    DataPackage::PayloadFormat format = DataPackage::PayloadFormat::fixedBits;
+    uint32_t start = 0;
+    uint32_t end = 0;
+    int linkDataRate = -1;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--binary"))
+        {
+            binary = true;
+        }
+        else if (!strcmp(argv[i], "--format") && i + 1 < argc)
+        {
+            const char *name = argv[++i];
+            if (!strcmp(name, "delta"))
+            {
+                format = DataPackage::PayloadFormat::deltaRice;
+            }
+            else if (!strcmp(name, "histogram"))
+            {
+                format = DataPackage::PayloadFormat::histogram;
+            }
+            else if (!strcmp(name, "smallest"))
+            {
+                format = DataPackage::PayloadFormat::smallest;
+            }
+            else if (strcmp(name, "fixed"))
+            {
+                usage();
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--dr") && i + 1 < argc)
+        {
+            linkDataRate = atoi(argv[++i]);
+            if (linkDataRate < 0 || linkDataRate > 7)
+            {
+                usage();
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--quiet"))
+        {
+            quiet = true;
+        }
+        else if (!strcmp(argv[i], "--start") && i + 1 < argc)
+        {
+            start = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--end") && i + 1 < argc)
+        {
+            end = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (argv[i][0] != '-' && path == nullptr)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (path == nullptr)
+    {
+        usage();
+        return 1;
+    }
+
+    std::vector<Trigger> triggers;
+    if (!(binary ? readBinaryTrace(path, &triggers) : readCsvTrace(path, &triggers)))
+    {
+        fprintf(stderr, "could not read trace file %s\n", path);
+        return 1;
+    }
+    if (triggers.empty())
+    {
+        fprintf(stderr, "trace file %s contains no triggers\n", path);
+        return 1;
+    }
+    uint64_t first = triggers[0].epochMillis;
+    uint64_t last = triggers[0].epochMillis;
+    for (size_t i = 0; i < triggers.size(); ++i)
+    {
+        first = std::min(first, triggers[i].epochMillis);
+        last = std::max(last, triggers[i].epochMillis);
+    }
+    // start a day earlier so the device is time synced before the first trigger
+    if (start == 0)
+    {
+        start = (uint32_t)((first / 1000ull) / 86400ull * 86400ull - 86400ull);
+    }
+    if (end == 0)
+    {
+        end = (uint32_t)((last / 1000ull) / 86400ull * 86400ull + 2ull * 86400ull);
+    }
+
+    SimHAL sim(start);
+    sim.setMotionSensorPins(interruptPin, pirPowerPin);
+    sim.setAnalogInput(batteryPin, 950);
+    sim.setLinkDataRate(linkDataRate);
+    EnergyHAL hal(&sim);
+    hal.setLedPin(ledPin);
+    hal.setPirPowerPin(pirPowerPin);
+
+    uint64_t startMillis = (uint64_t)start * 1000ull;
+    for (size_t i = 0; i < triggers.size(); ++i)
+    {
+        if (triggers[i].epochMillis >= startMillis)
+        {
+            sim.injectMotionAtMillis(triggers[i].epochMillis - startMillis);
+        }
+    }
+
+    BikeCounter *bc = BikeCounter::getInstance();
+    bc->injectHal(&hal);
+    bc->reset();
+    bc->setCounterInterruptPin(interruptPin);
+    bc->setSwitchPowerPin(10);
+    bc->setDebugSwitchPin(7);
+    bc->setConfigSwitchPin(8);
+    bc->setBatteryVoltagePin(batteryPin);
+    bc->setPirPowerPin(pirPowerPin);
+    bc->setSyncTimeInterval(120ul);
+    bc->setLedPin(ledPin);
+    bc->setMaxBlinks(50);
+    bc->setMaxCount(1000);
+    bc->setPayloadFormat(format);
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    // Arduino runtime: setup() { bc->loop(); } loop() { bc->loop(); }
+    bc->loop();
+    sim.runUntil(end, [&]()
+                 {
+                     bc->loop();
+                 });
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    const std::vector<SimHAL::Uplink> &uplinks = sim.getUplinks();
+    unsigned long counted = 0;
+    unsigned long syncSends = 0;
+    unsigned long timerSends = 0;
+    unsigned long thresholdSends = 0;
+    unsigned long payloadBytes = 0;
+    if (!quiet)
+    {
+        printf("# world_time,device_time,reason,count,interval_id,bytes,payload\n");
+    }
+    for (size_t i = 0; i < uplinks.size(); ++i)
+    {
+        const SimHAL::Uplink &u = uplinks[i];
+        // the count byte of a histogram is limited to 255, the decoded bins hold the real count
+        DataPackage decoded;
+        unsigned int minutes[DataPackage::maxDeltaCount];
+        uint16_t bins[DataPackage::maxBinCount];
+        decoded.setTimeArray(minutes);
+        decoded.setBinArray(bins);
+        decoded.decodePayload(u.payload.data(), (int)u.payload.size());
+        int count = decoded.getMotionCount();
+        if (decoded.getPayloadFormat() == DataPackage::PayloadFormat::histogram)
+        {
+            count = 0;
+            for (unsigned int b = 0; b < decoded.getHistogramBinCount(); ++b)
+            {
+                count += bins[b];
+            }
+        }
+        int status = decoded.getStatus();
+        int intervalId = u.payload.size() > 4 ? (u.payload[4] & 0x07) : 0;
+        // the send threshold of the payload budget of the data rate
+        DataPackage budget;
+        budget.setPayloadSize(LoRaConnector::getMaxPayloadSize(u.dataRate));
+        const char *reason;
+        if (status == 7)
+        {
+            reason = "sync";
+            ++syncSends;
+        }
+        else if ((intervalId < 5 && count >= budget.getMaxCount(intervalMinutes[intervalId])) ||
+                 (intervalId >= 5 && u.payload.size() + fullPackageMargin >= budget.getPayloadSize()))
+        {
+            reason = "threshold";
+            ++thresholdSends;
+        }
+        else
+        {
+            reason = "timer";
+            ++timerSends;
+        }
+        counted += (status == 7) ? 0 : count;
+        payloadBytes += u.payload.size();
+        if (!quiet)
+        {
+            printf("%s,%s,%s,%d,%d,%zu,%s\n", formatTime(u.worldEpoch).c_str(), formatTime(u.deviceEpoch).c_str(), reason, count, intervalId,
+                   u.payload.size(), toHex(u.payload).c_str());
+        }
+    }
+
+    double simulatedSeconds = (double)(end - start);
+    printf("\n# summary\n");
+    printf("simulated span:        %s - %s (%.1f days, %.0fx real time)\n", formatTime(start).c_str(), formatTime(end).c_str(), simulatedSeconds / 86400.0,
+           wallSeconds > 0.0 ? simulatedSeconds / wallSeconds : 0.0);
+    printf("triggers in trace:     %zu\n", triggers.size());
+    printf("triggers dispatched:   %lu (dropped while the PIR was off: %lu)\n", sim.getDispatchedInterruptCount(), sim.getDroppedInterruptCount());
+    printf("triggers counted:      %lu (lost: %ld)\n", counted, (long)sim.getDispatchedInterruptCount() - (long)counted);
+    printf("uplinks:               %zu (sync: %lu, timer: %lu, threshold: %lu)\n", uplinks.size(), syncSends, timerSends, thresholdSends);
+    printf("payload bytes:         %lu\n", payloadBytes);
+    printf("joins:                 %lu (session resumes: %lu)\n", sim.getJoinCount(), sim.getSessionRestoreCount());
+    // time on air of the payloads at the data rate of the uplinks, the peak is the busiest sub-band in any hour
+    const AirtimeLedger &ledger = bc->getAirtimeLedger();
+    printf("airtime:               %.1f s (%.1f s/day, peak duty cycle %.3f%% of %d%%)\n", (double)sim.getAirtimeMillis() / 1000.0,
+           (double)sim.getAirtimeMillis() / 1000.0 / (simulatedSeconds / 86400.0),
+           100.0 * (double)ledger.getPeakUsage() / (AirtimeLedger::windowSeconds * 1000.0), AirtimeLedger::dutyCyclePercent);
+    printf("\n# energy\n%s", EnergyHAL::formatReport(hal.getReport()).c_str());
+    return 0;
+}
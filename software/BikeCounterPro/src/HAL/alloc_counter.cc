@@ -0,0 +1,50 @@
+#include "alloc_counter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<uint64_t> allocationCount{0};
+    std::atomic<uint64_t> allocatedByteCount{0};
+    std::atomic<uint64_t> deallocationCount{0};
+
+    void *countedAlloc(std::size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedByteCount.fetch_add(size, std::memory_order_relaxed);
+        void *ptr = std::malloc(size == 0 ? 1 : size);
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    void countedFree(void *ptr)
+    {
+        if (ptr != nullptr)
+        {
+            deallocationCount.fetch_add(1, std::memory_order_relaxed);
+            std::free(ptr);
+        }
+    }
+}
+
+uint64_t allocCounter::allocations() { return allocationCount.load(std::memory_order_relaxed); }
+uint64_t allocCounter::allocatedBytes() { return allocatedByteCount.load(std::memory_order_relaxed); }
+uint64_t allocCounter::deallocations() { return deallocationCount.load(std::memory_order_relaxed); }
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedByteCount.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { countedFree(ptr); }
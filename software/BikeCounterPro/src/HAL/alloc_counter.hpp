@@ -0,0 +1,23 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdint>
+
+/**
+ * @brief Heap allocation counter for host builds (benchmarks and tests).
+ *
+ * Linking alloc_counter.cc replaces the global operator new/delete of the executable with versions
+ * which count every call. The firmware has no heap profiler, so this is the only way to see how
+ * often a code path hits the allocator (which is slow and fragments the 32 KB RAM of the SAMD21).
+ */
+namespace allocCounter
+{
+    /// @brief number of allocations since the start of the program
+    uint64_t allocations();
+    /// @brief number of allocated bytes since the start of the program
+    uint64_t allocatedBytes();
+    /// @brief number of deallocations since the start of the program
+    uint64_t deallocations();
+}
+
+#endif // ALLOC_COUNTER_H
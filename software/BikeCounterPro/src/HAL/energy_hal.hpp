@@ -0,0 +1,374 @@
+#ifndef ENERGY_HAL_H
+#define ENERGY_HAL_H
+
+#include "hal_interface.hpp"
+#include "sim_hal.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Energy accounting layer around the HAL interface.
+ *
+ * EnergyHAL forwards every call to a SimHAL and charges current x duration for it.
+ * Calls that take time on the device (deepSleep, waitHere, LoRa join/uplink) are integrated over the
+ * virtual time they consume, instantaneous calls (sensor reads, downlink windows, ...) are charged
+ * with a fixed duration from the PowerProfile. The awake current depends on the pin outputs (LED duty
+ * cycle of analogWrite, PIR power pin) so the blinkLED patterns show up in the numbers.
+ *
+ * Every charge is booked to a category (what consumed it) and a context (why the device was awake):
+ *  - motion: awake period started by a pin interrupt (until the next deep sleep or uplink)
+ *  - uplink: from LoRaBeginPacket until the next deep sleep (includes the downlink wait)
+ *  - other:  setup, timer wake-ups, error handling
+ *  - sleep:  deep sleep
+ *
+ * This header is only used for host builds (simulation, tests and benchmarks).
+ */
+class EnergyHAL : public HAL
+{
+public:
+    /// @brief Currents (mA) and durations (ms) of the device components
+    struct PowerProfile
+    {
+        float sleepCurrent = 0.104f;    // MKR WAN 1310 in deep sleep (modem in sleep mode)
+        float mcuActiveCurrent = 12.0f; // SAMD21 @48MHz and peripherals while awake
+        float mcuIdleCurrent = 3.0f;    // SAMD21 in idle mode (clocks running) while waiting for a downlink
+        float ledCurrent = 5.0f;        // on-board LED at full brightness (scaled with the PWM value)
+        float pirCurrent = 0.1f;        // PIR sensor while powered
+        float sensorCurrent = 0.95f;    // AM2320 during a measurement
+        float sensorReadTime = 10.0f;   // duration of one AM2320 read
+        float txCurrent = 44.0f;        // modem transmitting (+14dBm)
+        float rxCurrent = 11.0f;        // modem in a receive window
+        float rxWindowTime = 400.0f;    // duration of a receive window (RX1 and RX2 after every uplink)
+        float joinTxTime = 1500.0f;     // airtime of the join request
+        float batteryCapacity = 6000.0f; // mAh (2x 18650 in parallel)
+        float usableCapacity = 0.8f;     // usable fraction of the capacity (cut-off voltage, aging, self-discharge)
+    };
+
+    enum Category
+    {
+        sleepCategory,
+        mcuCategory,
+        ledCategory,
+        pirCategory,
+        sensorCategory,
+        txCategory,
+        rxCategory,
+        categoryCount
+    };
+
+    enum Context
+    {
+        sleepContext,
+        motionContext,
+        uplinkContext,
+        otherContext,
+        contextCount
+    };
+
+    /// @brief Summary of the accounted energy
+    struct Report
+    {
+        double days;              // simulated time span
+        double totalCharge;       // uAh
+        double chargePerDay;      // uAh
+        double chargePerMotion;   // uAh per motion wake-up
+        double chargePerUplink;   // uAh per uplink
+        double awakePerMotion;    // ms awake per motion wake-up
+        double averageCurrent;    // uA
+        double batteryLifeDays;   // projected battery life
+        unsigned long motionWakeUps;
+        unsigned long uplinks;
+        unsigned long joins;
+        double categoryCharge[categoryCount]; // uAh
+        double contextCharge[contextCount];   // uAh
+    };
+
+    EnergyHAL(SimHAL *sim) : EnergyHAL(sim, PowerProfile()) {}
+    EnergyHAL(SimHAL *sim, const PowerProfile &p) : sim(sim), profile(p), startMillis(sim->now()), lastMillis(sim->now()) {}
+    virtual ~EnergyHAL() {}
+
+    /// @brief Pins which change the awake current
+    void setLedPin(int pin) { ledPin = pin; }
+    void setPirPowerPin(int pin) { pirPowerPin = pin; }
+    const PowerProfile &getProfile() const { return profile; }
+
+    /// @brief Charge (uAh) of a category or a context since the start
+    double getCharge(Category c) { settle(); return categoryCharge[c] / 3600.0; }
+    double getCharge(Context c) { settle(); return contextCharge[c] / 3600.0; }
+    double getTotalCharge()
+    {
+        settle();
+        double sum = 0.0;
+        for (int i = 0; i < categoryCount; ++i)
+        {
+            sum += categoryCharge[i];
+        }
+        return sum / 3600.0;
+    }
+
+    Report getReport()
+    {
+        Report r;
+        r.totalCharge = getTotalCharge();
+        r.days = (double)(sim->now() - startMillis) / 86400000.0;
+        r.chargePerDay = r.days > 0.0 ? r.totalCharge / r.days : 0.0;
+        r.motionWakeUps = motionWakeUps;
+        r.uplinks = uplinks;
+        r.joins = joins;
+        for (int i = 0; i < categoryCount; ++i)
+        {
+            r.categoryCharge[i] = categoryCharge[i] / 3600.0;
+        }
+        for (int i = 0; i < contextCount; ++i)
+        {
+            r.contextCharge[i] = contextCharge[i] / 3600.0;
+        }
+        r.chargePerMotion = motionWakeUps ? r.contextCharge[motionContext] / motionWakeUps : 0.0;
+        r.chargePerUplink = uplinks ? r.contextCharge[uplinkContext] / uplinks : 0.0;
+        r.awakePerMotion = motionWakeUps ? contextAwakeMillis[motionContext] / motionWakeUps : 0.0;
+        r.averageCurrent = r.days > 0.0 ? r.chargePerDay / 24.0 : 0.0;
+        r.batteryLifeDays = r.chargePerDay > 0.0 ? (profile.batteryCapacity * profile.usableCapacity * 1000.0) / r.chargePerDay : 0.0;
+        return r;
+    }
+
+    static std::string formatReport(const Report &r)
+    {
+        static const char *categoryNames[categoryCount] = {"sleep", "mcu", "led", "pir", "sensor", "tx", "rx"};
+        static const char *contextNames[contextCount] = {"sleep", "motion", "uplink", "other"};
+        std::string s;
+        s += "simulated days:        " + std::to_string(r.days) + "\n";
+        s += "total charge:          " + std::to_string(r.totalCharge) + " uAh\n";
+        s += "charge per day:        " + std::to_string(r.chargePerDay) + " uAh\n";
+        s += "charge per motion:     " + std::to_string(r.chargePerMotion) + " uAh (" + std::to_string(r.motionWakeUps) + " wake-ups)\n";
+        s += "awake per motion:      " + std::to_string(r.awakePerMotion) + " ms\n";
+        s += "charge per uplink:     " + std::to_string(r.chargePerUplink) + " uAh (" + std::to_string(r.uplinks) + " uplinks, " + std::to_string(r.joins) + " joins)\n";
+        s += "average current:       " + std::to_string(r.averageCurrent) + " uA\n";
+        s += "projected battery life: " + std::to_string(r.batteryLifeDays) + " days\n";
+        for (int i = 0; i < categoryCount; ++i)
+        {
+            s += "  category " + std::string(categoryNames[i]) + ": " + std::to_string(r.categoryCharge[i]) + " uAh\n";
+        }
+        for (int i = 0; i < contextCount; ++i)
+        {
+            s += "  context " + std::string(contextNames[i]) + ": " + std::to_string(r.contextCharge[i]) + " uAh\n";
+        }
+        return s;
+    }
+
+    virtual void rtcBegin(bool resetTime = false) { sim->rtcBegin(resetTime); }
+    virtual void rtcSetEpoch(uint32_t ts) { sim->rtcSetEpoch(ts); }
+    virtual uint32_t rtcGetEpoch() { return sim->rtcGetEpoch(); }
+    virtual uint8_t rtcGetHours() { return sim->rtcGetHours(); }
+    virtual uint8_t rtcGetMinutes() { return sim->rtcGetMinutes(); }
+    virtual uint8_t rtcGetSeconds() { return sim->rtcGetSeconds(); }
+    virtual uint8_t rtcGetDay() { return sim->rtcGetDay(); }
+    virtual uint8_t rtcGetMonth() { return sim->rtcGetMonth(); }
+    virtual uint8_t rtcGetYear() { return sim->rtcGetYear(); }
+
+    virtual void I2CInit() { sim->I2CInit(); }
+    virtual void AM2320Init() { sim->AM2320Init(); }
+    virtual float AM2320ReadTemperature()
+    {
+        chargeFixed(sensorCategory, profile.sensorCurrent, profile.sensorReadTime);
+        return sim->AM2320ReadTemperature();
+    }
+    virtual float AM2320ReadHumidity()
+    {
+        chargeFixed(sensorCategory, profile.sensorCurrent, profile.sensorReadTime);
+        return sim->AM2320ReadHumidity();
+    }
+
+    virtual bool getEuiAndKeyFromFlash(std::string *appEui, std::string *appKey) { return sim->getEuiAndKeyFromFlash(appEui, appKey); }
+    virtual bool getLocationFromFlash(float *latitude, float *longitude) { return sim->getLocationFromFlash(latitude, longitude); }
+
+    virtual bool eventLogBegin() { return sim->eventLogBegin(); }
+    virtual bool eventLogAppend(uint32_t epoch) { return sim->eventLogAppend(epoch); }
+    virtual size_t eventLogRead(size_t index, uint32_t *epochs, size_t count) { return sim->eventLogRead(index, epochs, count); }
+    virtual size_t eventLogSize() { return sim->eventLogSize(); }
+    virtual void eventLogTrim(size_t count) { sim->eventLogTrim(count); }
+
+    virtual bool traceLogBegin() { return sim->traceLogBegin(); }
+    virtual bool traceLogAppend(const uint8_t *record, size_t length) { return sim->traceLogAppend(record, length); }
+    virtual size_t traceLogRead(size_t index, uint8_t *record, size_t size) { return sim->traceLogRead(index, record, size); }
+    virtual size_t traceLogSize() { return sim->traceLogSize(); }
+    virtual bool stateWrite(StateKey key, const uint8_t *data, size_t size) { return sim->stateWrite(key, data, size); }
+    virtual size_t stateRead(StateKey key, uint8_t *data, size_t size) { return sim->stateRead(key, data, size); }
+
+    virtual unsigned long getMillis()
+    {
+        unsigned long ms = sim->getMillis();
+        settle();
+        return ms;
+    }
+    virtual void waitHere(unsigned long ms)
+    {
+        settle();
+        sim->waitHere(ms);
+        settle();
+    }
+
+    virtual int LoRaAvailable() { return sim->LoRaAvailable(); }
+    virtual bool LoRaBegin() { return sim->LoRaBegin(); }
+    virtual std::string LoRaVersion() { return sim->LoRaVersion(); }
+    virtual std::string LoRaDeviceEUI() { return sim->LoRaDeviceEUI(); }
+    virtual int LoRaRead() { return sim->LoRaRead(); }
+    virtual bool LoRaRestart() { return sim->LoRaRestart(); }
+    virtual int LoRaJoinOTAA(std::string eui, std::string key)
+    {
+        settle();
+        ++joins;
+        int result = sim->LoRaJoinOTAA(eui, key);
+        settle();
+        chargeFixed(txCategory, profile.txCurrent, profile.joinTxTime);
+        chargeFixed(rxCategory, profile.rxCurrent, 2.0f * profile.rxWindowTime);
+        return result;
+    }
+    virtual bool LoRaGetSession(LoRaSession *session) { return sim->LoRaGetSession(session); }
+    virtual int LoRaRestoreSession(const LoRaSession &session) { return sim->LoRaRestoreSession(session); }
+    virtual void LoRaSetMinPollInterval(unsigned long secs) { sim->LoRaSetMinPollInterval(secs); }
+    virtual void LoRaSetPort(uint8_t port) { sim->LoRaSetPort(port); }
+    virtual bool LoRaSetADR(bool enabled) { return sim->LoRaSetADR(enabled); }
+    virtual int LoRaGetDataRate() { return sim->LoRaGetDataRate(); }
+    virtual void LoRaBeginPacket()
+    {
+        settle();
+        context = uplinkContext;
+        sim->LoRaBeginPacket();
+    }
+    virtual size_t LoRaWrite(const uint8_t *msgBuffer, size_t msgSize) { return sim->LoRaWrite(msgBuffer, msgSize); }
+    virtual int LoRaEndPacket(bool confirmed)
+    {
+        settle();
+        uint64_t start = sim->now();
+        int result = sim->LoRaEndPacket(confirmed);
+        // the modem transmits during the whole airtime (the mcu waits for the modem response)
+        chargeFixed(txCategory, profile.txCurrent, (float)(sim->now() - start));
+        settle();
+        if (result > 0)
+        {
+            ++uplinks;
+            chargeFixed(rxCategory, profile.rxCurrent, 2.0f * profile.rxWindowTime);
+        }
+        return result;
+    }
+
+    virtual int LoRaSleepUntilReceived(unsigned long ms)
+    {
+        settle();
+        idle = true;
+        int available = sim->LoRaSleepUntilReceived(ms);
+        settle();
+        idle = false;
+        return available;
+    }
+
+    virtual void SerialBeginAndWait(unsigned long baudrate) { sim->SerialBeginAndWait(baudrate); }
+    virtual size_t SerialPrintLn(const char *msg) { return sim->SerialPrintLn(msg); }
+    virtual size_t SerialWrite(const uint8_t *data, size_t size) { return sim->SerialWrite(data, size); }
+
+    virtual void digitalWrite(uint8_t pinNumber, unsigned int value)
+    {
+        settle();
+        if ((int)pinNumber == ledPin)
+        {
+            ledDuty = value ? 255 : 0;
+        }
+        sim->digitalWrite(pinNumber, value);
+    }
+    virtual int digitalRead(uint8_t pinNumber) { return sim->digitalRead(pinNumber); }
+    virtual void pinMode(uint8_t pinNumber, GPIOPinMode pinMode) { sim->pinMode(pinNumber, pinMode); }
+    virtual void setAnalogReference() { sim->setAnalogReference(); }
+    virtual void analogWrite(uint8_t pinNumber, int value)
+    {
+        settle();
+        if ((int)pinNumber == ledPin)
+        {
+            ledDuty = std::min(std::max(value, 0), 255);
+        }
+        sim->analogWrite(pinNumber, value);
+    }
+    virtual int analogRead(uint8_t pinNumber) { return sim->analogRead(pinNumber); }
+
+    virtual void attachInterruptWakeup(uint32_t pin, void (*callback)(void), TriggerMode mode) { sim->attachInterruptWakeup(pin, callback, mode); }
+    virtual void deepSleep(int ms)
+    {
+        settle();
+        unsigned long interruptWakeUps = sim->getInterruptWakeUpCount();
+        sleeping = true;
+        context = sleepContext;
+        sim->deepSleep(ms);
+        settle();
+        sleeping = false;
+        if (sim->getInterruptWakeUpCount() != interruptWakeUps)
+        {
+            ++motionWakeUps;
+            context = motionContext;
+        }
+        else
+        {
+            context = otherContext;
+        }
+    }
+
+private:
+    SimHAL *sim;
+    PowerProfile profile;
+    uint64_t startMillis;
+    uint64_t lastMillis;
+    bool sleeping = false;
+    bool idle = false;
+    Context context = otherContext;
+    int ledPin = -1;
+    int ledDuty = 0;
+    int pirPowerPin = -1;
+    unsigned long motionWakeUps = 0;
+    unsigned long uplinks = 0;
+    unsigned long joins = 0;
+    // charge in uAs
+    double categoryCharge[categoryCount] = {0.0};
+    double contextCharge[contextCount] = {0.0};
+    // awake time in ms
+    double contextAwakeMillis[contextCount] = {0.0};
+
+    void book(Category category, float current, double ms)
+    {
+        double charge = (double)current * ms; // mA * ms = uAs
+        categoryCharge[category] += charge;
+        contextCharge[context] += charge;
+    }
+
+    void chargeFixed(Category category, float current, float ms) { book(category, current, (double)ms); }
+
+    /// @brief Integrates the current state from the last mark up to the current virtual time
+    void settle()
+    {
+        uint64_t nowMillis = sim->now();
+        if (nowMillis <= lastMillis)
+        {
+            return;
+        }
+        double ms = (double)(nowMillis - lastMillis);
+        lastMillis = nowMillis;
+
+        if (sleeping)
+        {
+            book(sleepCategory, profile.sleepCurrent, ms);
+        }
+        else
+        {
+            contextAwakeMillis[context] += ms;
+            book(mcuCategory, idle ? profile.mcuIdleCurrent : profile.mcuActiveCurrent, ms);
+            if (ledDuty > 0)
+            {
+                book(ledCategory, profile.ledCurrent * (float)ledDuty / 255.0f, ms);
+            }
+        }
+        if (pirPowerPin >= 0 && sim->getPinValue((uint8_t)pirPowerPin))
+        {
+            book(pirCategory, profile.pirCurrent, ms);
+        }
+    }
+};
+
+#endif // ENERGY_HAL_H
@@ -0,0 +1,213 @@
+#ifndef FLASHEVENTLOG_H
+#define FLASHEVENTLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Word and byte access to a NOR flash (an erased byte is 0xff, a write only clears bits)
+ */
+class FlashMemory
+{
+public:
+    virtual ~FlashMemory() {}
+    virtual uint32_t flashReadWord(uint32_t address) = 0;
+    virtual void flashWriteWord(uint32_t address, uint32_t value) = 0;
+    virtual uint8_t flashReadByte(uint32_t address) = 0;
+    virtual void flashWriteByte(uint32_t address, uint8_t value) = 0;
+    /// @brief Erases the 4KB sector at the address
+    virtual void flashEraseSector(uint32_t address) = 0;
+};
+
+/**
+ * @brief Persistent motion event log in a ring of flash sectors (event log of the HAL_Arduino)
+ * Every sector starts with a header (sequence number and magic) followed by the records (epoch and state byte).
+ * Records are appended to the newest sector and trimmed by clearing the state byte, a sector is only erased
+ * when the ring wraps around, which spreads the wear over all sectors. The events are counted: a full ring
+ * (the tail reached the head) refuses further events instead of erasing the sector of the oldest events.
+ */
+class FlashEventLog
+{
+public:
+    static const uint32_t sectorSize = 0x1000;
+    static const uint32_t headerSize = 8;
+    static const uint32_t recordSize = 8;
+    static const uint32_t recordsPerSector = (sectorSize - headerSize) / recordSize;
+    static const uint32_t magic = 0x42434c47; // "BCLG"
+
+    /**
+     * @brief Construct a new Flash Event Log object
+     * @param flashMemory flash of the log
+     * @param startAddress address of the first sector
+     * @param sectors number of sectors of the ring
+     */
+    FlashEventLog(FlashMemory *flashMemory, uint32_t startAddress, uint32_t sectors)
+        : memory(flashMemory), start(startAddress), sectorCount(sectors), slotCount(sectors * recordsPerSector) {}
+
+    /**
+     * @brief Finds the oldest and the newest event of the log (after a restart)
+     * @return true (the flash is ready)
+     */
+    bool begin()
+    {
+        // find the newest and the oldest sector by the sequence number in the header
+        int newestSector = -1;
+        int oldestSector = -1;
+        uint32_t oldestSequence = 0xffffffff;
+        sequence = 0;
+        for (uint32_t sector = 0; sector < sectorCount; ++sector)
+        {
+            uint32_t address = start + sector * sectorSize;
+            if (memory->flashReadWord(address + 4) != magic)
+            {
+                // erased sector
+                continue;
+            }
+            uint32_t sectorSequence = memory->flashReadWord(address);
+            if (newestSector < 0 || sectorSequence > sequence)
+            {
+                newestSector = sector;
+                sequence = sectorSequence;
+            }
+            if (sectorSequence < oldestSequence)
+            {
+                oldestSector = sector;
+                oldestSequence = sectorSequence;
+            }
+        }
+
+        head = 0;
+        tail = 0;
+        count = 0;
+        ready = true;
+        if (newestSector < 0)
+        {
+            // empty log
+            return true;
+        }
+
+        // the tail is the first erased record of the newest sector
+        bool newestFull = true;
+        tail = (newestSector + 1) * recordsPerSector;
+        for (uint32_t i = 0; i < recordsPerSector; ++i)
+        {
+            uint32_t slot = newestSector * recordsPerSector + i;
+            if (memory->flashReadWord(slotAddress(slot)) == 0xffffffff)
+            {
+                tail = slot;
+                newestFull = false;
+                break;
+            }
+        }
+        tail %= slotCount;
+
+        // records from the start of the oldest sector to the tail (a full newest sector in front of the oldest
+        // sector means that the ring is full, not empty)
+        uint32_t first = oldestSector * recordsPerSector;
+        uint32_t used = (tail + slotCount - first) % slotCount;
+        if (used == 0 && newestFull)
+        {
+            used = slotCount;
+        }
+
+        // the head is the first record which is not trimmed
+        head = tail;
+        for (uint32_t i = 0; i < used; ++i)
+        {
+            uint32_t slot = (first + i) % slotCount;
+            if (memory->flashReadByte(slotAddress(slot) + 4) == 0xff)
+            {
+                head = slot;
+                count = used - i;
+                break;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Appends an event
+     * @param epoch
+     * @return true if the event was stored, false if the ring is full (or the sector of the tail holds untrimmed events)
+     */
+    bool append(uint32_t epoch)
+    {
+        if (!ready || count >= slotCount)
+        {
+            return false;
+        }
+
+        if ((tail % recordsPerSector) == 0)
+        {
+            // the sector is reused if all its events are trimmed
+            uint32_t sector = tail / recordsPerSector;
+            if (count > 0 && (head / recordsPerSector) == sector)
+            {
+                return false;
+            }
+            uint32_t address = start + sector * sectorSize;
+            memory->flashEraseSector(address);
+            memory->flashWriteWord(address, ++sequence);
+            memory->flashWriteWord(address + 4, magic);
+        }
+
+        memory->flashWriteWord(slotAddress(tail), epoch);
+        tail = (tail + 1) % slotCount;
+        ++count;
+        return true;
+    }
+
+    /**
+     * @brief Reads events (oldest event = index 0)
+     * @return number of events read
+     */
+    size_t read(size_t index, uint32_t *epochs, size_t n)
+    {
+        size_t i = 0;
+        for (; i < n && index + i < count; ++i)
+        {
+            epochs[i] = memory->flashReadWord(slotAddress((head + index + i) % slotCount));
+        }
+        return i;
+    }
+
+    /// @brief Removes the oldest events
+    void trim(size_t n)
+    {
+        for (size_t i = 0; i < n && count > 0; ++i)
+        {
+            // a flash bit can be cleared without erasing the sector
+            memory->flashWriteByte(slotAddress(head) + 4, 0x00);
+            head = (head + 1) % slotCount;
+            --count;
+        }
+    }
+
+    size_t size() const { return count; }
+    size_t getCapacity() const { return slotCount; }
+    bool isReady() const { return ready; }
+    /// @brief The flash is not available (append() fails until the next begin())
+    void end() { ready = false; }
+
+private:
+    FlashMemory *memory;
+    uint32_t start;
+    uint32_t sectorCount;
+    uint32_t slotCount;
+    bool ready = false;
+    // sequence number of the newest sector
+    uint32_t sequence = 0;
+    // slot of the oldest event
+    uint32_t head = 0;
+    // next free slot
+    uint32_t tail = 0;
+    // number of events (head == tail is an empty or a full ring)
+    uint32_t count = 0;
+
+    uint32_t slotAddress(uint32_t slot) const
+    {
+        return start + (slot / recordsPerSector) * sectorSize + headerSize + (slot % recordsPerSector) * recordSize;
+    }
+};
+
+#endif // FLASHEVENTLOG_H
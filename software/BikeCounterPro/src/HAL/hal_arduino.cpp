@@ -1,4 +1,6 @@
 #include "hal_arduino.hpp"
+#include <stdlib.h>
+#include <string.h>
 
 HAL_Arduino *HAL_Arduino::instance{nullptr};
 // Thread-save Singleton (not needed for Arduino)
@@ -42,4 +44,473 @@ bool HAL_Arduino::getEuiAndKeyFromFlash(std::string *appEui, std::string *appKey
     // digitalWrite(LORA_RESET, HIGH);
     
     return 0;
+}
+
+bool HAL_Arduino::getLocationFromFlash(float *latitude, float *longitude)
+{
+    // called after getEuiAndKeyFromFlash(), the flash communication is already running
+    uint8_t readSize = flash.readByte(locationConfigAddress);
+    if (readSize == 0xff || readSize == 0)
+    {
+        return 1;
+    }
+    char rBuffer[256];
+    flash.readBlock(locationConfigAddress + 1, (uint8_t *)rBuffer, readSize);
+    rBuffer[readSize] = '\0';
+    // split and parse config string
+    const char *lat = strstr(rBuffer, "lat:");
+    const char *lon = strstr(rBuffer, "lon:");
+    if (lat == nullptr || lon == nullptr)
+    {
+        return 1;
+    }
+    *latitude = strtof(lat + 4, nullptr);
+    *longitude = strtof(lon + 4, nullptr);
+    if (*latitude < -90.0f || *latitude > 90.0f || *longitude < -180.0f || *longitude > 180.0f)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+bool HAL_Arduino::eventLogBegin()
+{
+    // begin flash communication
+    if (flash.begin(PIN_FLASH_CS, 2000000, SPI1) == false)
+    {
+        eventLog.end();
+        return false;
+    }
+    return eventLog.begin();
+}
+
+bool HAL_Arduino::traceLogBegin()
+{
+    // begin flash communication
+    if (flash.begin(PIN_FLASH_CS, 2000000, SPI1) == false)
+    {
+        traceLogReady = false;
+        return false;
+    }
+
+    // find the newest and the oldest sector by the sequence number in the header
+    int newestSector = -1;
+    int oldestSector = -1;
+    uint32_t oldestSequence = 0xffffffff;
+    traceLogSequence = 0;
+    traceLogCount = 0;
+    traceLogCursorValid = false;
+    for (uint32_t sector = 0; sector < traceLogSectorCount; ++sector)
+    {
+        uint32_t address = traceLogStart + sector * traceLogSectorSize;
+        if (flashReadWord(address + 4) != traceLogMagic)
+        {
+            // erased sector
+            continue;
+        }
+        uint32_t sequence = flashReadWord(address);
+        if (newestSector < 0 || sequence > traceLogSequence)
+        {
+            newestSector = sector;
+            traceLogSequence = sequence;
+        }
+        if (sequence < oldestSequence)
+        {
+            oldestSector = sector;
+            oldestSequence = sequence;
+        }
+        traceLogCount += traceLogCountSector(sector);
+    }
+
+    if (newestSector < 0)
+    {
+        // empty log, the first append erases the first sector
+        traceLogOldestSector = 0;
+        traceLogSector = traceLogSectorCount;
+        traceLogAddress = 0;
+        traceLogReady = true;
+        return true;
+    }
+
+    traceLogOldestSector = oldestSector;
+    traceLogSector = newestSector;
+    traceLogCountSector(newestSector, &traceLogAddress);
+    traceLogReady = true;
+    return true;
+}
+
+bool HAL_Arduino::traceLogAppend(const uint8_t *record, size_t length)
+{
+    if (!traceLogReady || length == 0 || length >= 0xff)
+    {
+        return false;
+    }
+
+    if (traceLogSector >= traceLogSectorCount || traceLogAddress + length + 1 > traceLogStart + (traceLogSector + 1) * traceLogSectorSize)
+    {
+        // continue in the next sector, the oldest records are dropped when the ring wraps around
+        uint32_t sector = traceLogSector >= traceLogSectorCount ? 0 : (traceLogSector + 1) % traceLogSectorCount;
+        uint32_t address = traceLogStart + sector * traceLogSectorSize;
+        if (flashReadWord(address + 4) == traceLogMagic)
+        {
+            traceLogCount -= traceLogCountSector(sector);
+            traceLogOldestSector = (sector + 1) % traceLogSectorCount;
+        }
+        flashEraseSector(address);
+        flashWriteWord(address, ++traceLogSequence);
+        flashWriteWord(address + 4, traceLogMagic);
+        traceLogSector = sector;
+        traceLogAddress = address + traceLogHeaderSize;
+    }
+
+    // the sector of the read cursor may have been erased
+    traceLogCursorValid = false;
+    flash.writeByte(traceLogAddress, (uint8_t)length);
+    flash.writeBlock(traceLogAddress + 1, const_cast<uint8_t *>(record), length);
+    traceLogAddress += length + 1;
+    ++traceLogCount;
+    return true;
+}
+
+size_t HAL_Arduino::traceLogRead(size_t index, uint8_t *record, size_t size)
+{
+    if (!traceLogReady || index >= traceLogCount)
+    {
+        return 0;
+    }
+
+    // a sequential read (the dump of the log) continues behind the last record, an earlier index walks through
+    // the records again starting at the oldest sector
+    if (!traceLogCursorValid || index < traceLogCursorIndex)
+    {
+        traceLogCursorValid = true;
+        traceLogCursorIndex = 0;
+        traceLogCursorSector = 0;
+        traceLogCursorAddress = 0;
+    }
+    for (; traceLogCursorSector < traceLogSectorCount; ++traceLogCursorSector, traceLogCursorAddress = 0)
+    {
+        uint32_t sector = (traceLogOldestSector + traceLogCursorSector) % traceLogSectorCount;
+        uint32_t address = traceLogStart + sector * traceLogSectorSize;
+        uint32_t sectorEnd = address + traceLogSectorSize;
+        if (traceLogCursorAddress == 0)
+        {
+            if (flashReadWord(address + 4) != traceLogMagic)
+            {
+                continue;
+            }
+            traceLogCursorAddress = address + traceLogHeaderSize;
+        }
+        while (traceLogCursorAddress < sectorEnd)
+        {
+            uint8_t length = flash.readByte(traceLogCursorAddress);
+            if (length == 0xff)
+            {
+                break;
+            }
+            uint32_t recordAddress = traceLogCursorAddress;
+            traceLogCursorAddress += length + 1;
+            if (traceLogCursorIndex++ == index)
+            {
+                size_t n = length < size ? length : size;
+                flash.readBlock(recordAddress + 1, record, n);
+                return n;
+            }
+        }
+    }
+    traceLogCursorValid = false;
+    return 0;
+}
+
+size_t HAL_Arduino::traceLogCountSector(uint32_t sector, uint32_t *endAddress)
+{
+    uint32_t address = traceLogStart + sector * traceLogSectorSize + traceLogHeaderSize;
+    uint32_t sectorEnd = traceLogStart + (sector + 1) * traceLogSectorSize;
+    size_t count = 0;
+    while (address < sectorEnd)
+    {
+        uint8_t length = flash.readByte(address);
+        if (length == 0xff)
+        {
+            break;
+        }
+        address += length + 1;
+        ++count;
+    }
+    if (endAddress)
+    {
+        *endAddress = address;
+    }
+    return count;
+}
+
+bool HAL_Arduino::stateBegin()
+{
+    if (flash.begin(PIN_FLASH_CS, 2000000, SPI1) == false)
+    {
+        return false;
+    }
+
+    // the active sector has the higher sequence number
+    bool found = false;
+    for (uint32_t sector = 0; sector < 2; ++sector)
+    {
+        uint32_t address = stateStart + sector * stateSectorSize;
+        if (flashReadWord(address + 4) != stateMagic)
+        {
+            continue;
+        }
+        uint32_t sequence = flashReadWord(address);
+        if (!found || sequence > stateSequence)
+        {
+            stateSector = sector;
+            stateSequence = sequence;
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        stateSector = 0;
+        stateSequence = 1;
+        flashEraseSector(stateStart);
+        flashWriteWord(stateStart, stateSequence);
+        flashWriteWord(stateStart + 4, stateMagic);
+    }
+
+    // find the end of the records
+    uint32_t sectorEnd = stateStart + (stateSector + 1) * stateSectorSize;
+    stateAddress = stateStart + stateSector * stateSectorSize + stateHeaderSize;
+    while (stateAddress + 2 <= sectorEnd)
+    {
+        if (flash.readByte(stateAddress) == 0xff)
+        {
+            if (flash.readByte(stateAddress + 1) != 0xff)
+            {
+                // interrupted write, the sector is compacted with the next write
+                stateAddress = sectorEnd;
+            }
+            break;
+        }
+        stateAddress += 2 + flash.readByte(stateAddress + 1);
+    }
+    stateReady = true;
+    return true;
+}
+
+uint32_t HAL_Arduino::stateFind(uint8_t key, uint32_t sector)
+{
+    uint32_t sectorEnd = stateStart + (sector + 1) * stateSectorSize;
+    uint32_t address = stateStart + sector * stateSectorSize + stateHeaderSize;
+    uint32_t newest = 0;
+    while (address + 2 <= sectorEnd)
+    {
+        uint8_t recordKey = flash.readByte(address);
+        if (recordKey == 0xff)
+        {
+            break;
+        }
+        if (recordKey == key)
+        {
+            newest = address;
+        }
+        address += 2 + flash.readByte(address + 1);
+    }
+    return newest;
+}
+
+void HAL_Arduino::stateCompact()
+{
+    uint32_t target = 1 - stateSector;
+    uint32_t targetStart = stateStart + target * stateSectorSize;
+    flashEraseSector(targetStart);
+
+    uint32_t sectorEnd = stateStart + (stateSector + 1) * stateSectorSize;
+    uint32_t address = stateStart + stateSector * stateSectorSize + stateHeaderSize;
+    uint32_t targetAddress = targetStart + stateHeaderSize;
+    uint8_t buffer[2 + stateMaxSize];
+    while (address + 2 <= sectorEnd)
+    {
+        uint8_t key = flash.readByte(address);
+        if (key == 0xff)
+        {
+            break;
+        }
+        uint8_t length = flash.readByte(address + 1);
+        if (stateFind(key, stateSector) == address && length <= stateMaxSize)
+        {
+            flash.readBlock(address + 1, buffer + 1, 1 + length);
+            flash.writeBlock(targetAddress + 1, buffer + 1, 1 + length);
+            flash.writeBlock(targetAddress, &key, 1);
+            targetAddress += 2 + length;
+        }
+        address += 2 + length;
+    }
+
+    // the header makes the sector valid
+    flashWriteWord(targetStart, stateSequence + 1);
+    flashWriteWord(targetStart + 4, stateMagic);
+    stateSector = target;
+    ++stateSequence;
+    stateAddress = targetAddress;
+}
+
+bool HAL_Arduino::stateWrite(StateKey key, const uint8_t *data, size_t size)
+{
+    if (size > stateMaxSize || (!stateReady && !stateBegin()))
+    {
+        return false;
+    }
+    uint32_t sectorEnd = stateStart + (stateSector + 1) * stateSectorSize;
+    if (stateAddress + 2 + size > sectorEnd)
+    {
+        stateCompact();
+        sectorEnd = stateStart + (stateSector + 1) * stateSectorSize;
+        if (stateAddress + 2 + size > sectorEnd)
+        {
+            return false;
+        }
+    }
+    uint8_t length = (uint8_t)size;
+    uint8_t keyByte = (uint8_t)key;
+    flash.writeBlock(stateAddress + 1, &length, 1);
+    flash.writeBlock(stateAddress + 2, const_cast<uint8_t *>(data), size);
+    // the key byte completes the record
+    flash.writeBlock(stateAddress, &keyByte, 1);
+    stateAddress += 2 + size;
+    return true;
+}
+
+size_t HAL_Arduino::stateRead(StateKey key, uint8_t *data, size_t size)
+{
+    if (!stateReady && !stateBegin())
+    {
+        return 0;
+    }
+    uint32_t address = stateFind((uint8_t)key, stateSector);
+    if (address == 0)
+    {
+        return 0;
+    }
+    uint8_t length = flash.readByte(address + 1);
+    flash.readBlock(address + 2, data, length < size ? length : size);
+    return length;
+}
+
+namespace
+{
+    // hex string of the modem (e.g. "26011F2A") to bytes, returns false if the string is too short
+    bool hexToBytes(const String &hex, uint8_t *bytes, size_t count)
+    {
+        if (hex.length() < 2 * count)
+        {
+            return false;
+        }
+        char digits[3] = {0, 0, 0};
+        for (size_t i = 0; i < count; ++i)
+        {
+            digits[0] = hex[2 * i];
+            digits[1] = hex[2 * i + 1];
+            bytes[i] = (uint8_t)strtoul(digits, nullptr, 16);
+        }
+        return true;
+    }
+
+    // session of the modem (valid after a join or if the modem firmware kept it over a restart)
+    bool readModemSession(LoRaModem &modem, HAL::LoRaSession *session)
+    {
+        uint8_t devAddr[4];
+        if (!hexToBytes(modem.getDevAddr(), devAddr, 4) || !hexToBytes(modem.getNwkSKey(), session->nwkSKey, 16) ||
+            !hexToBytes(modem.getAppSKey(), session->appSKey, 16))
+        {
+            return false;
+        }
+        session->devAddr = ((uint32_t)devAddr[0] << 24) | ((uint32_t)devAddr[1] << 16) | ((uint32_t)devAddr[2] << 8) | devAddr[3];
+        session->fCntUp = (uint32_t)modem.getFCU();
+        session->fCntDown = (uint32_t)modem.getFCD();
+        return true;
+    }
+}
+
+bool HAL_Arduino::LoRaGetSession(LoRaSession *session)
+{
+    if (!loRaSessionActive)
+    {
+        return false;
+    }
+    return readModemSession(modem, session);
+}
+int HAL_Arduino::LoRaRestoreSession(const LoRaSession &session)
+{
+    // An ABP join would start the session with the default MAC settings (RX1 delay 1s, RX2 on SF12, no channels
+    // of the CFList) instead of the settings of the join accept and the downlinks would be lost. The session is
+    // only resumed if the modem still holds it, after a reset of the modem the connector joins again.
+    LoRaSession current;
+    if (!readModemSession(modem, &current) || current.devAddr != session.devAddr ||
+        memcmp(current.nwkSKey, session.nwkSKey, 16) != 0 || memcmp(current.appSKey, session.appSKey, 16) != 0)
+    {
+        return 0;
+    }
+    // the stored counters are never lower than the counters of the network server (the modem firmware keeps 16 bit counters)
+    if (current.fCntUp < session.fCntUp)
+    {
+        modem.setFCU((uint16_t)session.fCntUp);
+    }
+    if (current.fCntDown < session.fCntDown)
+    {
+        modem.setFCD((uint16_t)session.fCntDown);
+    }
+    loRaSessionActive = true;
+    return 1;
+}
+
+int HAL_Arduino::LoRaSleepUntilReceived(unsigned long ms)
+{
+    // The modem reports a downlink over the uart. The idle mode keeps the uart clocked (a deep sleep would lose
+    // the first bytes), the mcu wakes on every received byte and on the systick and sleeps again until the
+    // message is complete or the receive windows are closed.
+    unsigned long start = Arduino_h::millis();
+    while (!modem.available() && Arduino_h::millis() - start < ms)
+    {
+        LowPower.idle(ms - (Arduino_h::millis() - start));
+    }
+    return modem.available();
+}
+
+uint32_t HAL_Arduino::flashReadWord(uint32_t address)
+{
+    uint8_t buffer[4];
+    flash.readBlock(address, buffer, 4);
+    return ((uint32_t)buffer[3] << 24) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[1] << 8) | buffer[0];
+}
+
+void HAL_Arduino::flashWriteWord(uint32_t address, uint32_t value)
+{
+    uint8_t buffer[4] = {(uint8_t)(value & 0xff), (uint8_t)((value >> 8) & 0xff), (uint8_t)((value >> 16) & 0xff), (uint8_t)(value >> 24)};
+    flash.writeBlock(address, buffer, 4);
+}
+
+void HAL_Arduino::flashEraseSector(uint32_t address)
+{
+    // 4KB sector erase (0x20) of the SPI NOR flash
+    SPI1.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
+    Arduino_h::digitalWrite(PIN_FLASH_CS, LOW);
+    SPI1.transfer(0x06); // write enable
+    Arduino_h::digitalWrite(PIN_FLASH_CS, HIGH);
+    Arduino_h::digitalWrite(PIN_FLASH_CS, LOW);
+    SPI1.transfer(0x20);
+    SPI1.transfer((address >> 16) & 0xff);
+    SPI1.transfer((address >> 8) & 0xff);
+    SPI1.transfer(address & 0xff);
+    Arduino_h::digitalWrite(PIN_FLASH_CS, HIGH);
+
+    // wait until the busy flag of the status register is cleared (max. 400ms)
+    uint8_t status = 0;
+    do
+    {
+        Arduino_h::digitalWrite(PIN_FLASH_CS, LOW);
+        SPI1.transfer(0x05);
+        status = SPI1.transfer(0x00);
+        Arduino_h::digitalWrite(PIN_FLASH_CS, HIGH);
+    } while (status & 0x01);
+    SPI1.endTransaction();
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define HAL_ARDUINO_H
 
 #include "hal_interface.hpp"
+#include "flashEventLog.hpp"
 #include <string>
 #include <RTCZero.h>
 #include <Adafruit_AM2320.h>
@@ -10,7 +11,7 @@
 #include <SparkFun_SPI_SerialFlash.h>
 #include <MKRWAN.h>
 
-class HAL_Arduino : public HAL
+class HAL_Arduino : public HAL, private FlashMemory
 {
 public:
     // Singletons should not be cloneable and not be assignable.
@@ -36,21 +37,55 @@ public:
     virtual float AM2320ReadHumidity() { return am2320.readHumidity(); }
 
     virtual bool getEuiAndKeyFromFlash(std::string *appEui, std::string *appKey);
+    virtual bool getLocationFromFlash(float *latitude, float *longitude);
+
+    virtual bool eventLogBegin();
+    virtual bool eventLogAppend(uint32_t epoch) { return eventLog.append(epoch); }
+    virtual size_t eventLogRead(size_t index, uint32_t *epochs, size_t count) { return eventLog.read(index, epochs, count); }
+    virtual size_t eventLogSize() { return eventLog.size(); }
+    virtual void eventLogTrim(size_t count) { eventLog.trim(count); }
+
+    virtual bool traceLogBegin();
+    virtual bool traceLogAppend(const uint8_t *record, size_t length);
+    virtual size_t traceLogRead(size_t index, uint8_t *record, size_t size);
+    virtual size_t traceLogSize() { return traceLogCount; }
+
+    virtual bool stateWrite(StateKey key, const uint8_t *data, size_t size);
+    virtual size_t stateRead(StateKey key, uint8_t *data, size_t size);
 
     virtual unsigned long getMillis() { return Arduino_h::millis(); }
     virtual void waitHere(unsigned long ms) { Arduino_h::delay(ms); };
 
     virtual int LoRaAvailable() { return modem.available(); }
-    virtual bool LoRaBegin() { return modem.begin(EU868); }
+    virtual bool LoRaBegin()
+    {
+        loRaSessionActive = false;
+        return modem.begin(EU868);
+    }
     virtual std::string LoRaVersion() { return modem.version().c_str(); }
     virtual std::string LoRaDeviceEUI() { return modem.deviceEUI().c_str(); }
     virtual int LoRaRead() { return modem.read(); }
-    virtual bool LoRaRestart() { return modem.restart(); }
-    virtual int LoRaJoinOTAA(std::string eui, std::string key) { return modem.joinOTAA(eui.c_str(), key.c_str()); }
+    virtual bool LoRaRestart()
+    {
+        loRaSessionActive = false;
+        return modem.restart();
+    }
+    virtual int LoRaJoinOTAA(std::string eui, std::string key)
+    {
+        int join = modem.joinOTAA(eui.c_str(), key.c_str());
+        loRaSessionActive = join == 1;
+        return join;
+    }
+    virtual bool LoRaGetSession(LoRaSession *session);
+    virtual int LoRaRestoreSession(const LoRaSession &session);
     virtual void LoRaSetMinPollInterval(unsigned long secs) { modem.minPollInterval(secs); }
+    virtual void LoRaSetPort(uint8_t port) { modem.setPort(port); }
+    virtual bool LoRaSetADR(bool enabled) { return modem.setADR(enabled); }
+    virtual int LoRaGetDataRate() { return modem.getDataRate(); }
     virtual void LoRaBeginPacket() { modem.beginPacket(); }
     virtual size_t LoRaWrite(const uint8_t *msgBuffer, size_t msgSize) { return modem.write(msgBuffer, msgSize); }
     virtual int LoRaEndPacket(bool confirmed) { return modem.endPacket(confirmed); }
+    virtual int LoRaSleepUntilReceived(unsigned long ms);
 
     virtual void SerialBeginAndWait(unsigned long baudrate)
     {
@@ -58,7 +93,8 @@ public:
         while (!Serial)
             ;
     }
-    virtual size_t SerialPrintLn(std::string msg) { return Serial.println(msg.c_str()); }
+    virtual size_t SerialPrintLn(const char *msg) { return Serial.println(msg); }
+    virtual size_t SerialWrite(const uint8_t *data, size_t size) { return Serial.write(data, size); }
 
     virtual void digitalWrite(uint8_t pinNumber, unsigned int value) { Arduino_h::digitalWrite(pinNumber, static_cast<PinStatus>(value)); }
     virtual int digitalRead(uint8_t pinNumber) { return Arduino_h::digitalRead(pinNumber); }
@@ -92,8 +128,75 @@ private:
     // SPI serial flash object
     SFE_SPI_FLASH flash;
 
+    // Location config "lat:<degrees>;lon:<degrees>" in the second half of the config sector
+    // (first byte = length, an erased byte 0xff = no location configured)
+    static const uint32_t locationConfigAddress = 0x800;
+
+    // Event log in the SPI flash (the first sector holds the config string), see FlashEventLog
+    static const uint32_t eventLogStart = 0x1000;
+    static const uint32_t eventLogSectorSize = FlashEventLog::sectorSize;
+    static const uint32_t eventLogSectorCount = 16;
+    FlashEventLog eventLog = FlashEventLog(this, eventLogStart, eventLogSectorCount);
+
+    // Trace log in the SPI flash behind the event log
+    // Same sector ring as the event log, the records are stored with a length byte and never span two sectors
+    // (an erased length byte 0xff marks the end of a sector). The oldest sector is erased when the ring wraps around.
+    static const uint32_t traceLogStart = eventLogStart + eventLogSectorCount * eventLogSectorSize;
+    static const uint32_t traceLogSectorSize = 0x1000;
+    static const uint32_t traceLogSectorCount = 16;
+    static const uint32_t traceLogHeaderSize = 8;
+    static const uint32_t traceLogMagic = 0x42435452; // "BCTR"
+    bool traceLogReady = false;
+    // sequence number of the newest sector
+    uint32_t traceLogSequence = 0;
+    // sector of the oldest record
+    uint32_t traceLogOldestSector = 0;
+    // sector of the newest record (traceLogSectorCount = empty log)
+    uint32_t traceLogSector = traceLogSectorCount;
+    // address of the next record
+    uint32_t traceLogAddress = 0;
+    // number of records in the ring
+    size_t traceLogCount = 0;
+    // read cursor behind the last record read by traceLogRead() (sector offset from the oldest sector and
+    // address of the next record, 0 = start of the sector)
+    bool traceLogCursorValid = false;
+    size_t traceLogCursorIndex = 0;
+    uint32_t traceLogCursorSector = 0;
+    uint32_t traceLogCursorAddress = 0;
+
+    // counts the records of a sector (and returns the first free address)
+    size_t traceLogCountSector(uint32_t sector, uint32_t *endAddress = nullptr);
+
+    // Persistent state records in two sectors behind the trace log
+    // The records (key, length, data) are appended to the active sector, the key byte is written last. A full sector
+    // is compacted into the other sector (newest record of every key) whose header is written after the records,
+    // so an interrupted compaction leaves the active sector valid.
+    static const uint32_t stateStart = traceLogStart + traceLogSectorCount * traceLogSectorSize;
+    static const uint32_t stateSectorSize = 0x1000;
+    static const uint32_t stateHeaderSize = 8;
+    static const uint32_t stateMagic = 0x42435354; // "BCST"
+    bool stateReady = false;
+    // active sector (0 or 1) and its sequence number
+    uint32_t stateSector = 0;
+    uint32_t stateSequence = 0;
+    // address of the next record
+    uint32_t stateAddress = 0;
+
+    bool stateBegin();
+    // address of the newest record of the key in the sector (0 = no record)
+    uint32_t stateFind(uint8_t key, uint32_t sector);
+    // copies the newest records into the other sector
+    void stateCompact();
+    virtual uint32_t flashReadWord(uint32_t address);
+    virtual void flashWriteWord(uint32_t address, uint32_t value);
+    virtual uint8_t flashReadByte(uint32_t address) { return flash.readByte(address); }
+    virtual void flashWriteByte(uint32_t address, uint8_t value) { flash.writeByte(address, value); }
+    virtual void flashEraseSector(uint32_t address);
+
     // LoRa modem object
     LoRaModem modem = LoRaModem(Serial1);
+    // the modem has a session (joined or restored since the last begin/restart)
+    bool loRaSessionActive = false;
 };
 
 #endif // HAL_ARDUINO_H
\ No newline at end of file
@@ -23,6 +23,26 @@ public:
         RISING = 4,
     } TriggerMode;
 
+    // keys of the persistent state records
+    typedef enum
+    {
+        STATE_RTC_DRIFT = 1,
+        STATE_LORA_SESSION = 2,
+    } StateKey;
+
+    // max. size of a persistent state record
+    static const size_t stateMaxSize = 64;
+
+    // LoRaWAN session of the modem (the ABP parameters of an OTAA join)
+    struct LoRaSession
+    {
+        uint32_t devAddr;
+        uint8_t nwkSKey[16];
+        uint8_t appSKey[16];
+        uint32_t fCntUp;
+        uint32_t fCntDown;
+    };
+
     virtual void rtcBegin(bool resetTime = false) = 0;
     virtual void rtcSetEpoch(uint32_t ts) = 0;
     virtual uint32_t rtcGetEpoch() = 0;
@@ -40,6 +60,26 @@ public:
     virtual float AM2320ReadHumidity() = 0;
 
     virtual bool getEuiAndKeyFromFlash(std::string *appEui, std::string *appKey) = 0;
+    // location of the counter (degrees), returns 1 if no location is configured
+    virtual bool getLocationFromFlash(float *latitude, float *longitude) = 0;
+
+    // persistent log of the motion events (oldest event = index 0)
+    virtual bool eventLogBegin() = 0;
+    virtual bool eventLogAppend(uint32_t epoch) = 0;
+    virtual size_t eventLogRead(size_t index, uint32_t *epochs, size_t count) = 0;
+    virtual size_t eventLogSize() = 0;
+    virtual void eventLogTrim(size_t count) = 0;
+
+    // persistent ring of binary trace records (oldest record = index 0, the oldest records are overwritten)
+    virtual bool traceLogBegin() = 0;
+    virtual bool traceLogAppend(const uint8_t *record, size_t length) = 0;
+    virtual size_t traceLogRead(size_t index, uint8_t *record, size_t size) = 0;
+    virtual size_t traceLogSize() = 0;
+
+    // small persistent state records (survive a restart), the last write of a key wins
+    virtual bool stateWrite(StateKey key, const uint8_t *data, size_t size) = 0;
+    // returns the size of the record (0 = no record), copies at most size bytes
+    virtual size_t stateRead(StateKey key, uint8_t *data, size_t size) = 0;
 
     virtual unsigned long getMillis() = 0;
     virtual void waitHere(unsigned long ms) = 0;
@@ -51,13 +91,27 @@ public:
     virtual int LoRaRead() = 0;
     virtual bool LoRaRestart() = 0;
     virtual int LoRaJoinOTAA(std::string eui, std::string key) = 0;
+    // reads the session of the modem, returns false if the modem has not joined since the last begin/restart
+    virtual bool LoRaGetSession(LoRaSession *session) = 0;
+    // resumes a stored session without a join if the modem still holds it (with the MAC settings of the join accept),
+    // returns 1 on success
+    virtual int LoRaRestoreSession(const LoRaSession &session) = 0;
     virtual void LoRaSetMinPollInterval(unsigned long secs) = 0;
+    virtual void LoRaSetPort(uint8_t port) = 0;
+    // adaptive data rate, the network server adjusts the data rate to the link quality
+    virtual bool LoRaSetADR(bool enabled) = 0;
+    // current data rate of the uplinks (EU868: 0 = SF12 ... 5 = SF7, 6 = SF7/250kHz, 7 = FSK), -1 = unknown
+    virtual int LoRaGetDataRate() = 0;
     virtual void LoRaBeginPacket() = 0;
     virtual size_t LoRaWrite(const uint8_t *msgBuffer, size_t msgSize) = 0;
     virtual int LoRaEndPacket(bool confirmed) = 0;
+    // sleeps until the modem reports a downlink (wake source) or at most ms (end of the receive windows),
+    // returns the number of available downlink bytes
+    virtual int LoRaSleepUntilReceived(unsigned long ms) = 0;
 
     virtual void SerialBeginAndWait(unsigned long baudrate) = 0;
-    virtual size_t SerialPrintLn(std::string msg) = 0;
+    virtual size_t SerialPrintLn(const char *msg) = 0;
+    virtual size_t SerialWrite(const uint8_t *data, size_t size) = 0;
 
     virtual void digitalWrite(uint8_t pinNumber, unsigned int value) = 0;
     virtual int digitalRead(uint8_t pinNumber) = 0;
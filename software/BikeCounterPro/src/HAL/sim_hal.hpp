@@ -0,0 +1,702 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include "hal_interface.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "../timerSchedule/date.h"
+#include "../airtimeLedger/airtimeLedger.hpp"
+
+/**
+ * @brief Host-side HAL implementation driven by a virtual clock.
+ *
+ * Nothing in this class waits in real time. deepSleep(), waitHere() and getMillis() advance the
+ * simulated clock instantly and the RTC follows that clock (optionally with a drift).
+ * Pin interrupts are injected as discrete events and dispatched to the attached callback at
+ * their exact virtual time, which also wakes the device from a deep sleep.
+ * The LoRa modem is modelled as a network with a configurable join result, a record of all sent
+ * uplinks and a responder that can queue downlinks (by default the time sync of the cloud backend).
+ * The network server keeps the session of the last join and drops uplinks with an unknown device
+ * address or a frame counter that was already used. Like on a real modem an unconfirmed uplink is
+ * still reported as sent, only a confirmed uplink fails without the acknowledgement.
+ * The modem keeps its session over a restart unless setModemKeepsSession(false) is set.
+ * The data rate is only modelled if a link data rate is set: a join starts at DR0, with ADR enabled
+ * the network assigns the link data rate after the first uplink and uplinks which exceed the max.
+ * payload size of the current data rate are rejected.
+ *
+ * This header is only used for host builds (simulation, tests and benchmarks).
+ */
+class SimHAL : public HAL
+{
+public:
+    /// @brief Uplink message as seen by the simulated network server
+    struct Uplink
+    {
+        uint64_t millis;         // virtual time at the end of the transmission
+        uint32_t worldEpoch;     // real time of the transmission
+        uint32_t deviceEpoch;    // device rtc time of the transmission
+        bool confirmed;          // confirmed uplink flag
+        uint8_t fPort;           // application port
+        int dataRate;            // data rate of the transmission (-1 = no data rate model)
+        std::vector<uint8_t> payload;
+    };
+
+    /// @brief Simulated network server callback, returns the downlink payload (empty = no downlink)
+    typedef std::function<std::vector<uint8_t>(const Uplink &)> DownlinkResponder;
+
+    /// @param worldStartEpoch real (UTC) time at the start of the simulation
+    SimHAL(uint32_t worldStartEpoch = 1704067200ul) : worldStartEpoch(worldStartEpoch)
+    {
+        downlinkResponder = timeSyncResponder;
+    }
+    virtual ~SimHAL() {}
+
+    // ---------------------------------------------------------------------------------------------
+    // simulation control
+    // ---------------------------------------------------------------------------------------------
+
+    /// @brief Virtual milliseconds since the start of the simulation
+    uint64_t now() const { return simMillis; }
+    /// @brief Real (UTC) epoch at the current virtual time
+    uint32_t worldEpoch() const { return worldStartEpoch + (uint32_t)(simMillis / 1000ull); }
+    /// @brief Converts a real (UTC) epoch into virtual milliseconds
+    uint64_t epochToMillis(uint32_t epoch) const { return epoch > worldStartEpoch ? (uint64_t)(epoch - worldStartEpoch) * 1000ull : 0ull; }
+
+    /// @brief Advances the virtual clock and dispatches all interrupts on the way
+    /// @param ms time span in milliseconds
+    /// @param wakeOnInterrupt stop at the first dispatched interrupt
+    /// @return true if the advance was stopped by an interrupt
+    bool advance(uint64_t ms, bool wakeOnInterrupt = false)
+    {
+        uint64_t end = simMillis + ms;
+        while (!pendingInterrupts.empty() && pendingInterrupts.begin()->first <= end)
+        {
+            std::multimap<uint64_t, uint32_t>::iterator it = pendingInterrupts.begin();
+            simMillis = std::max(simMillis, it->first);
+            uint32_t pin = it->second;
+            pendingInterrupts.erase(it);
+            if (dispatchInterrupt(pin) && wakeOnInterrupt)
+            {
+                return true;
+            }
+        }
+        simMillis = end;
+        return false;
+    }
+
+    /// @brief Emulates the Arduino runtime: calls loopFunction until the real time reaches endEpoch
+    void runUntil(uint32_t endEpoch, const std::function<void()> &loopFunction)
+    {
+        while (worldEpoch() < endEpoch)
+        {
+            loopFunction();
+        }
+    }
+
+    /// @brief Injects an edge on a pin at the given virtual time
+    void injectInterrupt(uint32_t pin, uint64_t atMillis) { pendingInterrupts.insert(std::make_pair(atMillis, pin)); }
+    /// @brief Injects a motion (PIR) trigger at the given real (UTC) epoch
+    void injectMotion(uint32_t epoch) { injectInterrupt(motionInterruptPin, epochToMillis(epoch)); }
+    /// @brief Injects a motion (PIR) trigger at the given virtual time with millisecond resolution
+    void injectMotionAtMillis(uint64_t atMillis) { injectInterrupt(motionInterruptPin, atMillis); }
+    /// @brief Number of injected interrupts that are not yet dispatched
+    size_t getPendingInterruptCount() const { return pendingInterrupts.size(); }
+
+    /// @brief Pins of the PIR sensor. Motion triggers are dropped while the power pin is low (-1 = always powered).
+    void setMotionSensorPins(uint32_t interruptPin, int powerPin = -1)
+    {
+        motionInterruptPin = interruptPin;
+        motionPowerPin = powerPin;
+    }
+
+    /// @brief RTC drift in parts per million (positive = rtc runs fast)
+    void setRtcDriftPpm(double ppm)
+    {
+        rtcBaseEpochMs = rtcEpochMs();
+        rtcBaseMillis = simMillis;
+        rtcDriftPpm = ppm;
+    }
+    /// @brief Time the getMillis() call costs (keeps busy polling loops moving forward)
+    void setMillisPerCall(unsigned long ms) { millisPerCall = ms; }
+
+    void setDigitalInput(uint8_t pinNumber, int value) { digitalInputs[pinNumber] = value; }
+    void setAnalogInput(uint8_t pinNumber, int value) { analogInputs[pinNumber] = value; }
+    void setTemperature(float t) { temperature = t; }
+    void setHumidity(float h) { humidity = h; }
+    void setFlashConfig(bool available, std::string appEui = "0000000000000000", std::string appKey = "00000000000000000000000000000000")
+    {
+        flashAvailable = available;
+        eui = appEui;
+        key = appKey;
+    }
+    /// @brief Location record of the flash config (not configured by default)
+    void setLocationConfig(bool configured, float latitude = 0.0f, float longitude = 0.0f)
+    {
+        locationConfigured = configured;
+        locationLatitude = latitude;
+        locationLongitude = longitude;
+    }
+
+    /// @brief Max. number of events in the event log (the log survives a restart of the device)
+    void setEventLogCapacity(size_t capacity) { eventLogCapacity = capacity; }
+    const std::deque<uint32_t> &getEventLog() const { return eventLog; }
+    /// @brief Number of stateWrite() calls (flash wear)
+    size_t getStateWriteCount() const { return stateWriteCount; }
+    size_t getStateWriteCount(StateKey key) const
+    {
+        std::map<int, size_t>::const_iterator it = stateWriteCounts.find(key);
+        return it == stateWriteCounts.end() ? 0 : it->second;
+    }
+    /// @brief Erases the persistent state records
+    void clearState() { stateRecords.clear(); }
+    /// @brief Max. number of bytes in the trace log (the oldest records are overwritten)
+    void setTraceLogCapacity(size_t capacity) { traceLogCapacity = capacity; }
+    const std::deque<std::vector<uint8_t>> &getTraceLog() const { return traceLog; }
+
+    void setModemAvailable(bool available) { modemAvailable = available; }
+    void setJoinResult(bool success) { joinSucceeds = success; }
+    void setJoinDuration(unsigned long ms) { joinDurationMs = ms; }
+    void setUplinkResult(bool success) { uplinkSucceeds = success; }
+    /// @brief Fixed airtime of every uplink (0 = time on air of the payload at the current data rate, the default)
+    void setUplinkAirtime(unsigned long ms) { uplinkAirtimeMs = ms; }
+    void setDownlinkResponder(DownlinkResponder responder) { downlinkResponder = responder; }
+    /// @brief Data rate the ADR of the network server assigns (-1 = no data rate model, the default)
+    void setLinkDataRate(int dataRate) { linkDataRate = dataRate; }
+    /// @brief The network server forgets the session (e.g. the device was deleted), only a new join helps
+    void forgetSession() { networkDevAddr = 0; }
+    /// @brief The modem keeps the session of the join over a restart (default), otherwise a restart clears it
+    void setModemKeepsSession(bool keeps) { modemKeepsSession = keeps; }
+    /// @brief Session of the modem (valid after a join or a restore)
+    const LoRaSession &getSession() const { return session; }
+    /// @brief Queues a downlink for the next uplink (additional to the responder)
+    void queueDownlink(const std::vector<uint8_t> &payload) { queuedDownlinks.push_back(payload); }
+    /// @brief Time from the end of the uplink until the downlink is received (RX1 delay of the network server, default 1s)
+    void setDownlinkDelay(unsigned long ms) { downlinkDelayMs = ms; }
+
+    const std::vector<Uplink> &getUplinks() const { return uplinks; }
+    void clearUplinks() { uplinks.clear(); }
+    unsigned long getJoinCount() const { return joinCount; }
+    unsigned long getSessionRestoreCount() const { return sessionRestoreCount; }
+    unsigned long getDownlinkCount() const { return downlinkCount; }
+    uint64_t getAirtimeMillis() const { return airtimeMillis; }
+    unsigned long getDispatchedInterruptCount() const { return dispatchedInterrupts; }
+    unsigned long getDroppedInterruptCount() const { return droppedInterrupts; }
+    unsigned long getTimerWakeUpCount() const { return timerWakeUps; }
+    unsigned long getInterruptWakeUpCount() const { return interruptWakeUps; }
+    uint64_t getSleepMillis() const { return sleepMillis; }
+    /// @brief Time in the idle mode while waiting for a downlink (part of the awake time)
+    uint64_t getIdleMillis() const { return idleMillis; }
+    uint64_t getAwakeMillis() const { return simMillis - sleepMillis; }
+    int getPinValue(uint8_t pinNumber) const
+    {
+        std::map<uint8_t, int>::const_iterator it = outputs.find(pinNumber);
+        return it == outputs.end() ? 0 : it->second;
+    }
+    /// @brief Receives every line written to the serial port (default: discarded)
+    void setSerialSink(std::function<void(const std::string &)> sink) { serialSink = sink; }
+    /// @brief Receives the binary data written to the serial port (default: discarded)
+    void setSerialDataSink(std::function<void(const uint8_t *, size_t)> sink) { serialDataSink = sink; }
+
+    /// @brief Network server behaviour of the cloud backend (storeBikeCounterProTimeSync):
+    /// sends the time drift as downlink if the device time deviates more than 2 min (like the network server).
+    /// A delayed package (status bit 2, except the sync call 7) was sent from the backlog and is not used.
+    static std::vector<uint8_t> timeSyncResponder(const Uplink &uplink)
+    {
+        std::vector<uint8_t> downlink;
+        if (uplink.payload.size() < 8)
+        {
+            return downlink;
+        }
+        uint8_t status = uplink.payload[2] & 0x07;
+        if (status != 7 && (status & 0x04) != 0)
+        {
+            return downlink;
+        }
+        uint32_t deviceTime = uplink.payload[7];
+        deviceTime = (deviceTime << 8) | uplink.payload[6];
+        deviceTime = (deviceTime << 8) | uplink.payload[5];
+        deviceTime = deviceTime * 60ul + 1640995200ul;
+        int32_t timeDrift = (int32_t)(uplink.worldEpoch - deviceTime);
+        if (std::abs(timeDrift) > 2 * 60)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                downlink.push_back((uint8_t)(((uint32_t)timeDrift >> (8 * i)) & 0xff));
+            }
+        }
+        return downlink;
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // HAL interface
+    // ---------------------------------------------------------------------------------------------
+
+    virtual void rtcBegin(bool resetTime = false)
+    {
+        if (resetTime)
+        {
+            rtcSetEpoch(946684800ul); // RTCZero resets to 01.01.2000
+        }
+    }
+    virtual void rtcSetEpoch(uint32_t ts)
+    {
+        rtcBaseEpochMs = (uint64_t)ts * 1000ull;
+        rtcBaseMillis = simMillis;
+    }
+    virtual uint32_t rtcGetEpoch() { return (uint32_t)(rtcEpochMs() / 1000ull); }
+    virtual uint8_t rtcGetHours() { return (uint8_t)rtcTime().hours().count(); }
+    virtual uint8_t rtcGetMinutes() { return (uint8_t)rtcTime().minutes().count(); }
+    virtual uint8_t rtcGetSeconds() { return (uint8_t)rtcTime().seconds().count(); }
+    virtual uint8_t rtcGetDay() { return (uint8_t)unsigned{rtcDate().day()}; }
+    virtual uint8_t rtcGetMonth() { return (uint8_t)unsigned{rtcDate().month()}; }
+    virtual uint8_t rtcGetYear() { return (uint8_t)(int{rtcDate().year()} - 2000); }
+
+    virtual void I2CInit() {}
+    virtual void AM2320Init() {}
+    virtual float AM2320ReadTemperature() { return temperature; }
+    virtual float AM2320ReadHumidity() { return humidity; }
+
+    virtual bool getEuiAndKeyFromFlash(std::string *appEui, std::string *appKey)
+    {
+        if (!flashAvailable)
+        {
+            return 1;
+        }
+        *appEui = eui;
+        *appKey = key;
+        return 0;
+    }
+    virtual bool getLocationFromFlash(float *latitude, float *longitude)
+    {
+        if (!flashAvailable || !locationConfigured)
+        {
+            return 1;
+        }
+        *latitude = locationLatitude;
+        *longitude = locationLongitude;
+        return 0;
+    }
+
+    virtual bool eventLogBegin() { return flashAvailable; }
+    virtual bool eventLogAppend(uint32_t epoch)
+    {
+        if (!flashAvailable || eventLog.size() >= eventLogCapacity)
+        {
+            return false;
+        }
+        eventLog.push_back(epoch);
+        return true;
+    }
+    virtual size_t eventLogRead(size_t index, uint32_t *epochs, size_t count)
+    {
+        size_t n = 0;
+        for (; n < count && index + n < eventLog.size(); ++n)
+        {
+            epochs[n] = eventLog[index + n];
+        }
+        return n;
+    }
+    virtual size_t eventLogSize() { return eventLog.size(); }
+    virtual void eventLogTrim(size_t count) { eventLog.erase(eventLog.begin(), eventLog.begin() + std::min(count, eventLog.size())); }
+
+    virtual bool traceLogBegin() { return flashAvailable; }
+    virtual bool traceLogAppend(const uint8_t *record, size_t length)
+    {
+        if (!flashAvailable || length + 1 > traceLogCapacity)
+        {
+            return false;
+        }
+        // every record costs its length byte
+        traceLogBytes += length + 1;
+        traceLog.push_back(std::vector<uint8_t>(record, record + length));
+        while (traceLogBytes > traceLogCapacity)
+        {
+            traceLogBytes -= traceLog.front().size() + 1;
+            traceLog.pop_front();
+        }
+        return true;
+    }
+    virtual size_t traceLogRead(size_t index, uint8_t *record, size_t size)
+    {
+        if (index >= traceLog.size())
+        {
+            return 0;
+        }
+        size_t n = std::min(size, traceLog[index].size());
+        std::copy(traceLog[index].begin(), traceLog[index].begin() + n, record);
+        return n;
+    }
+    virtual size_t traceLogSize() { return traceLog.size(); }
+
+    virtual bool stateWrite(StateKey key, const uint8_t *data, size_t size)
+    {
+        if (!flashAvailable || size > stateMaxSize)
+        {
+            return false;
+        }
+        stateRecords[key] = std::vector<uint8_t>(data, data + size);
+        ++stateWriteCount;
+        ++stateWriteCounts[key];
+        return true;
+    }
+    virtual size_t stateRead(StateKey key, uint8_t *data, size_t size)
+    {
+        std::map<int, std::vector<uint8_t>>::const_iterator it = stateRecords.find(key);
+        if (!flashAvailable || it == stateRecords.end())
+        {
+            return 0;
+        }
+        std::copy(it->second.begin(), it->second.begin() + std::min(size, it->second.size()), data);
+        return it->second.size();
+    }
+
+    virtual unsigned long getMillis()
+    {
+        advance(millisPerCall);
+        return (unsigned long)simMillis;
+    }
+    virtual void waitHere(unsigned long ms) { advance(ms); }
+
+    virtual int LoRaAvailable() { return (simMillis >= downlinkReadyMillis) ? (int)rxBuffer.size() : 0; }
+    virtual bool LoRaBegin() { return modemAvailable; }
+    virtual std::string LoRaVersion() { return "SimHAL"; }
+    virtual std::string LoRaDeviceEUI() { return "0000000000000000"; }
+    virtual int LoRaRead()
+    {
+        if (!LoRaAvailable())
+        {
+            return -1;
+        }
+        int value = rxBuffer.front();
+        rxBuffer.pop_front();
+        return value;
+    }
+    virtual bool LoRaRestart()
+    {
+        joined = false;
+        dataRate = linkDataRate >= 0 ? 0 : -1;
+        rxBuffer.clear();
+        if (!modemKeepsSession)
+        {
+            session = LoRaSession();
+        }
+        return modemAvailable;
+    }
+    virtual int LoRaJoinOTAA(std::string /*eui*/, std::string /*key*/)
+    {
+        ++joinCount;
+        advance(joinDurationMs);
+        joined = modemAvailable && joinSucceeds;
+        if (!joined)
+        {
+            return 0;
+        }
+        // new session, the network server only knows the last one
+        session.devAddr = 0x26000000ul | (uint32_t)joinCount;
+        std::fill(session.nwkSKey, session.nwkSKey + 16, (uint8_t)joinCount);
+        std::fill(session.appSKey, session.appSKey + 16, (uint8_t)(joinCount + 0x80));
+        session.fCntUp = 0;
+        session.fCntDown = 0;
+        dataRate = linkDataRate >= 0 ? 0 : -1;
+        networkDevAddr = session.devAddr;
+        networkFCntUp = 0;
+        networkHasUplink = false;
+        return 1;
+    }
+    virtual bool LoRaGetSession(LoRaSession *s)
+    {
+        if (!joined)
+        {
+            return false;
+        }
+        *s = session;
+        return true;
+    }
+    virtual int LoRaRestoreSession(const LoRaSession &s)
+    {
+        if (!modemAvailable || session.devAddr == 0 || session.devAddr != s.devAddr ||
+            !std::equal(s.nwkSKey, s.nwkSKey + 16, session.nwkSKey) || !std::equal(s.appSKey, s.appSKey + 16, session.appSKey))
+        {
+            // the modem lost the session (an ABP activation would miss the MAC settings of the join accept)
+            return 0;
+        }
+        // the resume is local, the network server is not involved
+        ++sessionRestoreCount;
+        session.fCntUp = std::max(session.fCntUp, s.fCntUp);
+        session.fCntDown = std::max(session.fCntDown, s.fCntDown);
+        joined = true;
+        dataRate = linkDataRate >= 0 ? 0 : -1;
+        return 1;
+    }
+    virtual void LoRaSetMinPollInterval(unsigned long /*secs*/) {}
+    virtual void LoRaSetPort(uint8_t port) { txPort = port; }
+    virtual bool LoRaSetADR(bool enabled)
+    {
+        adr = enabled;
+        return modemAvailable;
+    }
+    virtual int LoRaGetDataRate() { return dataRate; }
+    virtual void LoRaBeginPacket() { txBuffer.clear(); }
+    virtual size_t LoRaWrite(const uint8_t *msgBuffer, size_t msgSize)
+    {
+        txBuffer.insert(txBuffer.end(), msgBuffer, msgBuffer + msgSize);
+        return msgSize;
+    }
+    virtual int LoRaEndPacket(bool confirmed)
+    {
+        if (dataRate >= 0 && txBuffer.size() > maxPayloadSize(dataRate))
+        {
+            // the modem refuses a payload which is too long for the data rate (nothing is sent)
+            return -1;
+        }
+        unsigned long airtime = uplinkAirtimeMs > 0 ? uplinkAirtimeMs : timeOnAir(txBuffer.size());
+        advance(airtime);
+        if (!joined)
+        {
+            return -1;
+        }
+        airtimeMillis += airtime;
+        uint32_t fCnt = session.fCntUp++;
+        if (!uplinkSucceeds)
+        {
+            return -1;
+        }
+        if (session.devAddr != networkDevAddr || (networkHasUplink && fCnt <= networkFCntUp))
+        {
+            // unknown session or replayed frame counter, the network server drops the uplink silently
+            // (only the acknowledgement of a confirmed uplink is missing)
+            return confirmed ? -1 : (int)txBuffer.size();
+        }
+        networkFCntUp = fCnt;
+        networkHasUplink = true;
+
+        Uplink uplink;
+        uplink.millis = simMillis;
+        uplink.worldEpoch = worldEpoch();
+        uplink.deviceEpoch = rtcGetEpoch();
+        uplink.confirmed = confirmed;
+        uplink.fPort = txPort;
+        uplink.dataRate = dataRate;
+        uplink.payload = txBuffer;
+        uplinks.push_back(uplink);
+        if (adr && linkDataRate >= 0)
+        {
+            // the ADR command is piggybacked on the answer to the uplink
+            dataRate = linkDataRate;
+        }
+
+        // the network answers in the first receive window (RX1 delay after the uplink)
+        std::vector<uint8_t> downlink;
+        if (!queuedDownlinks.empty())
+        {
+            downlink = queuedDownlinks.front();
+            queuedDownlinks.pop_front();
+        }
+        else if (downlinkResponder)
+        {
+            downlink = downlinkResponder(uplink);
+        }
+        if (!downlink.empty())
+        {
+            rxBuffer.assign(downlink.begin(), downlink.end());
+            downlinkReadyMillis = simMillis + downlinkDelayMs;
+            ++downlinkCount;
+            ++session.fCntDown;
+        }
+        return (int)txBuffer.size();
+    }
+
+    virtual int LoRaSleepUntilReceived(unsigned long ms)
+    {
+        // the modem wakes the mcu when the downlink is received (pin interrupts are dispatched, but do not end the wait)
+        uint64_t end = simMillis + ms;
+        if (!rxBuffer.empty() && downlinkReadyMillis < end)
+        {
+            end = std::max(downlinkReadyMillis, simMillis);
+        }
+        uint64_t start = simMillis;
+        advance(end - simMillis);
+        idleMillis += simMillis - start;
+        return LoRaAvailable();
+    }
+
+    virtual void SerialBeginAndWait(unsigned long /*baudrate*/) {}
+    virtual size_t SerialPrintLn(const char *msg)
+    {
+        if (serialSink)
+        {
+            serialSink(std::string(msg));
+        }
+        return strlen(msg) + 2;
+    }
+    virtual size_t SerialWrite(const uint8_t *data, size_t size)
+    {
+        if (serialDataSink)
+        {
+            serialDataSink(data, size);
+        }
+        return size;
+    }
+
+    virtual void digitalWrite(uint8_t pinNumber, unsigned int value) { outputs[pinNumber] = value ? 1 : 0; }
+    virtual int digitalRead(uint8_t pinNumber)
+    {
+        std::map<uint8_t, int>::const_iterator it = digitalInputs.find(pinNumber);
+        return it == digitalInputs.end() ? 0 : it->second;
+    }
+    virtual void pinMode(uint8_t /*pinNumber*/, GPIOPinMode /*pinMode*/) {}
+    virtual void setAnalogReference() {}
+    virtual void analogWrite(uint8_t pinNumber, int value) { outputs[pinNumber] = value; }
+    virtual int analogRead(uint8_t pinNumber)
+    {
+        std::map<uint8_t, int>::const_iterator it = analogInputs.find(pinNumber);
+        return it == analogInputs.end() ? 0 : it->second;
+    }
+
+    virtual void attachInterruptWakeup(uint32_t pin, void (*callback)(void), TriggerMode /*mode*/) { interruptCallbacks[pin] = callback; }
+    virtual void deepSleep(int ms)
+    {
+        uint64_t start = simMillis;
+        bool interrupted = advance(ms > 0 ? (uint64_t)ms : 0ull, true);
+        sleepMillis += simMillis - start;
+        interrupted ? ++interruptWakeUps : ++timerWakeUps;
+    }
+
+private:
+    // virtual time
+    uint32_t worldStartEpoch;
+    uint64_t simMillis = 0;
+    uint64_t sleepMillis = 0;
+    uint64_t idleMillis = 0;
+    unsigned long millisPerCall = 1;
+
+    // rtc (epoch in ms at rtcBaseMillis and drift)
+    uint64_t rtcBaseEpochMs = 946684800000ull;
+    uint64_t rtcBaseMillis = 0;
+    double rtcDriftPpm = 0.0;
+
+    // interrupts
+    std::multimap<uint64_t, uint32_t> pendingInterrupts;
+    std::map<uint32_t, void (*)(void)> interruptCallbacks;
+    uint32_t motionInterruptPin = 0;
+    int motionPowerPin = -1;
+    unsigned long dispatchedInterrupts = 0;
+    unsigned long droppedInterrupts = 0;
+    unsigned long timerWakeUps = 0;
+    unsigned long interruptWakeUps = 0;
+
+    // io
+    std::map<uint8_t, int> outputs;
+    std::map<uint8_t, int> digitalInputs;
+    std::map<uint8_t, int> analogInputs;
+    float temperature = 15.0f;
+    float humidity = 50.0f;
+    std::function<void(const std::string &)> serialSink;
+    std::function<void(const uint8_t *, size_t)> serialDataSink;
+
+    // flash config
+    bool flashAvailable = true;
+    std::string eui = "0000000000000000";
+    std::string key = "00000000000000000000000000000000";
+    bool locationConfigured = false;
+    float locationLatitude = 0.0f;
+    float locationLongitude = 0.0f;
+
+    // event log (same capacity as the flash log of the HAL_Arduino)
+    std::deque<uint32_t> eventLog;
+    size_t eventLogCapacity = 8176;
+
+    // trace log (same capacity as the flash ring of the HAL_Arduino without the sector headers)
+    std::deque<std::vector<uint8_t>> traceLog;
+    size_t traceLogCapacity = 16 * (4096 - 8);
+    size_t traceLogBytes = 0;
+
+    // persistent state records
+    std::map<int, std::vector<uint8_t>> stateRecords;
+    size_t stateWriteCount = 0;
+    std::map<int, size_t> stateWriteCounts;
+
+    // lora modem and network
+    bool modemAvailable = true;
+    bool modemKeepsSession = true;
+    bool joinSucceeds = true;
+    bool joined = false;
+    bool uplinkSucceeds = true;
+    unsigned long joinDurationMs = 6000;
+    unsigned long uplinkAirtimeMs = 0;
+    unsigned long joinCount = 0;
+    unsigned long sessionRestoreCount = 0;
+    LoRaSession session = {0, {0}, {0}, 0, 0};
+    // session of the network server (0 = no session)
+    uint32_t networkDevAddr = 0;
+    uint32_t networkFCntUp = 0;
+    bool networkHasUplink = false;
+    unsigned long downlinkCount = 0;
+    uint64_t airtimeMillis = 0;
+    std::vector<uint8_t> txBuffer;
+    uint8_t txPort = 2;
+    bool adr = false;
+    int dataRate = -1;
+    int linkDataRate = -1;
+    std::deque<uint8_t> rxBuffer;
+    uint64_t downlinkReadyMillis = 0;
+    unsigned long downlinkDelayMs = 1000;
+    std::deque<std::vector<uint8_t>> queuedDownlinks;
+    std::vector<Uplink> uplinks;
+    DownlinkResponder downlinkResponder;
+
+    // time on air at the current data rate (SF7 without a data rate model, like LoRaConnector::getSpreadingFactor())
+    unsigned long timeOnAir(size_t length) const
+    {
+        if (dataRate >= 6)
+        {
+            return AirtimeLedger::getTimeOnAir(length, 7, 250);
+        }
+        return AirtimeLedger::getTimeOnAir(length, dataRate >= 0 ? 12 - dataRate : 7);
+    }
+
+    // EU868 max. application payload size of a data rate (repeater compatible)
+    static size_t maxPayloadSize(int dr) { return dr >= 4 ? 222 : (dr == 3 ? 115 : 51); }
+
+    uint64_t rtcEpochMs() const
+    {
+        uint64_t elapsed = simMillis - rtcBaseMillis;
+        return rtcBaseEpochMs + (uint64_t)((double)elapsed * (1.0 + rtcDriftPpm * 1e-6));
+    }
+
+    std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> rtcTimePoint()
+    {
+        return std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>{std::chrono::seconds{rtcGetEpoch()}};
+    }
+
+    date::hh_mm_ss<std::chrono::seconds> rtcTime()
+    {
+        std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> tp = rtcTimePoint();
+        return date::make_time(tp - date::floor<date::days>(tp));
+    }
+
+    date::year_month_day rtcDate() { return date::year_month_day{date::floor<date::days>(rtcTimePoint())}; }
+
+    bool dispatchInterrupt(uint32_t pin)
+    {
+        std::map<uint32_t, void (*)(void)>::iterator it = interruptCallbacks.find(pin);
+        bool sensorPowered = !(pin == motionInterruptPin && motionPowerPin >= 0 && !getPinValue((uint8_t)motionPowerPin));
+        if (it == interruptCallbacks.end() || it->second == nullptr || !sensorPowered)
+        {
+            ++droppedInterrupts;
+            return false;
+        }
+        ++dispatchedInterrupts;
+        it->second();
+        return true;
+    }
+};
+
+#endif // SIM_HAL_H
@@ -0,0 +1,468 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "sim_hal.hpp"
+#include "energy_hal.hpp"
+#include "flashEventLog.hpp"
+#include "../bikeCounter/bikeCounter.hpp"
+
+namespace
+{
+    const uint32_t worldStart = 1704067200ul; // 01.01.2024 00:00:00
+    int motionCallbacks = 0;
+    void onMotion() { ++motionCallbacks; }
+
+    int payloadCount(const SimHAL::Uplink &uplink) { return uplink.payload.empty() ? 0 : uplink.payload[0]; }
+    uint8_t payloadStatus(const SimHAL::Uplink &uplink) { return uplink.payload[2] & 0x07; }
+
+    // same configuration as BikeCounterPro.ino (LED_BUILTIN = 6, A0 = 15)
+    BikeCounter *setupBikeCounter(HAL *hal)
+    {
+        BikeCounter *bc = BikeCounter::getInstance();
+        bc->injectHal(hal);
+        bc->reset();
+        bc->setCounterInterruptPin(0);
+        bc->setSwitchPowerPin(10);
+        bc->setDebugSwitchPin(7);
+        bc->setConfigSwitchPin(8);
+        bc->setBatteryVoltagePin(15);
+        bc->setPirPowerPin(3);
+        bc->setSyncTimeInterval(120ul);
+        bc->setLedPin(6);
+        bc->setMaxBlinks(50);
+        bc->setMaxCount(1000);
+        return bc;
+    }
+
+    // 20 riders per day between 08:00 and 18:00 UTC
+    void injectDailyTraffic(SimHAL &hal, uint32_t days)
+    {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<uint32_t> daytime(8u * 3600u, 18u * 3600u);
+        for (uint32_t d = 1; d < days; ++d)
+        {
+            for (int i = 0; i < 20; ++i)
+            {
+                hal.injectMotion(worldStart + d * 86400ul + daytime(rng));
+            }
+        }
+    }
+}
+
+// SPI NOR flash in RAM (an erase sets the bytes to 0xff, a write only clears bits)
+class RamFlash : public FlashMemory
+{
+public:
+    explicit RamFlash(size_t size) : memory(size, 0xff) {}
+    virtual uint32_t flashReadWord(uint32_t address)
+    {
+        return ((uint32_t)memory[address + 3] << 24) | ((uint32_t)memory[address + 2] << 16) | ((uint32_t)memory[address + 1] << 8) | memory[address];
+    }
+    virtual void flashWriteWord(uint32_t address, uint32_t value)
+    {
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            flashWriteByte(address + i, (uint8_t)(value >> (8 * i)));
+        }
+    }
+    virtual uint8_t flashReadByte(uint32_t address) { return memory[address]; }
+    virtual void flashWriteByte(uint32_t address, uint8_t value) { memory[address] &= value; }
+    virtual void flashEraseSector(uint32_t address)
+    {
+        ++eraseCount;
+        std::fill(memory.begin() + address, memory.begin() + address + FlashEventLog::sectorSize, 0xff);
+    }
+    unsigned long eraseCount = 0;
+
+private:
+    std::vector<uint8_t> memory;
+};
+
+class SimHALTest : public ::testing::Test
+{
+protected:
+    void SetUp() override { motionCallbacks = 0; }
+};
+
+TEST_F(SimHALTest, VirtualClockTests)
+{
+    SimHAL hal(worldStart);
+    hal.setMillisPerCall(0);
+
+    hal.waitHere(1500);
+    ASSERT_EQ(hal.now(), 1500u);
+    ASSERT_EQ(hal.getMillis(), 1500u);
+
+    hal.deepSleep(60 * 60 * 1000);
+    ASSERT_EQ(hal.now(), 1500u + 3600000u);
+    ASSERT_EQ(hal.getSleepMillis(), 3600000u);
+    ASSERT_EQ(hal.getAwakeMillis(), 1500u);
+    ASSERT_EQ(hal.getTimerWakeUpCount(), 1u);
+
+    // getMillis() costs time by default to keep polling loops moving
+    hal.setMillisPerCall(1);
+    unsigned long t = hal.getMillis();
+    ASSERT_EQ(hal.getMillis(), t + 1);
+}
+
+TEST_F(SimHALTest, RtcTests)
+{
+    SimHAL hal(worldStart);
+
+    hal.rtcBegin(true);
+    ASSERT_EQ(hal.rtcGetEpoch(), 946684800ul);
+    ASSERT_EQ(hal.rtcGetYear(), 0);
+
+    // 2024/03/25 21:47:39
+    hal.rtcSetEpoch(1711403259ul);
+    ASSERT_EQ(hal.rtcGetHours(), 21);
+    ASSERT_EQ(hal.rtcGetMinutes(), 47);
+    ASSERT_EQ(hal.rtcGetSeconds(), 39);
+    ASSERT_EQ(hal.rtcGetDay(), 25);
+    ASSERT_EQ(hal.rtcGetMonth(), 3);
+    ASSERT_EQ(hal.rtcGetYear(), 24);
+
+    // the rtc follows the virtual clock
+    hal.deepSleep(2 * 60 * 60 * 1000);
+    ASSERT_EQ(hal.rtcGetEpoch(), 1711403259ul + 7200ul);
+    ASSERT_EQ(hal.rtcGetDay(), 25);
+    ASSERT_EQ(hal.rtcGetHours(), 23);
+
+    // a fast rtc (100ppm) gains 8.64s per day
+    hal.setRtcDriftPpm(100.0);
+    uint32_t start = hal.rtcGetEpoch();
+    hal.waitHere(24ul * 60ul * 60ul * 1000ul);
+    ASSERT_EQ(hal.rtcGetEpoch(), start + 86400ul + 8ul);
+}
+
+TEST_F(SimHALTest, InterruptTests)
+{
+    SimHAL hal(worldStart);
+    hal.setMotionSensorPins(0, 3);
+    hal.attachInterruptWakeup(0, onMotion, HAL::TriggerMode::RISING);
+
+    // sensor without power -> trigger is dropped
+    hal.injectMotionAtMillis(500);
+    hal.deepSleep(1000);
+    ASSERT_EQ(motionCallbacks, 0);
+    ASSERT_EQ(hal.getDroppedInterruptCount(), 1u);
+    ASSERT_EQ(hal.now(), 1000u);
+
+    // the interrupt wakes the device at the exact time
+    hal.digitalWrite(3, 1);
+    hal.injectMotion(worldStart + 60);
+    hal.deepSleep(10 * 60 * 1000);
+    ASSERT_EQ(motionCallbacks, 1);
+    ASSERT_EQ(hal.now(), 60000u);
+    ASSERT_EQ(hal.getInterruptWakeUpCount(), 1u);
+
+    // interrupts during a delay are dispatched but do not stop it
+    hal.injectMotionAtMillis(61000);
+    hal.injectMotionAtMillis(62000);
+    hal.waitHere(5000);
+    ASSERT_EQ(motionCallbacks, 3);
+    ASSERT_EQ(hal.now(), 65000u);
+}
+
+TEST_F(SimHALTest, LoRaNetworkTests)
+{
+    SimHAL hal(worldStart);
+    ASSERT_TRUE(hal.LoRaBegin());
+
+    // uplink without join fails
+    uint8_t msg[8] = {0};
+    hal.LoRaBeginPacket();
+    hal.LoRaWrite(msg, 8);
+    ASSERT_LE(hal.LoRaEndPacket(false), 0);
+
+    ASSERT_EQ(hal.LoRaJoinOTAA("eui", "key"), 1);
+    ASSERT_EQ(hal.getJoinCount(), 1u);
+
+    // device time 0 minutes (01.01.2022) -> the network sends the time drift
+    hal.LoRaBeginPacket();
+    hal.LoRaWrite(msg, 8);
+    ASSERT_GT(hal.LoRaEndPacket(false), 0);
+    ASSERT_EQ(hal.getUplinks().size(), 1u);
+    ASSERT_EQ(hal.LoRaAvailable(), 0);
+    hal.waitHere(1000);
+    ASSERT_EQ(hal.LoRaAvailable(), 4);
+    int32_t drift = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        drift |= (int32_t)hal.LoRaRead() << (8 * i);
+    }
+    ASSERT_EQ(drift, (int32_t)(hal.getUplinks()[0].worldEpoch - 1640995200ul));
+
+    // the airtime is the time on air of the payload (SF7 without a data rate model)
+    ASSERT_EQ(hal.getAirtimeMillis(), AirtimeLedger::getTimeOnAir(8, 7));
+    hal.setLinkDataRate(0);
+    ASSERT_EQ(hal.LoRaJoinOTAA("eui", "key"), 1);
+    hal.LoRaBeginPacket();
+    hal.LoRaWrite(msg, 8);
+    ASSERT_GT(hal.LoRaEndPacket(false), 0);
+    ASSERT_EQ(hal.getAirtimeMillis(), AirtimeLedger::getTimeOnAir(8, 7) + AirtimeLedger::getTimeOnAir(8, 12));
+}
+
+TEST_F(SimHALTest, YearLongStateMachineTests)
+{
+    SimHAL hal(worldStart);
+    hal.setMotionSensorPins(0, 3);
+    hal.setAnalogInput(15, 950); // ~3.9V battery voltage
+
+    BikeCounter *bc = setupBikeCounter(&hal);
+    const uint32_t days = 366;
+    injectDailyTraffic(hal, days);
+
+    // Arduino runtime: setup() { bc->loop(); } loop() { bc->loop(); }
+    bc->loop();
+    hal.runUntil(worldStart + days * 86400ul, [&]()
+                 {
+                     bc->loop();
+                 });
+
+    ASSERT_EQ(hal.getPendingInterruptCount(), 0u);
+    ASSERT_EQ(hal.getJoinCount(), 1u);
+
+    // the first uplink is a time sync call which is answered by the network
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_GT(uplinks.size(), days * 4);
+    ASSERT_EQ(payloadStatus(uplinks[0]), 7);
+    ASSERT_LE(std::abs((int32_t)(hal.rtcGetEpoch() - hal.worldEpoch())), 15 * 60);
+
+    // every dispatched trigger ends up in exactly one uplink
+    unsigned long counted = 0;
+    for (size_t i = 0; i < uplinks.size(); ++i)
+    {
+        counted += payloadCount(uplinks[i]);
+    }
+    ASSERT_GT(hal.getDispatchedInterruptCount(), 0u);
+    ASSERT_LE(counted, hal.getDispatchedInterruptCount());
+    ASSERT_GE(counted + 60, hal.getDispatchedInterruptCount());
+
+    // the device spends most of the time in deep sleep
+    ASSERT_GT(hal.getSleepMillis(), hal.getAwakeMillis() * 10);
+}
+
+TEST_F(SimHALTest, EnergyAccountingTests)
+{
+    SimHAL sim(worldStart);
+    sim.setMillisPerCall(0);
+    EnergyHAL hal(&sim);
+    hal.setLedPin(6);
+    const EnergyHAL::PowerProfile &p = hal.getProfile();
+
+    // 1h deep sleep
+    hal.deepSleep(60 * 60 * 1000);
+    ASSERT_NEAR(hal.getCharge(EnergyHAL::sleepCategory), p.sleepCurrent * 1000.0, 1e-3);
+    ASSERT_NEAR(hal.getTotalCharge(), p.sleepCurrent * 1000.0, 1e-3);
+
+    // 100ms awake with the LED at full brightness
+    hal.analogWrite(6, 255);
+    hal.waitHere(100);
+    hal.analogWrite(6, 0);
+    ASSERT_NEAR(hal.getCharge(EnergyHAL::ledCategory), p.ledCurrent * 100.0 / 3600.0, 1e-6);
+    ASSERT_NEAR(hal.getCharge(EnergyHAL::mcuCategory), p.mcuActiveCurrent * 100.0 / 3600.0, 1e-6);
+
+    // sensor read
+    hal.AM2320ReadTemperature();
+    ASSERT_NEAR(hal.getCharge(EnergyHAL::sensorCategory), p.sensorCurrent * p.sensorReadTime / 3600.0, 1e-6);
+
+    // uplink: airtime at tx current plus two receive windows
+    sim.setUplinkAirtime(1000);
+    hal.LoRaJoinOTAA("eui", "key");
+    double txBefore = hal.getCharge(EnergyHAL::txCategory);
+    uint8_t msg[8] = {0};
+    hal.LoRaBeginPacket();
+    hal.LoRaWrite(msg, 8);
+    ASSERT_GT(hal.LoRaEndPacket(false), 0);
+    ASSERT_NEAR(hal.getCharge(EnergyHAL::txCategory) - txBefore, p.txCurrent * 1000.0 / 3600.0, 1e-6);
+    ASSERT_GT(hal.getCharge(EnergyHAL::uplinkContext), 0.0);
+    ASSERT_EQ(hal.getReport().uplinks, 1u);
+}
+
+TEST_F(SimHALTest, BatteryLifeEstimationTests)
+{
+    SimHAL sim(worldStart);
+    sim.setMotionSensorPins(0, 3);
+    sim.setAnalogInput(15, 950);
+    EnergyHAL hal(&sim);
+    hal.setLedPin(6);
+    hal.setPirPowerPin(3);
+
+    BikeCounter *bc = setupBikeCounter(&hal);
+    const uint32_t days = 30;
+    injectDailyTraffic(sim, days);
+
+    bc->loop();
+    sim.runUntil(worldStart + days * 86400ul, [&]()
+                 {
+                     bc->loop();
+                 });
+
+    EnergyHAL::Report r = hal.getReport();
+    ASSERT_NEAR(r.days, days, 0.01);
+    ASSERT_GT(r.motionWakeUps, 0u);
+    ASSERT_GT(r.uplinks, days * 4);
+    ASSERT_GT(r.chargePerMotion, 0.0);
+    ASSERT_GT(r.chargePerUplink, r.chargePerMotion);
+    // run to completion: a motion costs only the LED blinks (limited by setMaxBlinks) and no loop delays
+    ASSERT_LT(r.awakePerMotion, 50.0);
+    ASSERT_GT(r.batteryLifeDays, 0.0);
+
+    // categories and contexts account for the same total
+    double categories = 0.0;
+    double contexts = 0.0;
+    for (int i = 0; i < EnergyHAL::categoryCount; ++i)
+    {
+        categories += r.categoryCharge[i];
+    }
+    for (int i = 0; i < EnergyHAL::contextCount; ++i)
+    {
+        contexts += r.contextCharge[i];
+    }
+    ASSERT_NEAR(categories, r.totalCharge, 1e-6 * r.totalCharge);
+    ASSERT_NEAR(contexts, r.totalCharge, 1e-6 * r.totalCharge);
+}
+
+TEST_F(SimHALTest, EventLogTests)
+{
+    SimHAL hal(worldStart);
+    hal.setEventLogCapacity(3);
+    ASSERT_TRUE(hal.eventLogBegin());
+    ASSERT_TRUE(hal.eventLogAppend(worldStart + 1));
+    ASSERT_TRUE(hal.eventLogAppend(worldStart + 2));
+    ASSERT_TRUE(hal.eventLogAppend(worldStart + 3));
+    // the log is full
+    ASSERT_FALSE(hal.eventLogAppend(worldStart + 4));
+    ASSERT_EQ(hal.eventLogSize(), 3u);
+
+    uint32_t epochs[4] = {0};
+    ASSERT_EQ(hal.eventLogRead(1, epochs, 4), 2u);
+    ASSERT_EQ(epochs[0], worldStart + 2);
+    ASSERT_EQ(epochs[1], worldStart + 3);
+
+    // the oldest events are trimmed
+    hal.eventLogTrim(2);
+    ASSERT_EQ(hal.eventLogSize(), 1u);
+    ASSERT_EQ(hal.eventLogRead(0, epochs, 4), 1u);
+    ASSERT_EQ(epochs[0], worldStart + 3);
+    hal.eventLogTrim(5);
+    ASSERT_EQ(hal.eventLogSize(), 0u);
+
+    // no flash, no log
+    hal.setFlashConfig(false);
+    ASSERT_FALSE(hal.eventLogBegin());
+    ASSERT_FALSE(hal.eventLogAppend(worldStart + 5));
+}
+
+TEST(FlashEventLogTest, FullRingTests)
+{
+    // event log of the HAL_Arduino (16 sectors behind the config sector)
+    RamFlash flash(0x11000);
+    FlashEventLog log(&flash, 0x1000, 16);
+    const uint32_t capacity = 16 * FlashEventLog::recordsPerSector;
+    ASSERT_TRUE(log.begin());
+    ASSERT_EQ(log.getCapacity(), (size_t)capacity);
+
+    // a long outage fills the ring, the oldest events are kept
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+        ASSERT_TRUE(log.append(worldStart + i));
+    }
+    ASSERT_FALSE(log.append(worldStart + capacity));
+    ASSERT_EQ(log.size(), (size_t)capacity);
+    ASSERT_EQ(flash.eraseCount, 16ul);
+    uint32_t epoch = 0;
+    ASSERT_EQ(log.read(0, &epoch, 1), 1u);
+    ASSERT_EQ(epoch, worldStart);
+    ASSERT_EQ(log.read(capacity - 1, &epoch, 1), 1u);
+    ASSERT_EQ(epoch, worldStart + capacity - 1);
+
+    // the full ring is recovered after a restart (tail == head)
+    FlashEventLog restarted(&flash, 0x1000, 16);
+    ASSERT_TRUE(restarted.begin());
+    ASSERT_EQ(restarted.size(), (size_t)capacity);
+    ASSERT_EQ(restarted.read(0, &epoch, 1), 1u);
+    ASSERT_EQ(epoch, worldStart);
+    ASSERT_FALSE(restarted.append(worldStart + capacity));
+
+    // the first sector is only reused after all its events are trimmed
+    restarted.trim(FlashEventLog::recordsPerSector - 1);
+    ASSERT_FALSE(restarted.append(worldStart + capacity));
+    restarted.trim(1);
+    ASSERT_TRUE(restarted.append(worldStart + capacity));
+    ASSERT_EQ(restarted.size(), (size_t)(capacity - FlashEventLog::recordsPerSector + 1));
+    ASSERT_EQ(restarted.read(0, &epoch, 1), 1u);
+    ASSERT_EQ(epoch, worldStart + FlashEventLog::recordsPerSector);
+
+    // the wrapped ring after a restart
+    FlashEventLog wrapped(&flash, 0x1000, 16);
+    ASSERT_TRUE(wrapped.begin());
+    ASSERT_EQ(wrapped.size(), restarted.size());
+    ASSERT_EQ(wrapped.read(wrapped.size() - 1, &epoch, 1), 1u);
+    ASSERT_EQ(epoch, worldStart + capacity);
+
+    // an empty ring after everything was trimmed
+    wrapped.trim(capacity);
+    ASSERT_EQ(wrapped.size(), 0u);
+    FlashEventLog empty(&flash, 0x1000, 16);
+    ASSERT_TRUE(empty.begin());
+    ASSERT_EQ(empty.size(), 0u);
+    ASSERT_TRUE(empty.append(worldStart));
+    ASSERT_EQ(empty.size(), 1u);
+}
+
+TEST_F(SimHALTest, TraceLogTests)
+{
+    SimHAL hal(worldStart);
+    // three records of 3 bytes + length byte
+    hal.setTraceLogCapacity(12);
+    ASSERT_TRUE(hal.traceLogBegin());
+    const uint8_t records[4][3] = {{1, 1, 1}, {2, 2, 2}, {3, 3, 3}, {4, 4, 4}};
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_TRUE(hal.traceLogAppend(records[i], 3));
+    }
+    ASSERT_EQ(hal.traceLogSize(), 3u);
+
+    // the oldest record is overwritten
+    ASSERT_TRUE(hal.traceLogAppend(records[3], 3));
+    ASSERT_EQ(hal.traceLogSize(), 3u);
+    uint8_t record[8] = {0};
+    ASSERT_EQ(hal.traceLogRead(0, record, sizeof(record)), 3u);
+    ASSERT_EQ(record[0], 2);
+    ASSERT_EQ(hal.traceLogRead(2, record, 2), 2u);
+    ASSERT_EQ(record[0], 4);
+    ASSERT_EQ(hal.traceLogRead(3, record, sizeof(record)), 0u);
+
+    // no flash, no log
+    hal.setFlashConfig(false);
+    ASSERT_FALSE(hal.traceLogBegin());
+    ASSERT_FALSE(hal.traceLogAppend(records[0], 3));
+}
+
+TEST_F(SimHALTest, StateTests)
+{
+    SimHAL hal(worldStart);
+    uint8_t record[4] = {0};
+    ASSERT_EQ(hal.stateRead(HAL::STATE_RTC_DRIFT, record, sizeof(record)), 0u);
+
+    // the last write wins
+    const uint8_t first[3] = {1, 2, 3};
+    const uint8_t second[4] = {4, 5, 6, 7};
+    ASSERT_TRUE(hal.stateWrite(HAL::STATE_RTC_DRIFT, first, sizeof(first)));
+    ASSERT_TRUE(hal.stateWrite(HAL::STATE_RTC_DRIFT, second, sizeof(second)));
+    ASSERT_EQ(hal.stateRead(HAL::STATE_RTC_DRIFT, record, 2), 4u);
+    ASSERT_EQ(record[0], 4);
+    ASSERT_EQ(record[1], 5);
+    ASSERT_EQ(record[2], 0);
+    ASSERT_EQ(hal.getStateWriteCount(), 2u);
+
+    // records larger than stateMaxSize are rejected
+    uint8_t large[HAL::stateMaxSize + 1] = {0};
+    ASSERT_FALSE(hal.stateWrite(HAL::STATE_RTC_DRIFT, large, sizeof(large)));
+
+    // no flash, no state
+    hal.setFlashConfig(false);
+    ASSERT_EQ(hal.stateRead(HAL::STATE_RTC_DRIFT, record, sizeof(record)), 0u);
+    ASSERT_FALSE(hal.stateWrite(HAL::STATE_RTC_DRIFT, first, sizeof(first)));
+}
@@ -1,6 +1,27 @@
 #include "LoRaConnector.hpp"
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+    void writeWord(uint8_t *buffer, uint32_t value)
+    {
+        buffer[0] = (uint8_t)(value & 0xff);
+        buffer[1] = (uint8_t)((value >> 8) & 0xff);
+        buffer[2] = (uint8_t)((value >> 16) & 0xff);
+        buffer[3] = (uint8_t)(value >> 24);
+    }
+
+    uint32_t readWord(const uint8_t *buffer)
+    {
+        return ((uint32_t)buffer[3] << 24) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[1] << 8) | buffer[0];
+    }
+}
 
 LoRaConnector *LoRaConnector::instance = nullptr;
+const size_t LoRaConnector::maxPayloadSize;
+const int LoRaConnector::queueCapacity;
+const uint8_t LoRaConnector::defaultPort;
 // Thread-save Singleton (not needed for Arduino)
 // std::mutex LoRaConnector::mutex_;
 
@@ -28,10 +49,11 @@ void LoRaConnector::setup(std::string appEui, std::string appKey, int (*downlink
         return;
     };
 
-    logger.push("Module version: " +
-                hal->LoRaVersion());
-    logger.push("Device EUI: " +
-                hal->LoRaDeviceEUI());
+    if (StatusLogger::getInstance()->isEnabled(StatusLogger::Level::info))
+    {
+        LOG_INFO(logger, "Module version: %s", hal->LoRaVersion().c_str());
+        LOG_INFO(logger, "Device EUI: %s", hal->LoRaDeviceEUI().c_str());
+    }
     logger.loop();
 }
 
@@ -62,7 +84,8 @@ void LoRaConnector::loop(unsigned int times)
         }
 
         case connected: // and ready/idle
-            if (sendRequested)
+            currentSlot = nextSlot();
+            if (currentSlot >= 0)
             {
                 currentStatus = transmitting;
             }
@@ -70,9 +93,22 @@ void LoRaConnector::loop(unsigned int times)
 
         case transmitting: // uplink
         {
-            int err = sendData();
+            if (currentSlot < 0)
+            {
+                // the queue was cleared
+                currentStatus = connected;
+                break;
+            }
+            int err = sendData(slots[currentSlot]);
             if (err)
             {
+                // the packet stays enqueued and is sent after reconnecting, unless it is too long for the data
+                // rate (the sender keeps its content and sends it again in smaller packets)
+                if (errorId == 4)
+                {
+                    freeSlot(currentSlot);
+                }
+                currentSlot = -1;
                 currentStatus = error;
             }
             else
@@ -85,20 +121,24 @@ void LoRaConnector::loop(unsigned int times)
 
         case waiting: // downlink
         {
-            if ((hal->getMillis() - t) > downlinkTimeout)
+            // sleep until the modem reports a downlink or the receive windows are closed
+            unsigned long elapsed = hal->getMillis() - t;
+            if (elapsed < downlinkTimeout && !hal->LoRaAvailable())
             {
-                if (hal->LoRaAvailable())
-                {
-                    currentStatus = reading;
-                }
-                else
-                {
-                    logger.push("No downlink massage received.");
-                    logger.loop();
+                hal->LoRaSleepUntilReceived(downlinkTimeout - elapsed);
+            }
+            if (hal->LoRaAvailable())
+            {
+                currentStatus = reading;
+                freeSlot(currentSlot);
+            }
+            else if ((hal->getMillis() - t) >= downlinkTimeout)
+            {
+                LOG_DEBUG(logger, "No downlink massage received.");
+                logger.loop();
 
-                    currentStatus = connected;
-                }
-                sendRequested = 0;
+                currentStatus = connected;
+                freeSlot(currentSlot);
             }
             break;
         }
@@ -111,17 +151,21 @@ void LoRaConnector::loop(unsigned int times)
                 rcv[i++] = hal->LoRaRead();
             }
 
-            std::string os("Received ");
-            for (unsigned int j = 0; j < i; j++)
+            if (StatusLogger::getInstance()->isEnabled(StatusLogger::Level::debug))
             {
-                os.append(std::to_string((rcv[j] >> 4)));
-                os.append(std::to_string((rcv[j] & 0xF)));
-                os.append(" ");
+                // hex dump of the payload (truncated to the max. message length)
+                char os[StatusLogger::maxMessageLength + 1] = "Received ";
+                size_t length = strlen(os);
+                for (int j = 0; j < i && length + 4 <= sizeof(os); j++)
+                {
+                    length += snprintf(os + length, sizeof(os) - length, "%02X ", rcv[j] & 0xFF);
+                }
+                LOG_DEBUG(logger, "%s", os);
             }
-            logger.push(os);
             logger.loop();
 
             // call the downlink callback function and pass the payload
+            uplinksSinceDownlink = 0;
             downlinkCallback(rcv, i);
 
             currentStatus = connected;
@@ -130,7 +174,7 @@ void LoRaConnector::loop(unsigned int times)
 
         case error:
         {
-            logger.push(errorMsg[errorId]);
+            LOG_ERROR(logger, "%s", errorMsg[errorId]);
             logger.loop();
             currentStatus = disconnected;
             break;
@@ -139,6 +183,11 @@ void LoRaConnector::loop(unsigned int times)
         case fatalError:
             break;
         }
+        if (currentStatus == error)
+        {
+            // the caller sees the error before a resumed session retries the enqueued packets
+            break;
+        }
     }
 };
 
@@ -146,66 +195,272 @@ void LoRaConnector::reset()
 {
     hal->LoRaRestart();
     currentStatus = disconnected;
+    sessionFailures = 0;
+    uplinksSinceDownlink = 0;
+    clearQueue();
+    for (int i = 0; i < queueCapacity; ++i)
+    {
+        slotState[i] = slotFree;
+    }
 }
 
 /// @brief Tries to connect to the LoRa WAN network
 /// @return error code
 int LoRaConnector::connectToNetwork()
 {
-    logger.push("Connecting to network.");
+    LOG_INFO(logger, "Connecting to network.");
     logger.loop();
-    int join = hal->LoRaJoinOTAA(eui, key);
-    if (!join)
+    if (sessionFailures < maxSessionFailures && resumeSession())
     {
-        return 1;
+        LOG_INFO(logger, "Session resumed.");
+    }
+    else
+    {
+        int join = hal->LoRaJoinOTAA(eui, key);
+        if (!join)
+        {
+            return 1;
+        }
+        sessionFailures = 0;
+        saveSession();
     }
 
     hal->LoRaSetMinPollInterval(120);
+    hal->LoRaSetADR(adaptiveDataRate);
     // wait for all data transmission to finish
     hal->waitHere(500);
-    logger.push("Successfully connected to network.");
+    LOG_INFO(logger, "Successfully connected to network.");
     logger.loop();
     return 0;
 }
 
-int LoRaConnector::sendMessage(const uint8_t *buffer, size_t size)
+int LoRaConnector::sendMessage(const uint8_t *buffer, size_t size, uint8_t fPort, Priority priority, bool confirmed)
 {
-    if (sendRequested)
+    if (size > maxPayloadSize)
+    {
+        return 2;
+    }
+    Packet *packet = allocatePacket();
+    if (packet == nullptr)
     {
         return 1;
     }
-    if (currentStatus != connected)
+    memcpy(packet->payload, buffer, size);
+    packet->length = (uint8_t)size;
+    packet->fPort = fPort;
+    packet->priority = (uint8_t)priority;
+    packet->confirmed = confirmed;
+    return submitPacket(packet);
+}
+
+LoRaConnector::Packet *LoRaConnector::allocatePacket()
+{
+    for (int i = 0; i < queueCapacity; ++i)
+    {
+        if (slotState[i] == slotFree)
+        {
+            slotState[i] = slotAllocated;
+            slots[i].length = 0;
+            slots[i].fPort = defaultPort;
+            slots[i].priority = normal;
+            slots[i].confirmed = false;
+            return &slots[i];
+        }
+    }
+    return nullptr;
+}
+
+int LoRaConnector::submitPacket(Packet *packet)
+{
+    int slot = (int)(packet - slots);
+    if (slot < 0 || slot >= queueCapacity || slotState[slot] != slotAllocated)
     {
         return 2;
     }
-    msgSize = size;
-    for (int i = 0; i < msgSize; ++i)
+    if (currentStatus == disconnected || currentStatus == connecting || currentStatus == error ||
+        currentStatus == fatalError || packet->length > maxPayloadSize)
     {
-        msgBuffer[i] = buffer[i];
+        slotState[slot] = slotFree;
+        return 2;
     }
-    sendRequested = 1;
-    logger.push("Message enqueued");
+    slotState[slot] = slotQueued;
+    slotSequence[slot] = nextSequence++;
+    ++queuedCount;
+    LOG_DEBUG(logger, "Message enqueued (queue = %d)", queuedCount);
     logger.loop();
     return 0;
 }
 
-int LoRaConnector::sendData()
+void LoRaConnector::releasePacket(Packet *packet)
 {
-    logger.push("Message transmission started");
+    int slot = (int)(packet - slots);
+    if (slot >= 0 && slot < queueCapacity && slotState[slot] == slotAllocated)
+    {
+        slotState[slot] = slotFree;
+    }
+}
+
+void LoRaConnector::clearQueue()
+{
+    for (int i = 0; i < queueCapacity; ++i)
+    {
+        if (slotState[i] == slotQueued)
+        {
+            slotState[i] = slotFree;
+        }
+    }
+    queuedCount = 0;
+    currentSlot = -1;
+}
+
+/// @brief Slot of the next packet (highest priority, oldest first)
+/// @return slot index (-1 = queue empty)
+int LoRaConnector::nextSlot() const
+{
+    int next = -1;
+    for (int i = 0; i < queueCapacity; ++i)
+    {
+        if (slotState[i] != slotQueued)
+        {
+            continue;
+        }
+        if (next < 0 || slots[i].priority > slots[next].priority ||
+            (slots[i].priority == slots[next].priority && (int32_t)(slotSequence[i] - slotSequence[next]) < 0))
+        {
+            next = i;
+        }
+    }
+    return next;
+}
+
+void LoRaConnector::freeSlot(int slot)
+{
+    if (slot >= 0 && slotState[slot] == slotQueued)
+    {
+        slotState[slot] = slotFree;
+        --queuedCount;
+    }
+    currentSlot = -1;
+}
+
+int LoRaConnector::sendData(const Packet &packet)
+{
+    LOG_DEBUG(logger, "Message transmission started");
     logger.loop();
+    int dataRate = getDataRate();
+    if (dataRate >= 0 && packet.length > getMaxPayloadSize(dataRate))
+    {
+        // packet of a faster data rate (the ADR lowered the data rate), the data rate of the ADR is kept
+        // and the packet is not sent (the sender encodes its content into smaller packets)
+        LOG_WARNING(logger, "Packet too long for DR%d (%u bytes)", dataRate, (unsigned int)packet.length);
+        errorId = 4;
+        return 1;
+    }
+    hal->LoRaSetPort(packet.fPort);
     hal->LoRaBeginPacket();
-    hal->LoRaWrite(msgBuffer, msgSize);
-    int err = hal->LoRaEndPacket(false);
+    hal->LoRaWrite(packet.payload, packet.length);
+    // the acknowledgement of a confirmed uplink shows that the network server still knows the session
+    bool confirmed = packet.confirmed || uplinksSinceDownlink >= linkCheckInterval;
+    int err = hal->LoRaEndPacket(confirmed);
 
     if (err > 0)
     {
-        logger.push("Message sent correctly");
+        LOG_DEBUG(logger, "Message sent correctly");
         logger.loop();
+        sessionFailures = 0;
+        uplinksSinceDownlink = confirmed ? 0 : uplinksSinceDownlink + 1;
+        if (++uplinksSinceSave >= sessionSaveInterval)
+        {
+            saveSession();
+        }
         return 0;
     }
     else
     {
         errorId = 3;
+        if (++sessionFailures == maxSessionFailures)
+        {
+            // the session is considered lost, the next connect joins again
+            LOG_WARNING(logger, "Session lost");
+            hal->stateWrite(HAL::STATE_LORA_SESSION, nullptr, 0);
+        }
         return 1;
     }
+}
+
+int LoRaConnector::getDataRate()
+{
+    if (currentStatus == disconnected || currentStatus == connecting || currentStatus == error || currentStatus == fatalError)
+    {
+        return -1;
+    }
+    return hal->LoRaGetDataRate();
+}
+
+int LoRaConnector::getSpreadingFactor()
+{
+    int dataRate = getDataRate();
+    return (dataRate >= 0 && dataRate <= 5) ? 12 - dataRate : 7;
+}
+
+size_t LoRaConnector::getMaxPayloadSize(int dataRate)
+{
+    if (dataRate >= 4)
+    {
+        return 222;
+    }
+    return dataRate == 3 ? 115 : 51;
+}
+
+/// @brief Continues the session of the modem or the session stored in the flash
+/// @return true if a session is active
+bool LoRaConnector::resumeSession()
+{
+    HAL::LoRaSession session;
+    if (hal->LoRaGetSession(&session))
+    {
+        // the modem still has the session (error without restart)
+        return true;
+    }
+
+    uint8_t record[sessionRecordSize];
+    if (hal->stateRead(HAL::STATE_LORA_SESSION, record, sizeof(record)) != sizeof(record))
+    {
+        return false;
+    }
+    session.devAddr = readWord(record);
+    memcpy(session.nwkSKey, record + 4, 16);
+    memcpy(session.appSKey, record + 20, 16);
+    // the uplinks since the last save are unknown
+    session.fCntUp = readWord(record + 36) + sessionSaveInterval;
+    session.fCntDown = readWord(record + 40);
+    if (hal->LoRaRestoreSession(session) != 1)
+    {
+        return false;
+    }
+    // store the skipped counter at once (another restart skips the next counters), the next uplink checks the session
+    saveSession();
+    uplinksSinceDownlink = linkCheckInterval;
+    return true;
+}
+
+/// @brief Stores the session of the modem in the flash
+void LoRaConnector::saveSession()
+{
+    HAL::LoRaSession session;
+    if (!hal->LoRaGetSession(&session))
+    {
+        return;
+    }
+    uint8_t record[sessionRecordSize];
+    writeWord(record, session.devAddr);
+    memcpy(record + 4, session.nwkSKey, 16);
+    memcpy(record + 20, session.appSKey, 16);
+    writeWord(record + 36, session.fCntUp);
+    writeWord(record + 40, session.fCntDown);
+    if (!hal->stateWrite(HAL::STATE_LORA_SESSION, record, sizeof(record)))
+    {
+        LOG_WARNING(logger, "Session not saved");
+    }
+    uplinksSinceSave = 0;
 }
\ No newline at end of file
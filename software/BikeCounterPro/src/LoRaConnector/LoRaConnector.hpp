@@ -3,7 +3,7 @@
 
 #include <string>
 #include "../statusLogger/extendedStatusLogger.hpp"
-#include "../hal/hal_interface.hpp"
+#include "../HAL/hal_interface.hpp"
 
 class LoRaConnector
 {
@@ -25,6 +25,30 @@ public:
         error,
         fatalError
     };
+    // max. payload size of a packet (EU868 DR4 - DR7, see getMaxPayloadSize())
+    static const size_t maxPayloadSize = 222;
+    // number of packet slots of the queue
+    static const int queueCapacity = 4;
+    // application port of the packets (default port of the MKRWAN library)
+    static const uint8_t defaultPort = 2;
+
+    enum Priority
+    {
+        low,
+        normal,
+        high
+    };
+
+    /// @brief Uplink packet in a slot of the queue
+    struct Packet
+    {
+        uint8_t payload[maxPayloadSize];
+        uint8_t length;
+        uint8_t fPort;
+        uint8_t priority;
+        bool confirmed;
+    };
+
     void injectHal(HAL *hal_ptr) { hal = hal_ptr; }
     Status getStatus() { return currentStatus; }
     int getErrorId() { return errorId; }
@@ -34,13 +58,44 @@ public:
     void setup(std::string appEui, std::string appKey, int (*downlinkCallbackFunction)(int *, int));
     void loop(unsigned int times = 1u);
     void reset();
-    /// @brief
+    /// @brief Copies a message into a free slot of the queue
     /// @param buffer
     /// @param size
+    /// @param fPort application port
+    /// @param priority packets with a higher priority are sent first, the same priority is sent in order
+    /// @param confirmed confirmed uplink
     /// @return 0 = message enqueued and ready to send;
-    ///         1 = already another message enqueued (only one message can be sent at the time)
+    ///         1 = queue full
     ///         2 = error
-    int sendMessage(const uint8_t *buffer, size_t size);
+    int sendMessage(const uint8_t *buffer, size_t size, uint8_t fPort = defaultPort, Priority priority = normal, bool confirmed = false);
+    /// @brief Reserves a free slot, the caller writes the packet into it and hands it over with submitPacket()
+    /// @return Packet* nullptr if the queue is full (initialized with an empty payload, defaultPort and normal priority)
+    Packet *allocatePacket();
+    /// @brief Hands an allocated packet over to the queue, the slot is released after the transmission
+    /// @return 0 = packet enqueued; 2 = error (not connected or invalid length, the slot is released)
+    int submitPacket(Packet *packet);
+    /// @brief Releases an allocated packet without sending it
+    void releasePacket(Packet *packet);
+    /// @brief Discards all enqueued packets (they are not retried after an error)
+    void clearQueue();
+    /// @brief Number of enqueued packets (incl. the packet in transmission)
+    int getQueueSize() const { return queuedCount; }
+
+    /// @brief RX1 delay of the network server in ms (The Things Stack: 5s, LoRaWAN default: 1s)
+    /// The connector waits for a downlink until the RX2 window (1s after RX1) is closed.
+    void setRx1Delay(unsigned long ms) { downlinkTimeout = ms + rx2WindowSpan; }
+    unsigned long getDownlinkTimeout() const { return downlinkTimeout; }
+
+    /// @brief Lets the network server adjust the data rate (enabled by default, applied at the next connect)
+    void setAdaptiveDataRate(bool enabled) { adaptiveDataRate = enabled; }
+    /// @brief Current data rate of the modem (EU868 DR0 - DR7, -1 = unknown or not connected)
+    int getDataRate();
+    /// @brief Spreading factor of the current data rate (7 if the data rate is unknown)
+    int getSpreadingFactor();
+    /// @brief Max. payload size of the current data rate (51 bytes if the data rate is unknown)
+    size_t getMaxPayloadSize() { return getMaxPayloadSize(getDataRate()); }
+    /// @brief EU868 max. payload size of a data rate (51 bytes at DR0 - DR2, 115 at DR3, 222 from DR4)
+    static size_t getMaxPayloadSize(int dataRate);
 
 protected:
     LoRaConnector() {}
@@ -57,19 +112,57 @@ private:
     std::string eui;
     std::string key;
     int errorId = 0;
-    int sendRequested = 0;
-    uint8_t msgBuffer[51] = {0};
-    size_t msgSize = 0;
+
+    // packet slots, the queue order is the priority and the sequence number of the submit
+    enum SlotState
+    {
+        slotFree,
+        slotAllocated,
+        slotQueued
+    };
+    Packet slots[queueCapacity];
+    uint8_t slotState[queueCapacity] = {slotFree};
+    uint32_t slotSequence[queueCapacity] = {0};
+    uint32_t nextSequence = 0;
+    int queuedCount = 0;
+    // slot in transmission (-1 = none)
+    int currentSlot = -1;
+    int nextSlot() const;
+    void freeSlot(int slot);
+
+    bool adaptiveDataRate = true;
+
     int connectToNetwork();
-    int sendData();
+    int sendData(const Packet &packet);
+
+    // The session of the last join is stored in the flash and resumed after a restart or an error instead of a new join.
+    // The frame counter is only saved every sessionSaveInterval uplinks, a resumed session skips that many counters
+    // so the network server never sees a counter twice. A new join is only done after maxSessionFailures failed uplinks.
+    // An unconfirmed uplink is also reported as sent if the network server dropped the session (device registered
+    // again, session expired or frame counter rejected), so the uplink after linkCheckInterval uplinks without any
+    // downlink and the first uplink of a resumed session are sent confirmed: a missing acknowledgement counts as a failure.
+    static const uint32_t sessionSaveInterval = 16;
+    static const int maxSessionFailures = 3;
+    static const uint32_t linkCheckInterval = 32;
+    static const size_t sessionRecordSize = 44;
+    uint32_t uplinksSinceSave = 0;
+    uint32_t uplinksSinceDownlink = 0;
+    int sessionFailures = 0;
+    bool resumeSession();
+    void saveSession();
     unsigned long t;
-    unsigned long downlinkTimeout = 10000;
+    // The Things Stack answers with an RX1 delay of 5s, the RX2 window opens 1s later and a downlink on SF12
+    // takes up to ~1.5s (a downlink which arrives after the wait is lost in the following sleep)
+    static const unsigned long defaultRx1Delay = 5000;
+    static const unsigned long rx2WindowSpan = 3000;
+    unsigned long downlinkTimeout = defaultRx1Delay + rx2WindowSpan;
     int (*downlinkCallback)(int *, int);
     // error messages corresponding to the errorId
-    char *errorMsg[4] = {"No error",
-                         "Failed to start module",
-                         "Failed to connect to LoRa network",
-                         "Error sending message"};
+    const char *errorMsg[5] = {"No error",
+                               "Failed to start module",
+                               "Failed to connect to LoRa network",
+                               "Error sending message",
+                               "Packet too long for the data rate"};
 };
 
 #endif // LORACONNECTOR_H
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include <benchmark/benchmark.h>
+#include "LoRaConnector.hpp"
+#include "../HAL/sim_hal.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+namespace
+{
+    int onDownlink(int *buffer, int length)
+    {
+        benchmark::DoNotOptimize(buffer);
+        return length;
+    }
+}
+
+// enqueue a message and run the connector until it is sent
+static void BM_SendCycle(benchmark::State &state)
+{
+    SimHAL hal;
+    StatusLogger::getInstance()->setup(StatusLogger::Output::noOutput, &hal);
+    LoRaConnector *connector = LoRaConnector::getInstance();
+    connector->injectHal(&hal);
+    connector->reset();
+    connector->setup("eui", "key", &onDownlink);
+    connector->loop(2);
+
+    uint8_t msg[51] = {0};
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        connector->sendMessage(msg, sizeof(msg));
+        do
+        {
+            connector->loop();
+        } while (connector->getStatus() != LoRaConnector::Status::connected &&
+                 connector->getStatus() != LoRaConnector::Status::disconnected);
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+    hal.clearUplinks();
+}
+BENCHMARK(BM_SendCycle);
@@ -0,0 +1,398 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "LoRaConnector.hpp"
+#include "../HAL/sim_hal.hpp"
+
+namespace
+{
+    std::vector<int> receivedDownlink;
+    int onDownlink(int *buffer, int length)
+    {
+        receivedDownlink.assign(buffer, buffer + length);
+        return 0;
+    }
+}
+
+class LoRaConnectorTest : public ::testing::Test
+{
+protected:
+    SimHAL hal;
+    LoRaConnector *connector = LoRaConnector::getInstance();
+
+    void SetUp() override
+    {
+        receivedDownlink.clear();
+        hal.setDownlinkResponder(nullptr);
+        StatusLogger::getInstance()->setup(StatusLogger::Output::noOutput, &hal);
+        connector->injectHal(&hal);
+        connector->reset();
+        connector->setAdaptiveDataRate(true);
+        connector->setup("eui", "key", &onDownlink);
+    }
+
+    // runs the connector loop until the queue is sent (or the timeout is reached)
+    void runUntilIdle(unsigned long timeoutMs = 60000)
+    {
+        uint64_t end = hal.now() + timeoutMs;
+        do
+        {
+            connector->loop();
+            hal.waitHere(50);
+        } while ((connector->getStatus() != LoRaConnector::Status::connected || connector->getQueueSize() > 0) &&
+                 connector->getStatus() != LoRaConnector::Status::disconnected &&
+                 hal.now() < end);
+    }
+};
+
+TEST_F(LoRaConnectorTest, ConnectTests)
+{
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::disconnected);
+    connector->loop(2);
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    ASSERT_EQ(hal.getJoinCount(), 1u);
+}
+
+TEST_F(LoRaConnectorTest, JoinErrorTests)
+{
+    hal.setJoinResult(false);
+    connector->loop(2);
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::error);
+    ASSERT_EQ(connector->getErrorId(), 2);
+
+    // the error state falls back to disconnected and retries
+    connector->loop();
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::disconnected);
+}
+
+TEST_F(LoRaConnectorTest, SendMessageTests)
+{
+    uint8_t msg[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+    // not connected
+    ASSERT_EQ(connector->sendMessage(msg, 10), 2);
+
+    connector->loop(2);
+    ASSERT_EQ(connector->sendMessage(msg, 10), 0);
+    // messages are queued while another one is in transmission
+    ASSERT_EQ(connector->sendMessage(msg, 5), 0);
+    ASSERT_EQ(connector->getQueueSize(), 2);
+
+    runUntilIdle();
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    ASSERT_EQ(connector->getQueueSize(), 0);
+    ASSERT_EQ(hal.getUplinks().size(), 2u);
+    ASSERT_EQ(hal.getUplinks()[0].payload, std::vector<uint8_t>(msg, msg + 10));
+    ASSERT_EQ(hal.getUplinks()[1].payload, std::vector<uint8_t>(msg, msg + 5));
+    ASSERT_EQ(hal.getUplinks()[0].fPort, LoRaConnector::defaultPort);
+    ASSERT_TRUE(receivedDownlink.empty());
+
+    // too long
+    uint8_t large[LoRaConnector::maxPayloadSize + 1] = {0};
+    ASSERT_EQ(connector->sendMessage(large, sizeof(large)), 2);
+    ASSERT_EQ(connector->getQueueSize(), 0);
+}
+
+TEST_F(LoRaConnectorTest, QueueTests)
+{
+    connector->loop(2);
+
+    // the queue holds queueCapacity packets
+    for (uint8_t i = 0; i < LoRaConnector::queueCapacity; ++i)
+    {
+        LoRaConnector::Priority priority = i == 2 ? LoRaConnector::Priority::high : LoRaConnector::Priority::normal;
+        ASSERT_EQ(connector->sendMessage(&i, 1, 10 + i, priority, i == 3), 0);
+    }
+    uint8_t msg = 0xff;
+    ASSERT_EQ(connector->sendMessage(&msg, 1), 1);
+    ASSERT_EQ(connector->allocatePacket(), nullptr);
+
+    // the high priority packet first, then in order
+    runUntilIdle();
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_EQ(uplinks.size(), 4u);
+    const uint8_t order[4] = {2, 0, 1, 3};
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_EQ(uplinks[i].payload[0], order[i]);
+        ASSERT_EQ(uplinks[i].fPort, 10 + order[i]);
+        ASSERT_EQ(uplinks[i].confirmed, order[i] == 3);
+    }
+
+    // the packet is written into the slot and handed over
+    LoRaConnector::Packet *packet = connector->allocatePacket();
+    ASSERT_NE(packet, nullptr);
+    packet->payload[0] = 0x42;
+    packet->length = 1;
+    ASSERT_EQ(connector->submitPacket(packet), 0);
+    // a released slot is not sent
+    connector->releasePacket(connector->allocatePacket());
+    ASSERT_EQ(connector->getQueueSize(), 1);
+    runUntilIdle();
+    ASSERT_EQ(hal.getUplinks().size(), 5u);
+    ASSERT_EQ(hal.getUplinks()[4].payload, std::vector<uint8_t>({0x42}));
+
+    // a cleared packet is not sent
+    ASSERT_EQ(connector->sendMessage(&msg, 1), 0);
+    connector->clearQueue();
+    runUntilIdle();
+    ASSERT_EQ(hal.getUplinks().size(), 5u);
+}
+
+TEST_F(LoRaConnectorTest, DownlinkTests)
+{
+    uint8_t msg[8] = {0};
+    hal.queueDownlink({0x10, 0x20, 0x30, 0x40});
+
+    connector->loop(2);
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+
+    ASSERT_EQ(receivedDownlink, std::vector<int>({0x10, 0x20, 0x30, 0x40}));
+}
+
+TEST_F(LoRaConnectorTest, RxWindowTests)
+{
+    uint8_t msg[8] = {0};
+    connector->loop(2);
+
+    // no downlink: the mcu idles until the receive windows are closed
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    ASSERT_LE(hal.now() - hal.getUplinks()[0].millis, 8200u);
+    ASSERT_GE(hal.getIdleMillis(), 7800u);
+
+    // the downlink in the first receive window ends the wait
+    hal.queueDownlink({0x01, 0x02});
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(receivedDownlink, std::vector<int>({0x01, 0x02}));
+    ASSERT_LE(hal.now() - hal.getUplinks()[1].millis, 1200u);
+}
+
+TEST_F(LoRaConnectorTest, Rx1DelayTests)
+{
+    // The Things Stack answers 5s after the uplink (RX1 delay), RX2 opens 6s after it
+    uint8_t msg[8] = {0};
+    hal.setDownlinkDelay(5000);
+    connector->loop(2);
+    hal.queueDownlink({0x03, 0x04});
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(receivedDownlink, std::vector<int>({0x03, 0x04}));
+    ASSERT_GE(hal.now() - hal.getUplinks()[0].millis, 5000u);
+    ASSERT_LE(hal.now() - hal.getUplinks()[0].millis, 5200u);
+
+    // a downlink in the RX2 window is received as well
+    hal.setDownlinkDelay(6000);
+    hal.queueDownlink({0x05});
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(receivedDownlink, std::vector<int>({0x05}));
+
+    // a network with the LoRaWAN default RX1 delay (1s) ends the wait earlier
+    connector->setRx1Delay(1000);
+    ASSERT_EQ(connector->getDownlinkTimeout(), 4000ul);
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_LE(hal.now() - hal.getUplinks()[2].millis, 4200u);
+    connector->setRx1Delay(5000);
+}
+
+TEST_F(LoRaConnectorTest, SendErrorTests)
+{
+    uint8_t msg[8] = {0};
+    connector->loop(2);
+    hal.setUplinkResult(false);
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    connector->loop(2);
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::error);
+    ASSERT_EQ(connector->getErrorId(), 3);
+
+    // the message stays enqueued and is sent after reconnecting
+    hal.setUplinkResult(true);
+    connector->loop(3);
+    runUntilIdle();
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    ASSERT_EQ(hal.getUplinks().size(), 1u);
+    // the modem keeps the session, no new join
+    ASSERT_EQ(hal.getJoinCount(), 1u);
+}
+
+TEST_F(LoRaConnectorTest, SessionResumeTests)
+{
+    uint8_t msg[8] = {0};
+    connector->loop(2);
+    ASSERT_EQ(hal.getJoinCount(), 1u);
+    for (int i = 0; i < 20; ++i)
+    {
+        ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+        runUntilIdle();
+    }
+    ASSERT_EQ(hal.getUplinks().size(), 20u);
+
+    // a restart resumes the stored session, the unsaved frame counters are skipped
+    connector->reset();
+    connector->loop(2);
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    ASSERT_EQ(hal.getJoinCount(), 1u);
+    ASSERT_EQ(hal.getSessionRestoreCount(), 1u);
+    ASSERT_EQ(hal.getSession().fCntUp, 32u);
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(hal.getUplinks().size(), 21u);
+    // the first uplink of the resumed session checks it
+    ASSERT_TRUE(hal.getUplinks().back().confirmed);
+
+    // a second restart before the next save does not reuse a counter
+    connector->reset();
+    connector->loop(2);
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(hal.getUplinks().size(), 22u);
+    ASSERT_EQ(hal.getJoinCount(), 1u);
+}
+
+TEST_F(LoRaConnectorTest, ModemResetTests)
+{
+    uint8_t msg[8] = {0};
+    hal.setModemKeepsSession(false);
+    hal.setDownlinkDelay(5000);
+    connector->loop(2);
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+
+    // the modem lost the session with the settings of the join accept, the connector joins again
+    connector->reset();
+    connector->loop(2);
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    ASSERT_EQ(hal.getSessionRestoreCount(), 0u);
+    ASSERT_EQ(hal.getJoinCount(), 2u);
+
+    // the downlinks of the new session are received
+    hal.queueDownlink(std::vector<uint8_t>(1, 0x42));
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(hal.getUplinks().size(), 2u);
+    ASSERT_EQ(receivedDownlink.size(), 1u);
+    hal.setModemKeepsSession(true);
+}
+
+TEST_F(LoRaConnectorTest, LinkCheckTests)
+{
+    uint8_t msg[8] = {0};
+    connector->loop(2);
+
+    // the uplink after 32 uplinks without a downlink is confirmed
+    for (int i = 0; i < 34; ++i)
+    {
+        ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+        runUntilIdle();
+    }
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_EQ(uplinks.size(), 34u);
+    for (int i = 0; i < 34; ++i)
+    {
+        ASSERT_EQ(uplinks[i].confirmed, i == 32);
+    }
+
+    // a downlink also shows that the session is known
+    hal.setDownlinkResponder([](const SimHAL::Uplink &) { return std::vector<uint8_t>(1, 0x42); });
+    for (int i = 0; i < 40; ++i)
+    {
+        ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+        runUntilIdle();
+        ASSERT_FALSE(uplinks.back().confirmed);
+    }
+}
+
+TEST_F(LoRaConnectorTest, SessionLossTests)
+{
+    uint8_t msg[8] = {0};
+    connector->loop(2);
+    hal.forgetSession();
+
+    // the network server drops the unconfirmed uplinks silently
+    for (int i = 0; i < 32; ++i)
+    {
+        ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+        runUntilIdle();
+        ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    }
+    ASSERT_EQ(hal.getUplinks().size(), 0u);
+
+    // the next uplink is confirmed, the session is dropped after 3 missing acknowledgements and the next connect joins again
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_EQ(hal.getJoinCount(), 1u);
+        runUntilIdle();
+        ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::disconnected);
+        connector->loop(2);
+    }
+    ASSERT_EQ(hal.getJoinCount(), 2u);
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    // the enqueued message is sent with the new session
+    runUntilIdle();
+    ASSERT_EQ(hal.getUplinks().size(), 1u);
+    ASSERT_TRUE(hal.getUplinks()[0].confirmed);
+
+    // a restart resumes the new session
+    connector->reset();
+    connector->loop(2);
+    ASSERT_EQ(hal.getJoinCount(), 2u);
+}
+
+TEST_F(LoRaConnectorTest, DataRateTests)
+{
+    uint8_t msg[LoRaConnector::maxPayloadSize] = {0};
+    ASSERT_EQ(LoRaConnector::getMaxPayloadSize(0), 51u);
+    ASSERT_EQ(LoRaConnector::getMaxPayloadSize(3), 115u);
+    ASSERT_EQ(LoRaConnector::getMaxPayloadSize(5), 222u);
+
+    // the join starts at DR0, the ADR of the network raises the data rate after the first uplink
+    hal.setLinkDataRate(5);
+    ASSERT_EQ(connector->getDataRate(), -1);
+    connector->loop(2);
+    ASSERT_EQ(connector->getDataRate(), 0);
+    ASSERT_EQ(connector->getSpreadingFactor(), 12);
+    ASSERT_EQ(connector->getMaxPayloadSize(), 51u);
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(connector->getDataRate(), 5);
+    ASSERT_EQ(connector->getSpreadingFactor(), 7);
+    ASSERT_EQ(connector->getMaxPayloadSize(), 222u);
+    ASSERT_EQ(connector->sendMessage(msg, sizeof(msg)), 0);
+    runUntilIdle();
+    ASSERT_EQ(hal.getUplinks().size(), 2u);
+    ASSERT_EQ(hal.getUplinks()[0].dataRate, 0);
+    ASSERT_EQ(hal.getUplinks()[1].dataRate, 5);
+    ASSERT_EQ(hal.getUplinks()[1].payload.size(), sizeof(msg));
+}
+
+TEST_F(LoRaConnectorTest, FixedDataRateTests)
+{
+    uint8_t msg[LoRaConnector::maxPayloadSize] = {0};
+    hal.setLinkDataRate(5);
+    connector->setAdaptiveDataRate(false);
+    connector->loop(2);
+    ASSERT_EQ(connector->sendMessage(msg, 8), 0);
+    runUntilIdle();
+    ASSERT_EQ(connector->getDataRate(), 0);
+
+    // a packet of a larger budget is not sent, the data rate is kept
+    ASSERT_EQ(connector->sendMessage(msg, 100), 0);
+    runUntilIdle();
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::disconnected);
+    ASSERT_EQ(connector->getErrorId(), 4);
+    ASSERT_EQ(connector->getQueueSize(), 0);
+    ASSERT_EQ(hal.getUplinks().size(), 1u);
+
+    // the next packet which fits is sent on the same data rate
+    connector->loop(2);
+    ASSERT_EQ(connector->sendMessage(msg, 51), 0);
+    runUntilIdle();
+    ASSERT_EQ(connector->getStatus(), LoRaConnector::Status::connected);
+    ASSERT_EQ(hal.getUplinks().size(), 2u);
+    ASSERT_EQ(hal.getUplinks()[1].dataRate, 0);
+}
@@ -0,0 +1,129 @@
+#include "airtimeLedger.hpp"
+
+const int AirtimeLedger::subBandCount;
+const int AirtimeLedger::dutyCyclePercent;
+const uint32_t AirtimeLedger::windowSeconds;
+const int AirtimeLedger::maxRecords;
+
+unsigned long AirtimeLedger::getTimeOnAir(size_t payloadLength, int sf, unsigned int bandwidth, int codingRate)
+{
+    // symbol time in us
+    unsigned long symbolTime = (1ul << sf) * 1000ul / bandwidth;
+    // low data rate optimization for symbols of 16ms and longer (SF11 and SF12 at 125kHz)
+    int de = symbolTime >= 16000ul ? 1 : 0;
+    // PHY payload: MHDR (1) + FHDR (7) + FPort (1) + payload + MIC (4)
+    long bits = 8l * (long)(payloadLength + 13) - 4l * sf + 28l + 16l;
+    long bitsPerSymbol = 4l * (sf - 2 * de);
+    long payloadSymbols = 8l + (bits > 0 ? (bits + bitsPerSymbol - 1) / bitsPerSymbol : 0l) * (4l + codingRate);
+    // 8 + 4.25 preamble symbols
+    unsigned long timeOnAir = (49ul * symbolTime) / 4ul + (unsigned long)payloadSymbols * symbolTime;
+    return (timeOnAir + 999ul) / 1000ul;
+}
+
+int AirtimeLedger::record(uint32_t epoch, unsigned long timeOnAir)
+{
+    int subBand = 0;
+    for (int i = 1; i < subBandCount; ++i)
+    {
+        if (getUsed(i, epoch) < getUsed(subBand, epoch))
+        {
+            subBand = i;
+        }
+    }
+    removeExpired(subBand, epoch);
+    Record *band = records[subBand];
+    if (recordCount[subBand] == maxRecords)
+    {
+        // merge the two oldest bookings
+        band[1].timeOnAir += band[0].timeOnAir;
+        for (int i = 1; i < maxRecords; ++i)
+        {
+            band[i - 1] = band[i];
+        }
+        --recordCount[subBand];
+    }
+    band[recordCount[subBand]].epoch = epoch;
+    band[recordCount[subBand]].timeOnAir = timeOnAir;
+    ++recordCount[subBand];
+
+    totalAirtime += timeOnAir;
+    ++uplinkCount;
+    unsigned long used = getUsed(subBand, epoch);
+    if (used > peakUsage)
+    {
+        peakUsage = used;
+    }
+    return subBand;
+}
+
+unsigned long AirtimeLedger::getUsed(int subBand, uint32_t epoch) const
+{
+    unsigned long used = 0;
+    for (int i = 0; i < recordCount[subBand]; ++i)
+    {
+        if (!isExpired(records[subBand][i], epoch))
+        {
+            used += records[subBand][i].timeOnAir;
+        }
+    }
+    return used;
+}
+
+uint32_t AirtimeLedger::getWaitTime(uint32_t epoch, unsigned long timeOnAir) const
+{
+    if (timeOnAir > getBudget())
+    {
+        return windowSeconds;
+    }
+    uint32_t wait = windowSeconds;
+    for (int subBand = 0; subBand < subBandCount; ++subBand)
+    {
+        unsigned long used = getUsed(subBand, epoch);
+        if (used + timeOnAir <= getBudget())
+        {
+            return 0;
+        }
+        // the oldest bookings expire first
+        unsigned long freed = 0;
+        for (int i = 0; i < recordCount[subBand]; ++i)
+        {
+            const Record &r = records[subBand][i];
+            if (isExpired(r, epoch))
+            {
+                continue;
+            }
+            freed += r.timeOnAir;
+            if (used - freed + timeOnAir <= getBudget())
+            {
+                uint32_t expiry = epoch >= r.epoch ? windowSeconds - (epoch - r.epoch) : windowSeconds;
+                wait = expiry < wait ? expiry : wait;
+                break;
+            }
+        }
+    }
+    return wait;
+}
+
+void AirtimeLedger::clear()
+{
+    for (int i = 0; i < subBandCount; ++i)
+    {
+        recordCount[i] = 0;
+    }
+    totalAirtime = 0;
+    uplinkCount = 0;
+    peakUsage = 0;
+}
+
+void AirtimeLedger::removeExpired(int subBand, uint32_t epoch)
+{
+    int count = 0;
+    for (int i = 0; i < recordCount[subBand]; ++i)
+    {
+        if (!isExpired(records[subBand][i], epoch))
+        {
+            records[subBand][count++] = records[subBand][i];
+        }
+    }
+    recordCount[subBand] = count;
+}
@@ -0,0 +1,87 @@
+#ifndef AIRTIMELEDGER_H
+#define AIRTIMELEDGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Time on air of the uplinks and the EU868 duty cycle per sub-band
+ * The ledger books the time on air of every uplink to a sub-band and keeps the bookings of the last hour, the
+ * duty cycle (1%) limits the airtime of a sub-band in any window of one hour to 36s. The modem does not report
+ * the channel of an uplink, it skips the channels of a blocked sub-band, so an uplink is booked to the sub-band
+ * with the most airtime left. An uplink can be sent as soon as one sub-band has enough airtime left.
+ */
+class AirtimeLedger
+{
+public:
+    // sub-bands of the EU868 default channels: 867.1 - 867.9 MHz (band g) and 868.1 - 868.5 MHz (band g1)
+    static const int subBandCount = 2;
+    // duty cycle of the sub-bands in percent
+    static const int dutyCyclePercent = 1;
+    // time span of the duty cycle
+    static const uint32_t windowSeconds = 60ul * 60ul;
+    // bookings per sub-band, older bookings are merged (their airtime expires later, never earlier)
+    static const int maxRecords = 16;
+
+    /**
+     * @brief Time on air of a LoRaWAN uplink (13 bytes header and MIC, 8 symbols preamble, explicit header, CRC)
+     * @param payloadLength application payload length in bytes (e.g. DataPackage::getPayloadLength())
+     * @param sf spreading factor 7 - 12
+     * @param bandwidth kHz (125, 250 or 500)
+     * @param codingRate 1 - 4 (4/5 - 4/8)
+     * @return unsigned long time on air in ms (rounded up)
+     */
+    static unsigned long getTimeOnAir(size_t payloadLength, int sf, unsigned int bandwidth = 125, int codingRate = 1);
+    /// @brief Airtime of a sub-band per window in ms
+    static unsigned long getBudget() { return windowSeconds * 10ul * dutyCyclePercent; }
+
+    /**
+     * @brief Books a sent uplink
+     * @param epoch time of the transmission (RTC)
+     * @param timeOnAir ms
+     * @return int sub-band of the booking
+     */
+    int record(uint32_t epoch, unsigned long timeOnAir);
+    /**
+     * @brief Airtime of a sub-band in the window before epoch
+     * @param subBand 0 - subBandCount - 1
+     * @param epoch current time (RTC)
+     * @return unsigned long ms
+     */
+    unsigned long getUsed(int subBand, uint32_t epoch) const;
+    /**
+     * @brief Time until an uplink is allowed
+     * @param epoch current time (RTC)
+     * @param timeOnAir ms of the uplink
+     * @return uint32_t seconds (0 = the uplink can be sent now)
+     */
+    uint32_t getWaitTime(uint32_t epoch, unsigned long timeOnAir) const;
+    /// @brief Removes all bookings and the statistics
+    void clear();
+
+    /// @brief Airtime of all booked uplinks in ms
+    unsigned long getTotalAirtime() const { return totalAirtime; }
+    /// @brief Number of booked uplinks
+    unsigned long getUplinkCount() const { return uplinkCount; }
+    /// @brief Max. airtime of a sub-band in a window in ms (compare with getBudget())
+    unsigned long getPeakUsage() const { return peakUsage; }
+
+private:
+    struct Record
+    {
+        uint32_t epoch;
+        unsigned long timeOnAir;
+    };
+    // bookings per sub-band, oldest first
+    Record records[subBandCount][maxRecords];
+    int recordCount[subBandCount] = {0};
+    unsigned long totalAirtime = 0;
+    unsigned long uplinkCount = 0;
+    unsigned long peakUsage = 0;
+
+    // a booking is in the window until windowSeconds after it (a booking after epoch means the rtc was set back)
+    static bool isExpired(const Record &r, uint32_t epoch) { return epoch >= r.epoch && epoch - r.epoch >= windowSeconds; }
+    void removeExpired(int subBand, uint32_t epoch);
+};
+
+#endif // AIRTIMELEDGER_H
@@ -0,0 +1,21 @@
+#include <benchmark/benchmark.h>
+#include "airtimeLedger.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+// send decision and booking of an uplink (one package)
+static void BM_RecordUplink(benchmark::State &state)
+{
+    AirtimeLedger ledger;
+    uint32_t epoch = 1717200000ul;
+
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        unsigned long timeOnAir = AirtimeLedger::getTimeOnAir((size_t)state.range(0), 9);
+        benchmark::DoNotOptimize(ledger.getWaitTime(epoch, timeOnAir));
+        ledger.record(epoch, timeOnAir);
+        epoch += 60;
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_RecordUplink)->Arg(11)->Arg(51)->Arg(222);
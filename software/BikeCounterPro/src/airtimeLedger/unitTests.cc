@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "airtimeLedger.hpp"
+
+namespace
+{
+    // 01.06.2024 00:00:00
+    const uint32_t start = 1717200000ul;
+}
+
+TEST(AirtimeLedgerTests, TimeOnAirTests)
+{
+    // reference values of the LoRa calculator (explicit header, CRC, 8 symbols preamble)
+    ASSERT_EQ(AirtimeLedger::getTimeOnAir(51, 7), 119ul);   // 118.0ms
+    ASSERT_EQ(AirtimeLedger::getTimeOnAir(11, 7), 62ul);    // 61.7ms
+    ASSERT_EQ(AirtimeLedger::getTimeOnAir(11, 12), 1483ul); // 1482.8ms
+    ASSERT_EQ(AirtimeLedger::getTimeOnAir(51, 12), 2794ul); // 2793.5ms
+    ASSERT_EQ(AirtimeLedger::getTimeOnAir(222, 7), 369ul);  // 368.9ms
+    // DR6 (SF7 / 250kHz) and the coding rate 4/8
+    ASSERT_EQ(AirtimeLedger::getTimeOnAir(51, 7, 250), 60ul);    // 59.0ms
+    ASSERT_EQ(AirtimeLedger::getTimeOnAir(51, 7, 125, 4), 177ul); // 176.4ms
+    // a longer payload never takes less time
+    for (size_t length = 1; length <= 222; ++length)
+    {
+        ASSERT_GE(AirtimeLedger::getTimeOnAir(length, 9), AirtimeLedger::getTimeOnAir(length - 1, 9));
+    }
+}
+
+TEST(AirtimeLedgerTests, SubBandTests)
+{
+    AirtimeLedger ledger;
+    ASSERT_EQ(AirtimeLedger::getBudget(), 36000ul);
+    ASSERT_EQ(ledger.getWaitTime(start, 2794), 0u);
+
+    // the uplinks alternate between the sub-bands
+    ASSERT_EQ(ledger.record(start, 2794), 0);
+    ASSERT_EQ(ledger.record(start + 10, 2794), 1);
+    ASSERT_EQ(ledger.record(start + 20, 2794), 0);
+    ASSERT_EQ(ledger.getUsed(0, start + 20), 5588ul);
+    ASSERT_EQ(ledger.getUsed(1, start + 20), 2794ul);
+    // the bookings expire after an hour
+    ASSERT_EQ(ledger.getUsed(0, start + 3600), 2794ul);
+    ASSERT_EQ(ledger.getUsed(0, start + 3620), 0ul);
+    ASSERT_EQ(ledger.getTotalAirtime(), 3ul * 2794ul);
+    ASSERT_EQ(ledger.getUplinkCount(), 3ul);
+    ASSERT_EQ(ledger.getPeakUsage(), 5588ul);
+
+    ledger.clear();
+    ASSERT_EQ(ledger.getUsed(0, start + 20), 0ul);
+    ASSERT_EQ(ledger.getTotalAirtime(), 0ul);
+}
+
+TEST(AirtimeLedgerTests, DutyCycleTests)
+{
+    AirtimeLedger ledger;
+    // 24 SF12 uplinks (2.8s) fill both sub-bands: 12 x 2794ms = 33.5s of 36s
+    for (int i = 0; i < 24; ++i)
+    {
+        ledger.record(start + i * 60ul, 2794);
+    }
+    const uint32_t now = start + 24ul * 60ul;
+    ASSERT_EQ(ledger.getWaitTime(now, 2000), 0u);
+    // the next SF12 uplink waits until the first booking expires
+    ASSERT_EQ(ledger.getWaitTime(now, 2794), 3600u - 24u * 60u);
+    ASSERT_EQ(ledger.getWaitTime(start + 3600, 2794), 0u);
+    // longer than the budget
+    ASSERT_EQ(ledger.getWaitTime(now, 40000), AirtimeLedger::windowSeconds);
+
+    // a rtc correction to the past does not extend the wait time
+    ASSERT_EQ(ledger.getWaitTime(start - 86400ul, 2794), AirtimeLedger::windowSeconds);
+}
+
+TEST(AirtimeLedgerTests, MergeTests)
+{
+    // more uplinks than records: the airtime of a sub-band is kept
+    AirtimeLedger ledger;
+    for (int i = 0; i < 3 * AirtimeLedger::maxRecords; ++i)
+    {
+        ledger.record(start + i, 100);
+    }
+    const uint32_t now = start + 3 * AirtimeLedger::maxRecords;
+    ASSERT_EQ(ledger.getUsed(0, now) + ledger.getUsed(1, now), 3ul * AirtimeLedger::maxRecords * 100ul);
+    // merged bookings expire with the newer one
+    ASSERT_EQ(ledger.getUsed(0, start + 3600) + ledger.getUsed(1, start + 3600), 3ul * AirtimeLedger::maxRecords * 100ul);
+    ASSERT_EQ(ledger.getUsed(0, now + 3600) + ledger.getUsed(1, now + 3600), 0ul);
+}
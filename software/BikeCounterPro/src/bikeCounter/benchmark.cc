@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+#include "bikeCounter.hpp"
+#include "../HAL/sim_hal.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+// wake-up handling a motion interrupt (processInput) while collecting data
+static void BM_MotionLoop(benchmark::State &state)
+{
+    // 01.06.2024 00:00:00
+    SimHAL hal(1717200000ul);
+    hal.setMotionSensorPins(0, 3);
+    hal.setAnalogInput(15, 950);
+
+    BikeCounter *bc = BikeCounter::getInstance();
+    bc->injectHal(&hal);
+    bc->reset();
+    bc->setCounterInterruptPin(0);
+    bc->setSwitchPowerPin(10);
+    bc->setDebugSwitchPin(7);
+    bc->setConfigSwitchPin(8);
+    bc->setBatteryVoltagePin(15);
+    bc->setPirPowerPin(3);
+    bc->setSyncTimeInterval(120ul);
+    bc->setLedPin(6);
+    bc->setMaxBlinks(50);
+    bc->setMaxCount(1000000);
+    while (bc->getWakeUpStatus() != BikeCounter::Status::collectData)
+    {
+        bc->loop();
+    }
+
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        // the loop processes the previous motion and sleeps until the next one
+        hal.injectMotionAtMillis(hal.now() + 1000ull);
+        bc->loop();
+        if (hal.getUplinks().size() > 1000)
+        {
+            hal.clearUplinks();
+        }
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_MotionLoop);
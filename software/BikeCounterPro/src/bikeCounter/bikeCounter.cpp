@@ -18,6 +18,16 @@ BikeCounter *BikeCounter::getInstance()
 }
 
 void BikeCounter::loop()
+{
+    // run to completion: the states are processed until the device goes to sleep. The loop returns after the
+    // wake-up (in debug mode right away, the end of the sleep is polled in the sleep state)
+    do
+    {
+        runState();
+    } while (currentStatus != Status::sleepState);
+}
+
+void BikeCounter::runState()
 {
     int err = 0;
     switch (currentStatus)
@@ -36,19 +46,20 @@ void BikeCounter::loop()
         break;
 
     case Status::firstWakeUp:
-        logger.push("First wake-up");
+        LOG_INFO(logger, "First wake-up");
         logger.loop();
         hal->rtcSetEpoch(defaultRTCEpoch);
-        logger.push("RTC reset");
+        driftCompensator.clearAnchor();
+        LOG_INFO(logger, "RTC reset");
         logger.loop();
         currentStatus = Status::timeSync;
-        logger.push("Time sync");
+        LOG_INFO(logger, "Time sync");
         logger.loop();
         break;
 
     case Status::timeSync:
         // while rtc time < defaultRTCEpoch + 1 month try to sync
-        if (hal->rtcGetEpoch() < (defaultRTCEpoch + 2678400ul))
+        if (getEpoch() < (defaultRTCEpoch + 2678400ul))
         {
             switch (timeSyncStat)
             {
@@ -70,10 +81,14 @@ void BikeCounter::loop()
         }
         else
         {
-            currentStatus = Status::collectData;
+            currentStatus = Status::restoreData;
         }
         break;
 
+    case Status::restoreData:
+        currentStatus = restoreEvents() ? Status::sendPackage : Status::collectData;
+        break;
+
     case Status::collectData:
     {
         // enable the PIR sensor
@@ -83,7 +98,12 @@ void BikeCounter::loop()
         {
         case 0:
         {
-            std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime{std::chrono::seconds{hal->rtcGetEpoch()}};
+            std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime{std::chrono::seconds{getEpoch()}};
+            if (!uplinkBacklog.isEmpty() && getBacklogWaitTime(getEpoch()) == 0)
+            {
+                currentStatus = Status::drainBacklog;
+                break;
+            }
             sleep(getRemainingSleepTime(currentTime));
         }
         break;
@@ -99,7 +119,26 @@ void BikeCounter::loop()
 
     case Status::sendPackage:
         err = sendUplinkMessage();
-        currentStatus = (err) ? Status::errorState : Status::waitForLoRa;
+        currentStatus = (err) ? Status::errorState : Status::drainBacklog;
+        break;
+
+    case Status::drainBacklog:
+        switch (sendBacklog())
+        {
+        case 0:
+            currentStatus = Status::waitForLoRa;
+            break;
+        case 1:
+            // the next package is sent when the duty cycle allows it (see getRemainingSleepTime())
+            currentStatus = Status::collectData;
+            break;
+        case 2:
+            currentStatus = Status::errorState;
+            break;
+        case 3:
+            currentStatus = Status::restoreData;
+            break;
+        }
         break;
 
     case Status::waitForLoRa:
@@ -108,9 +147,15 @@ void BikeCounter::loop()
         {
         case 0:
         {
+            if (hal->eventLogSize() > uplinkBacklog.getTotalEventCount() + packageEventCount)
+            {
+                // send the remaining events of the log without waiting for the next timer call
+                currentStatus = Status::restoreData;
+                break;
+            }
             currentStatus = Status::collectData;
-            std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime{std::chrono::seconds{hal->rtcGetEpoch()}};
-            dataHandler.setTimerInterval(timeHandler.getCurrentIntervalMinutes(currentTime));
+            std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime{std::chrono::seconds{getEpoch()}};
+            dataHandler.setTimerInterval(getIntervalMinutes(currentTime));
             sleep(getRemainingSleepTime(currentTime));
         }
         break;
@@ -127,7 +172,7 @@ void BikeCounter::loop()
     break;
 
     case Status::sleepState:
-        if (!debugFlag || (debugFlag && (hal->getMillis() > sleepEndMillis)) || (motionDetected && !(preSleepStatus == Status::timeSync)))
+        if (!debugFlag || (debugFlag && (hal->getMillis() > sleepEndMillis)) || (hasPendingMotions() && !(preSleepStatus == Status::timeSync)))
         {
             currentStatus = preSleepStatus;
         }
@@ -140,17 +185,62 @@ void BikeCounter::loop()
     default:
         break;
     }
-    hal->waitHere(50);
 }
 
 void BikeCounter::reset()
 {
+    // restart the state machine with a clean state (used on the host to run several simulations)
+    currentStatus = Status::setupStep;
+    preSleepStatus = Status::setupStep;
+    motionEvents.clear();
+    drainedMotionCount = 0;
+    drainedMotionIndex = 0;
+    packageEventCount = 0;
+    restoredEpoch = 0;
+    uplinkBacklog.clear();
+    backlogInFlight = false;
+    uplinkLength = 0;
+    payloadBudget = DataPackage::basePayloadSize;
+    dataHandler.setPayloadSize(payloadBudget);
+    trafficController.setPayloadSize(payloadBudget);
+    airtimeLedger.clear();
+    uplinkSpreadingFactor = 7;
+    counter = 0;
+    totalCounter = 0;
+    fullCounter = 0;
+    hourOfDay = 0;
+    packageStartEpoch = 0;
+    for (unsigned int i = 0; i < DataPackage::maxBinCount; ++i)
+    {
+        binArray[i] = 0;
+    }
+    pirError = 0;
+    errorId = 0;
+    recErr = false;
+    blinkCount = 0;
+    timeSyncStat = 0;
+    lastRTCCorrection = 0ul;
+    sleepEndMillis = 0UL;
+    nextAlarm = std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>{std::chrono::seconds{0}};
+    timeHandler = TimerSchedule();
+    timeHandler.setSolarSchedule(&solarSchedule);
+    trafficController.reset();
+    adaptiveIntervalPlanned = false;
+    // the drift estimate is restored from the flash by the setup
+    driftCompensator = DriftCompensator();
+    if (hal != nullptr)
+    {
+        loRaConnector->injectHal(hal);
+        loRaConnector->reset();
+    }
 }
 
 int BikeCounter::setup()
 {
     // set static fields
-    motionDetected = false;
+    motionEvents.clear();
+    drainedMotionCount = 0;
+    drainedMotionIndex = 0;
 
     // read dip switch states
     hal->pinMode(switchPowerPin, HAL::GPIOPinMode::OUTPUT);
@@ -184,11 +274,17 @@ int BikeCounter::setup()
     hal->I2CInit();
 
     // initialize the logging instance
-    StatusLogger::Output outputType = debugFlag ? StatusLogger::Output::toSerial : StatusLogger::Output::noOutput;
+    // debug switch: text output to serial, config switch: tokenized trace in the flash (see simulation/detokenize.cc)
+    StatusLogger::Output outputType = debugFlag ? StatusLogger::Output::toSerial : (configFlag ? StatusLogger::Output::toMemory : StatusLogger::Output::noOutput);
     StatusLogger::getInstance()->setup(outputType, hal);
+    if (debugFlag && configFlag)
+    {
+        // both switches: the trace of the field unit is written to serial (binary) before the text output starts
+        StatusLogger::getInstance()->dumpTrace();
+    }
 
     // load config from flash
-    logger.push("Load config from flash");
+    LOG_INFO(logger, "Load config from flash");
     logger.loop();
     std::string appEui = "";
     std::string appKey = "";
@@ -197,9 +293,24 @@ int BikeCounter::setup()
         errorId = 1;
         return 1;
     }
-    logger.push("appEui = " + appEui);
-    logger.push("appKey = " + appKey);
-    logger.push("Temp. sensor setup started");
+    // open the event log (the events are restored after the time sync)
+    if (!hal->eventLogBegin())
+    {
+        LOG_WARNING(logger, "Event log not available");
+    }
+    packageEventCount = 0;
+
+    float latitude = 0.0f;
+    float longitude = 0.0f;
+    if (!hal->getLocationFromFlash(&latitude, &longitude))
+    {
+        LOG_INFO(logger, "Location %.2f %.2f", latitude, longitude);
+        setLocation(latitude, longitude);
+    }
+
+    LOG_DEBUG(logger, "appEui = %s", appEui.c_str());
+    LOG_DEBUG(logger, "appKey = %s", appKey.c_str());
+    LOG_INFO(logger, "Temp. sensor setup started");
     logger.loop();
 
     hal->waitHere(500);
@@ -207,8 +318,8 @@ int BikeCounter::setup()
     // initialize temperature and humidity sensor
     hal->AM2320Init();
 
-    logger.push("Temp. sensor setup finished");
-    logger.push("Lora setup started");
+    LOG_INFO(logger, "Temp. sensor setup finished");
+    LOG_INFO(logger, "Lora setup started");
     logger.loop();
 
     hal->waitHere(500);
@@ -217,28 +328,16 @@ int BikeCounter::setup()
     loRaConnector->injectHal(hal);
     loRaConnector->setup(appEui, appKey, &processDownlinkMessage);
 
-    logger.push("Lora setup finished");
-    logger.push("RTC setup started");
+    LOG_INFO(logger, "Lora setup finished");
+    LOG_INFO(logger, "RTC setup started");
     logger.loop();
 
     // setup rtc
     hal->rtcBegin(true);
     hal->rtcSetEpoch(defaultRTCEpoch);
+    loadDriftEstimate();
 
-    logger.push("RTC current time: " +
-                std::to_string(hal->rtcGetHours()) +
-                ':' +
-                std::to_string(hal->rtcGetMinutes()) +
-                ':' +
-                std::to_string(hal->rtcGetSeconds()));
-    logger.push("RTC current date: " +
-                std::to_string(hal->rtcGetDay()) +
-                '.' +
-                std::to_string(hal->rtcGetMonth()) +
-                '.' +
-                std::to_string(hal->rtcGetYear()));
-    logger.push("RTC epoch: " +
-                std::to_string(hal->rtcGetEpoch()));
+    logRTCTime("RTC current time: ");
     logger.loop();
 
     // delay to avoid interference with interrupt pin setup
@@ -248,7 +347,7 @@ int BikeCounter::setup()
     hal->pinMode(counterInterruptPin, HAL::GPIOPinMode::INPUT);
     hal->attachInterruptWakeup(counterInterruptPin, onMotionDetected, HAL::TriggerMode::RISING);
 
-    logger.push("Setup finished");
+    LOG_INFO(logger, "Setup finished");
     logger.loop();
 
     return 0;
@@ -258,66 +357,182 @@ int BikeCounter::setup()
 /// @return 0=no action; 1=send package 2=error
 int BikeCounter::processInput()
 {
+    // record the motions captured by the interrupt (in the order of their occurrence)
+    bool motionRecorded = false;
+    uint32_t motionEpoch = 0;
+    while (popMotion(&motionEpoch))
+    {
+        motionRecorded = true;
+        blinkLED();
+        trafficController.addMotion(motionEpoch);
+        // store the event until the package is sent
+        if (hal->eventLogAppend(motionEpoch))
+        {
+            ++packageEventCount;
+        }
+        int result = recordMotion(motionEpoch);
+        if (result)
+        {
+            // the remaining motions are recorded after the package is sent
+            return result;
+        }
+    }
+
     // get current time
-    std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime{std::chrono::seconds{hal->rtcGetEpoch()}};
-    date::hh_mm_ss<std::chrono::seconds> currentTime_hms = date::make_time(currentTime.time_since_epoch() - date::floor<date::days>(currentTime).time_since_epoch());
-    int timerCalled = 0;
+    std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime{std::chrono::seconds{getEpoch()}};
+
+    // if no motion was detected it means that the timer caused the wakeup (unless the backlog is drained).
+    if ((!motionRecorded && uplinkBacklog.isEmpty()) || currentTime >= nextAlarm)
+    {
+        LOG_DEBUG(logger, "Timer called");
+        logger.loop();
+        totalCounter = 0;
+        uint32_t epoch = (uint32_t)currentTime.time_since_epoch().count();
+        trafficController.update(epoch);
+        adaptiveIntervalPlanned = adaptiveInterval && trafficController.isLearned();
+        if (adaptiveIntervalPlanned)
+        {
+            nextAlarm = std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>{std::chrono::seconds{trafficController.getNextCallTime(epoch)}};
+            LOG_DEBUG(logger, "Adaptive interval %u min", trafficController.getIntervalMinutes());
+        }
+        else
+        {
+            nextAlarm = timeHandler.getNextIntervalTime(currentTime);
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+/// @brief Adds a motion to the time and bin array
+/// @param epoch RTC time of the motion
+/// @return 0=no action; 1=send package 2=error
+int BikeCounter::recordMotion(uint32_t epoch)
+{
+    std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> motionTime{std::chrono::seconds{epoch}};
+    date::hh_mm_ss<std::chrono::seconds> motionTime_hms = date::make_time(motionTime.time_since_epoch() - date::floor<date::days>(motionTime).time_since_epoch());
 
-    // check if a motion was detected.
-    if (motionDetected)
+    // set hour of the day if this was the first call
+    if (counter == 0)
     {
-        motionDetected = false;
+        hourOfDay = motionTime_hms.hours().count();
+        packageStartEpoch = epoch - epoch % 3600ul;
+    }
+    // minutes since the hour of the day (a motion before it, e.g. after the RTC was set back, counts at minute 0)
+    unsigned int minute = epoch > packageStartEpoch ? (epoch - packageStartEpoch) / 60ul : 0;
+    // the histogram format counts beyond the size of the time array
+    if (counter < timeArraySize)
+    {
+        timeArray[counter] = minute;
+    }
+    unsigned int bin = minute / DataPackage::binMinutes;
+    if (bin < DataPackage::maxBinCount && binArray[bin] < 0xffff)
+    {
+        ++binArray[bin];
+    }
 
-        // set hour of the day if this was the first call
-        if (counter == 0)
+    ++counter;
+    ++totalCounter;
+
+    LOG_DEBUG(logger, "Motion detected (current count = %d / time: %d:%d:%d)",
+                      counter,
+                      static_cast<int>(motionTime_hms.hours().count()),
+                      static_cast<int>(motionTime_hms.minutes().count()),
+                      static_cast<int>(motionTime_hms.seconds().count()));
+    logger.loop();
+
+    // check if the data should be sent.
+    dataHandler.setTimerInterval(getIntervalMinutes(motionTime));
+    dataHandler.setMotionCount(counter < timeArraySize ? counter : timeArraySize);
+    dataHandler.setTimeArray(timeArray);
+    dataHandler.setBinArray(binArray);
+    // the histogram format is hardly ever full, check the total count on every motion
+    if (dataHandler.isPayloadFull() || (totalCounter >= maxCount))
+    {
+        if (fullCounter == 0)
         {
-            hourOfDay = currentTime_hms.hours().count();
+            fullCounter = counter;
+        }
+        // check if the floating interrupt pin bug occurred
+        // method 1: check if the totalCount exceeds the maxCount between the timer calls.
+        // method 2: detect if the count goes up very quickly. (faster then the board is able to send)
+        if ((totalCounter >= maxCount) || (counter > (fullCounter + 10)))
+        {
+            errorId = 2;
+            return 2;
         }
-        timeArray[counter] = (currentTime_hms.hours().count() - hourOfDay) * 60 + currentTime_hms.minutes().count();
 
-        ++counter;
-        ++totalCounter;
+        return 1;
+    }
 
-        blinkLED();
+    return 0;
+}
 
-        logger.push("Motion detected (current count = " +
-                    std::to_string(counter) +
-                    " / time: " +
-                    std::to_string(static_cast<int>(currentTime_hms.hours().count())) +
-                    ':' +
-                    std::to_string(static_cast<int>(currentTime_hms.minutes().count())) +
-                    ':' +
-                    std::to_string(static_cast<int>(currentTime_hms.seconds().count())) +
-                    ')');
-        logger.loop();
+bool BikeCounter::popMotion(uint32_t *epoch)
+{
+    if (drainedMotionIndex < drainedMotionCount)
+    {
+        *epoch = drainedMotions[drainedMotionIndex++];
+        return true;
+    }
+    drainedMotionIndex = 0;
+    drainedMotionCount = 0;
+    uint32_t rtcEpoch = 0;
+    if (!motionEvents.pop(rtcEpoch))
+    {
+        return false;
+    }
+    // the interrupt stores the RTC reading
+    *epoch = driftCompensator.correct(rtcEpoch);
+    return true;
+}
 
-        // check if the data should be sent.
-        int currentThreshold = dataHandler.getMaxCount(timeHandler.getCurrentIntervalMinutes(currentTime));
-        if (counter >= currentThreshold)
+int BikeCounter::restoreEvents()
+{
+    uint32_t epoch = 0;
+    uint32_t packageStart = 0;
+    uint32_t packageEnd = 0;
+    // the events of the backlog and the current package are already restored
+    while (hal->eventLogRead(uplinkBacklog.getTotalEventCount() + packageEventCount, &epoch, 1) == 1)
+    {
+        std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> motionTime{std::chrono::seconds{epoch}};
+        if (counter == 0)
         {
-            // check if the floating interrupt pin bug occurred
-            // method 1: check if the totalCount exceeds the maxCount between the timer calls.
-            // method 2: detect if the count goes up very quickly. (faster then the board is able to send)
-            if ((totalCounter >= maxCount) || (counter > (currentThreshold + 10)))
+            // the package starts at the full hour of the first event and ends after the interval or at UTC midnight
+            // (like the last timer call of the day, the minutes are counted from the hour of the day)
+            packageStart = epoch - epoch % 3600ul;
+            packageEnd = packageStart + getIntervalMinutes(motionTime) * 60ul;
+            uint32_t dayEnd = epoch - epoch % 86400ul + 86400ul;
+            if (packageEnd > dayEnd)
             {
-                errorId = 2;
-                return 2;
+                packageEnd = dayEnd;
             }
+            totalCounter = 0;
+        }
+        else if (epoch < packageStart || epoch >= packageEnd)
+        {
+            // the event belongs to the next package
+            return 1;
+        }
 
+        ++packageEventCount;
+        restoredEpoch = epoch;
+        if (recordMotion(epoch))
+        {
             return 1;
         }
     }
-    else
+
+    if (counter == 0)
     {
-        // if no motion was detected it means that the timer caused the wakeup.
-        logger.push("Timer called");
-        logger.loop();
-        totalCounter = 0;
-        nextAlarm = timeHandler.getNextIntervalTime(currentTime);
-        return 1;
+        return 0;
     }
 
-    return 0;
+    // the restored events are sent right away, they may be older than the current interval
+    LOG_INFO(logger, "Restored %d events from the event log", counter);
+    logger.loop();
+    return 1;
 }
 
 int BikeCounter::sendUplinkMessage()
@@ -330,51 +545,171 @@ int BikeCounter::sendUplinkMessage()
     dataHandler.setStatus(stat);
     dataHandler.setHwVersion(hwVersion);
     dataHandler.setSwVersion(swVersion);
-    dataHandler.setMotionCount(counter);
+    dataHandler.setMotionCount(counter < timeArraySize ? counter : timeArraySize);
     dataHandler.setBatteryVoltage(getBatteryVoltage());
     dataHandler.setTemperature(hal->AM2320ReadTemperature());
     dataHandler.setHumidity(hal->AM2320ReadHumidity());
     dataHandler.setHourOfTheDay(hourOfDay);
-    dataHandler.setDeviceTime(hal->rtcGetEpoch());
+    // a restored package is dated by its last event, the server dates the events of a delayed package from the device time
+    dataHandler.setDeviceTime(restoredEpoch > 0 ? restoredEpoch : getEpoch());
     dataHandler.setTimeArray(timeArray);
+    dataHandler.setBinArray(binArray);
+
+    if (currentStatus == Status::timeSync)
+    {
+        // the time sync message is not queued, it is repeated until the time is synced
+        loRaConnector->loop(5);
+        if (loRaConnector->getStatus() != LoRaConnector::Status::connected)
+        {
+            return 2;
+        }
+        uplinkSpreadingFactor = loRaConnector->getSpreadingFactor();
+        // the payload is encoded straight into the packet slot of the connector
+        LoRaConnector::Packet *packet = loRaConnector->allocatePacket();
+        if (packet == nullptr)
+        {
+            return 1;
+        }
+        size_t length = dataHandler.encodePayload(ByteSpan(packet->payload));
+        packet->length = (uint8_t)length;
+        packet->priority = LoRaConnector::Priority::high;
+        int err = loRaConnector->submitPacket(packet);
+        uplinkLength = err ? 0 : length;
+        return err;
+    }
+
+    if (uplinkBacklog.isFull())
+    {
+        // the oldest package (and its events) is dropped
+        LOG_WARNING(logger, "Backlog full, dropped package with %u events", uplinkBacklog.getEventCount());
+        logger.loop();
+        hal->eventLogTrim(uplinkBacklog.getEventCount());
+        uplinkBacklog.pop();
+    }
+    uplinkBacklog.commit(dataHandler.encodePayload(uplinkBacklog.getWriteBuffer()), packageEventCount);
+
+    LOG_DEBUG(logger, "Package added to the backlog (count = %d / temperature = %f°C / humidity = %f%% / battery voltage = %f V / DeviceEpoch = %lu / backlog = %d )",
+                      counter,
+                      (double)dataHandler.getTemperature(),
+                      (double)dataHandler.getHumidity(),
+                      (double)dataHandler.getBatteryVoltage(),
+                      (unsigned long)dataHandler.getDeviceTime(),
+                      uplinkBacklog.getSize());
+    logger.loop();
+
+    // reset counter and time array
+    packageEventCount = 0;
+    restoredEpoch = 0;
+    counter = 0;
+    fullCounter = 0;
+    updatePayloadSize();
+
+    for (int i = 0; i < timeArraySize; ++i)
+    {
+        timeArray[i] = 0;
+    }
+    for (unsigned int i = 0; i < DataPackage::maxBinCount; ++i)
+    {
+        binArray[i] = 0;
+    }
+
+    return 0;
+}
+
+int BikeCounter::sendBacklog()
+{
+    if (uplinkBacklog.isEmpty())
+    {
+        return 1;
+    }
+    uint32_t waitTime = getBacklogWaitTime(getEpoch());
+    if (waitTime > 0)
+    {
+        LOG_DEBUG(logger, "Duty cycle, next uplink in %lus (backlog = %d)", (unsigned long)waitTime, uplinkBacklog.getSize());
+        logger.loop();
+        return 1;
+    }
 
     loRaConnector->loop(5);
     if (loRaConnector->getStatus() != LoRaConnector::Status::connected)
     {
+        errorId = 4;
+        return 2;
+    }
+
+    // the data rate of the connection may need more airtime than the last one
+    uplinkSpreadingFactor = loRaConnector->getSpreadingFactor();
+    if (uplinkBacklog.getPayloadLength() > loRaConnector->getMaxPayloadSize())
+    {
+        // the ADR lowered the data rate below the budget of the package, the rate of the ADR is kept
+        return reencodeBacklog();
+    }
+    if (getBacklogWaitTime(getEpoch()) > 0)
+    {
+        return 1;
+    }
+    // a package which waited in the backlog does not carry the time of the transmission, the network server
+    // must not take its device time for a time sync
+    uint8_t *payload = uplinkBacklog.getPayload();
+    int length = (int)uplinkBacklog.getPayloadLength();
+    if (getEpoch() > DataPackage::getPayloadDeviceTime(payload, length) + delayedUplinkSeconds)
+    {
+        DataPackage::setPayloadDelayed(payload, length);
+    }
+    else if ((payload[2] & DataPackage::delayedStatus) == 0)
+    {
+        // the network server compares the device time with the time of the transmission (time sync and drift estimate)
+        DataPackage::setPayloadDeviceTime(payload, length, getEpoch());
+    }
+    int err = loRaConnector->sendMessage(payload, length);
+    if (err)
+    {
+        errorId = 4;
         return 2;
     }
 
-    int err = loRaConnector->sendMessage(dataHandler.getPayload(), dataHandler.getPayloadLength());
+    LOG_DEBUG(logger, "Message enqueued for transmission! (backlog = %d)", uplinkBacklog.getSize());
+    logger.loop();
+    backlogInFlight = true;
+    uplinkLength = uplinkBacklog.getPayloadLength();
+    return 0;
+}
 
-    if (!err)
+int BikeCounter::reencodeBacklog()
+{
+    payloadBudget = loRaConnector->getMaxPayloadSize();
+    size_t eventCount = uplinkBacklog.getTotalEventCount() + packageEventCount;
+    if (hal->eventLogSize() < eventCount || packageEventCount != (size_t)counter)
     {
-        logger.push("Message enqueued for transmission! (count = " +
-                    std::to_string(counter) +
-                    " / temperature = " +
-                    std::to_string(dataHandler.getTemperature()) +
-                    "°C / humidity = " +
-                    std::to_string(dataHandler.getHumidity()) +
-                    "% / battery voltage = " +
-                    std::to_string(dataHandler.getBatteryVoltage()) +
-                    " V / DeviceEpoch = " +
-                    std::to_string(dataHandler.getDeviceTime()) +
-                    " )");
+        // the events are not in the event log, the package waits for a faster data rate
+        LOG_WARNING(logger, "Package too long for DR%d, events not in the event log", loRaConnector->getDataRate());
         logger.loop();
+        uplinkBacklog.postpone(getEpoch(), 60UL * 60UL);
+        return 1;
+    }
 
-        // reset counter and time array
-        counter = 0;
+    LOG_WARNING(logger, "Package too long for DR%d, restoring %u events with %u bytes per package",
+                        loRaConnector->getDataRate(),
+                        (unsigned int)eventCount,
+                        (unsigned int)payloadBudget);
+    logger.loop();
 
-        for (int i = 0; i < timeArraySize; ++i)
-        {
-            timeArray[i] = 0;
-        }
+    // the backlog and the current package are restored from the event log (oldest event first)
+    uplinkBacklog.clear();
+    packageEventCount = 0;
+    restoredEpoch = 0;
+    counter = 0;
+    fullCounter = 0;
+    for (int i = 0; i < timeArraySize; ++i)
+    {
+        timeArray[i] = 0;
     }
-    else
+    for (unsigned int i = 0; i < DataPackage::maxBinCount; ++i)
     {
-        errorId = 4;
+        binArray[i] = 0;
     }
-
-    return err;
+    updatePayloadSize();
+    return 3;
 }
 
 /// @brief
@@ -386,21 +721,77 @@ int BikeCounter::waitForLoRaModule()
     switch (loRaConnector->getStatus())
     {
     case LoRaConnector::Status::connected:
+        if (loRaConnector->getQueueSize() > 0)
+        {
+            // the next packet is sent by the next loop
+            return 1;
+        }
+        if (uplinkLength > 0)
+        {
+            // the message is sent, book the time on air
+            unsigned long timeOnAir = AirtimeLedger::getTimeOnAir(uplinkLength, uplinkSpreadingFactor);
+            int subBand = airtimeLedger.record(getEpoch(), timeOnAir);
+            LOG_DEBUG(logger, "Time on air %lums (sub-band %d: %lums of %lums in the last hour)",
+                              timeOnAir,
+                              subBand,
+                              airtimeLedger.getUsed(subBand, getEpoch()),
+                              AirtimeLedger::getBudget());
+            logger.loop();
+            uplinkLength = 0;
+            // the ADR of the network may have changed the data rate
+            payloadBudget = loRaConnector->getMaxPayloadSize();
+            uplinkSpreadingFactor = loRaConnector->getSpreadingFactor();
+            updatePayloadSize();
+        }
+        if (backlogInFlight)
+        {
+            // the events are stored in the network, remove them from the event log
+            hal->eventLogTrim(uplinkBacklog.getEventCount());
+            uplinkBacklog.pop();
+            backlogInFlight = false;
+        }
         return 0;
     case LoRaConnector::Status::error:
+        // the package stays in the backlog and is sent again later
+        loRaConnector->clearQueue();
+        backlogInFlight = false;
+        uplinkLength = 0;
+        errorId = 4;
         return 2;
     case LoRaConnector::Status::fatalError:
+        loRaConnector->clearQueue();
         loRaConnector->reset();
+        backlogInFlight = false;
+        uplinkLength = 0;
         return 3;
     default:
         return 1;
     }
 }
 
+uint32_t BikeCounter::getBacklogWaitTime(uint32_t epoch)
+{
+    uint32_t retryDelay = uplinkBacklog.getWaitTime(epoch);
+    uint32_t dutyCycle = airtimeLedger.getWaitTime(epoch, AirtimeLedger::getTimeOnAir(uplinkBacklog.getPayloadLength(), uplinkSpreadingFactor));
+    return retryDelay > dutyCycle ? retryDelay : dutyCycle;
+}
+
+void BikeCounter::updatePayloadSize()
+{
+    size_t size = dataHandler.getPayloadSize();
+    if (payloadBudget == size || (payloadBudget < size && counter > 0))
+    {
+        return;
+    }
+    dataHandler.setPayloadSize(payloadBudget);
+    trafficController.setPayloadSize(payloadBudget);
+    LOG_INFO(logger, "Payload size %u bytes (DR%d)", (unsigned int)payloadBudget, loRaConnector->getDataRate());
+    logger.loop();
+}
+
 void BikeCounter::blinkLED(int times, int mode)
 {
     // deactivate the onboard LED after the specified amount of blinks
-    static int blinkCount = 0;
     if (blinkCount < maxBlinks)
     {
         ++blinkCount;
@@ -482,12 +873,11 @@ float BikeCounter::getBatteryVoltage()
 void BikeCounter::sleep(int ms, bool noInterrupt)
 {
 
-    logger.push("Going to sleep for " + std::to_string(ms) + "ms (" + std::to_string((int)(ms / 1000)) + "s / " + std::to_string((int)(ms / 60000)) + "min)");
+    LOG_DEBUG(logger, "Going to sleep for %dms (%ds / %dmin)", ms, ms / 1000, ms / 60000);
     logger.loop();
 
     preSleepStatus = currentStatus;
     currentStatus = Status::sleepState;
-    motionDetected = false;
 
     if (noInterrupt)
     {
@@ -499,15 +889,16 @@ void BikeCounter::sleep(int ms, bool noInterrupt)
     {
         sleepEndMillis = hal->getMillis() + ms;
     }
-    else
+    else if (noInterrupt || !hasPendingMotions())
     {
+        // motions captured while awake are processed before going to sleep
         hal->deepSleep(ms);
     }
 }
 
 void BikeCounter::handleError()
 {
-    logger.push(errorMsg[errorId]);
+    LOG_ERROR(logger, "%s", errorMsg[errorId]);
     logger.loop();
     recErr = true;
 
@@ -532,7 +923,7 @@ void BikeCounter::handleError()
         // Lets reset the PIR power connection and try again
         if (pirError++ <= 2)
         {
-            logger.push("Resetting PIR-sensor");
+            LOG_WARNING(logger, "Resetting PIR-sensor");
             logger.loop();
             hal->digitalWrite(pirPowerPin, 0);
             hal->waitHere(2000);
@@ -543,7 +934,7 @@ void BikeCounter::handleError()
         }
         else
         {
-            logger.push("PIR-sensor error could not be fixed.");
+            LOG_ERROR(logger, "PIR-sensor error could not be fixed.");
             logger.loop();
             // shut down PIR and try it again in 5 hours
             hal->digitalWrite(pirPowerPin, 0);
@@ -560,7 +951,7 @@ void BikeCounter::handleError()
         sleep(60UL * 1000UL); // 1min
 
     case 4:
-        // Reset the LoRa module or/and wait some time
+        // The package stays in the backlog and the counting goes on, only the next uplink is postponed
         switch (loRaConnector->getErrorId())
         {
         case 1:
@@ -568,34 +959,50 @@ void BikeCounter::handleError()
         case 2:
             // Failed to connect to LoRa network
             // wait for 60min and try again
-            // loRaConnector->reset();
-            currentStatus = Status::collectData;
-            sleep(60UL * 60UL * 1000UL, true);
+            uplinkBacklog.postpone(getEpoch(), 60UL * 60UL);
             break;
         case 3:
             // Error sending message
             // wait for 5min and try again
-            currentStatus = Status::collectData;
-            sleep(5UL * 60UL * 1000UL, true);
+            uplinkBacklog.postpone(getEpoch(), 5UL * 60UL);
             break;
         default:
-            // loRaConnector->reset();
-            currentStatus = Status::collectData;
-            // enable the PIR sensor
-            hal->digitalWrite(pirPowerPin, 1);
+            uplinkBacklog.postpone(getEpoch(), 60UL);
             break;
         }
+        currentStatus = Status::collectData;
+        // enable the PIR sensor
+        hal->digitalWrite(pirPowerPin, 1);
+        {
+            std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime{std::chrono::seconds{getEpoch()}};
+            sleep(getRemainingSleepTime(currentTime));
+        }
         break;
     }
 }
 
+unsigned int BikeCounter::getIntervalMinutes(std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> time)
+{
+    // the interval class does not change until the next timer call sends the package
+    if (adaptiveIntervalPlanned)
+    {
+        return trafficController.getIntervalMinutes();
+    }
+    return timeHandler.getCurrentIntervalMinutes(time);
+}
+
 unsigned long BikeCounter::getRemainingSleepTime(std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime)
 {
     // determine the remaining time to sleep
     int64_t sdt = (nextAlarm.time_since_epoch().count() - currentTime.time_since_epoch().count());
     uint32_t sleepTime = sdt > 0 ? (uint32_t)sdt : syncTimeInterval;
+    // wake up when the duty cycle allows the next package of the backlog
+    if (!uplinkBacklog.isEmpty())
+    {
+        sleepTime = std::min<uint32_t>(sleepTime, std::max<uint32_t>(getBacklogWaitTime((uint32_t)currentTime.time_since_epoch().count()), 1u));
+    }
     // sanity check
-    sleepTime = std::min(sleepTime, (12ul * 60ul * 60ul));
+    sleepTime = std::min<uint32_t>(sleepTime, (12ul * 60ul * 60ul));
     return sleepTime * 1000UL;
 }
 
@@ -613,36 +1020,88 @@ int BikeCounter::processDownlinkMessage(int *buffer, int length)
     return 0;
 }
 
+void BikeCounter::setLocation(float latitude, float longitude)
+{
+    solarSchedule.setLocation(latitude, longitude);
+    timeHandler.setSolarSchedule(&solarSchedule);
+}
+
+void BikeCounter::clearLocation()
+{
+    solarSchedule = SolarSchedule();
+    timeHandler.setSolarSchedule(nullptr);
+}
+
 void BikeCounter::correctRTCTime(int32_t timeDrift)
 {
-    logger.push("Received time correction = " + std::to_string(timeDrift));
+    LOG_INFO(logger, "Received time correction = %ld", (long)timeDrift);
     logger.loop();
 
-    uint32_t currentEpoch = hal->rtcGetEpoch();
+    uint32_t currentEpoch = getEpoch();
 
     // check if the timeDrift should be applied (only if the drift is greater then 10min and only once a day)
     if ((abs(timeDrift) > (10 * 60)) && ((currentEpoch - lastRTCCorrection) > (24 * 60 * 60)))
     {
-        // apply time correction
-        hal->rtcSetEpoch(currentEpoch + timeDrift);
-        lastRTCCorrection = hal->rtcGetEpoch();
-
-        logger.push("RTC correction applied, current time: " +
-                    std::to_string(hal->rtcGetHours()) +
-                    ':' +
-                    std::to_string(hal->rtcGetMinutes()) +
-                    ':' +
-                    std::to_string(hal->rtcGetSeconds()));
-        logger.push("RTC current date: " +
-                    std::to_string(hal->rtcGetDay()) +
-                    '.' +
-                    std::to_string(hal->rtcGetMonth()) +
-                    '.' +
-                    std::to_string(hal->rtcGetYear()));
-        logger.push("RTC epoch: " +
-                    std::to_string(hal->rtcGetEpoch()));
+        // the motions captured before the correction are corrected with the old time base and shifted by the drift,
+        // the interrupt stores the new RTC time from here on
+        uint32_t rtcEpoch = 0;
+        while (drainedMotionCount < motionEventCapacity && motionEvents.pop(rtcEpoch))
+        {
+            drainedMotions[drainedMotionCount++] = driftCompensator.correct(rtcEpoch) + (uint32_t)timeDrift;
+        }
+
+        // apply time correction (the drift since the last correction refines the drift estimate)
+        int32_t rate = driftCompensator.getRate();
+        hal->rtcSetEpoch(driftCompensator.applyCorrection(hal->rtcGetEpoch(), timeDrift));
+        lastRTCCorrection = getEpoch();
+        if (driftCompensator.getRate() != rate)
+        {
+            LOG_INFO(logger, "RTC drift estimate %.1f ppm", (double)driftCompensator.getDriftPpm());
+            saveDriftEstimate();
+        }
+
+        logRTCTime("RTC correction applied, current time: ");
         logger.loop();
 
         hal->waitHere(500);
     }
+    else if (driftCompensator.observeDrift(hal->rtcGetEpoch(), timeDrift))
+    {
+        // the RTC is not corrected, the deviation refines the drift estimate (and the corrected time follows it)
+        LOG_INFO(logger, "RTC drift estimate %.1f ppm", (double)driftCompensator.getDriftPpm());
+        saveDriftEstimate();
+    }
+}
+
+void BikeCounter::loadDriftEstimate()
+{
+    uint8_t record[4];
+    if (hal->stateRead(HAL::STATE_RTC_DRIFT, record, sizeof(record)) != sizeof(record))
+    {
+        return;
+    }
+    driftCompensator.setRate((int32_t)(((uint32_t)record[3] << 24) | ((uint32_t)record[2] << 16) | ((uint32_t)record[1] << 8) | record[0]));
+    LOG_INFO(logger, "RTC drift estimate %.1f ppm", (double)driftCompensator.getDriftPpm());
+}
+
+void BikeCounter::saveDriftEstimate()
+{
+    uint32_t rate = (uint32_t)driftCompensator.getRate();
+    uint8_t record[4] = {(uint8_t)(rate & 0xff), (uint8_t)((rate >> 8) & 0xff), (uint8_t)((rate >> 16) & 0xff), (uint8_t)(rate >> 24)};
+    if (!hal->stateWrite(HAL::STATE_RTC_DRIFT, record, sizeof(record)))
+    {
+        LOG_WARNING(logger, "RTC drift estimate not saved");
+    }
+}
+
+void BikeCounter::logRTCTime(const char *title)
+{
+    // the RTC is only read if the message is output
+    if (!StatusLogger::getInstance()->isEnabled(StatusLogger::Level::info))
+    {
+        return;
+    }
+    LOG_INFO(logger, "%s%d:%d:%d", title, hal->rtcGetHours(), hal->rtcGetMinutes(), hal->rtcGetSeconds());
+    LOG_INFO(logger, "RTC current date: %d.%d.%d", hal->rtcGetDay(), hal->rtcGetMonth(), hal->rtcGetYear());
+    LOG_INFO(logger, "RTC epoch: %lu", (unsigned long)hal->rtcGetEpoch());
 }
\ No newline at end of file
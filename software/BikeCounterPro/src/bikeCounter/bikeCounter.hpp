@@ -7,8 +7,13 @@
 #include "../LoRaConnector/LoRaConnector.hpp"
 #include "../dataPackage/dataPackage.hpp"
 #include "../timerSchedule/timerSchedule.hpp"
+#include "../trafficController/trafficController.hpp"
+#include "../driftCompensator/driftCompensator.hpp"
 #include "../timerSchedule/date.h"
-#include "../hal/hal_interface.hpp"
+#include "../ringBuffer/ringBuffer.hpp"
+#include "../uplinkBacklog/uplinkBacklog.hpp"
+#include "../airtimeLedger/airtimeLedger.hpp"
+#include "../HAL/hal_interface.hpp"
 
 class BikeCounter
 {
@@ -26,15 +31,17 @@ public:
         initSleep,
         firstWakeUp,
         timeSync,
+        restoreData,
         collectData,
         sendPackage,
+        drainBacklog,
         waitForLoRa,
         sleepState,
         errorState
     };
-    /// @brief
+    /// @brief Runs the state machine until the device goes to sleep (returns after the wake-up)
     void loop();
-    /// @brief
+    /// @brief Restarts the state machine from the setup step
     void reset();
     /// @brief
     /// @param hal_ptr
@@ -42,6 +49,12 @@ public:
     /// @brief
     /// @return
     Status getStatus() { return currentStatus; }
+    /// @brief State which is processed after the wake-up (current state if the device is awake)
+    /// @return
+    Status getWakeUpStatus() { return currentStatus == Status::sleepState ? preSleepStatus : currentStatus; }
+    /// @brief
+    /// @return id of the last error (0 = no error)
+    int getErrorId() { return errorId; }
     /// @brief Counter interrupt pin
     /// @param pin
     void setCounterInterruptPin(int pin) { counterInterruptPin = pin; }
@@ -71,7 +84,31 @@ public:
     void setMaxBlinks(int count) { maxBlinks = count; }
     /// @brief Max. counts between timer calls (to detect a floating interrupt pin)
     /// @param count
-    void setMaxCount(int count) { maxCount = count; }
+    void setMaxCount(int count)
+    {
+        maxCount = count;
+        trafficController.setMaxCount(count);
+    }
+    /// @brief Encoding of the motion minutes in the uplink payload
+    /// @param format
+    void setPayloadFormat(DataPackage::PayloadFormat format) { dataHandler.setPayloadFormat(format); }
+    /// @brief Day and night intervals from the sunrise and sunset at the location (overwritten by the location in the flash config)
+    /// @param latitude degrees north
+    /// @param longitude degrees east
+    void setLocation(float latitude, float longitude);
+    /// @brief Day and night intervals from the built in table (Zurich)
+    void clearLocation();
+    /// @brief Reporting interval from the learned traffic profile instead of the day and night intervals
+    /// (the TimerSchedule is used until every hour of the day was observed)
+    /// @param enable
+    /// @param maxIntervalHours longest interval (latency bound)
+    void setAdaptiveInterval(bool enable, int maxIntervalHours = 8)
+    {
+        adaptiveInterval = enable;
+        trafficController.setMaxIntervalHours(maxIntervalHours);
+    }
+    /// @brief Time on air and duty cycle of the sent uplinks (cleared by a reset)
+    const AirtimeLedger &getAirtimeLedger() const { return airtimeLedger; }
     /// @brief
     void correctRTCTime(int32_t timeDrift);
 
@@ -85,7 +122,7 @@ private:
     // static std::mutex mutex_;
 
     // HAL dependency
-    HAL *hal;
+    HAL *hal = nullptr;
 
     int counterInterruptPin;
     int switchPowerPin;
@@ -111,19 +148,60 @@ private:
 
     // TimerSchedule object to determine the next timer call
     TimerSchedule timeHandler = TimerSchedule();
+    // Sunrise and sunset table of the location (kept over a reset)
+    SolarSchedule solarSchedule = SolarSchedule();
+    // Traffic profile which selects the reporting interval (if adaptiveInterval is set)
+    TrafficController trafficController = TrafficController();
+    bool adaptiveInterval = false;
+    // the current interval was planned by the trafficController
+    bool adaptiveIntervalPlanned = false;
+
+    // Drift estimate of the RTC (persisted), corrects every RTC reading
+    DriftCompensator driftCompensator = DriftCompensator();
 
     // Motion counter value
     int counter = 0;
     // total counts between timer calls
     int totalCounter = 0;
-    // motion detected flag (must be volatile as changed in IRS)
-    volatile bool motionDetected;
-    // time array size
-    static const int timeArraySize = 62;
+    // counter value when the payload was full the first time (0 = not full)
+    int fullCounter = 0;
+    // RTC epoch of the motions, pushed by the ISR and drained by processInput()
+    static const unsigned int motionEventCapacity = 32;
+    RingBuffer<uint32_t, motionEventCapacity> motionEvents;
+    // motions taken from motionEvents before an RTC correction (corrected epochs), recorded before the next ones
+    uint32_t drainedMotions[motionEventCapacity];
+    unsigned int drainedMotionCount = 0;
+    unsigned int drainedMotionIndex = 0;
+    // events of the current package which are stored in the event log
+    size_t packageEventCount = 0;
+    // epoch of the last restored event, device time of a restored package (0 = the package is recorded live)
+    uint32_t restoredEpoch = 0;
+    // packages waiting for the transmission
+    UplinkBacklog uplinkBacklog = UplinkBacklog();
+    // the oldest package of the backlog is enqueued in the LoRaConnector
+    bool backlogInFlight = false;
+    // a package sent later than this after its device time is marked as delayed (no time sync on the server)
+    static const uint32_t delayedUplinkSeconds = 2 * 60;
+    // payload length of the enqueued message (0 = no message)
+    size_t uplinkLength = 0;
+    // airtime of the uplinks per EU868 sub-band, gates the packages of the backlog
+    AirtimeLedger airtimeLedger = AirtimeLedger();
+    // spreading factor of the data rate of the last uplink (time on air of the next one)
+    int uplinkSpreadingFactor = 7;
+    // max. payload size of the current data rate (ADR), sizes the packages and the send threshold
+    size_t payloadBudget = DataPackage::basePayloadSize;
+    // time array size (max. count of the payload + floating pin detection margin)
+    static const int timeArraySize = DataPackage::maxDeltaCount + 11;
     // time array
     unsigned int timeArray[timeArraySize];
+    // motion counts per DataPackage::binMinutes since hourOfDay (histogram format)
+    uint16_t binArray[DataPackage::maxBinCount] = {0};
     // hour of the day for next package
     unsigned int hourOfDay = 0;
+    // epoch of the full hour of the first motion of the package (the minutes of the motions are counted from it)
+    uint32_t packageStartEpoch = 0;
+    // Number of LED blinks since the setup
+    int blinkCount = 0;
     // Error counter for pir-sensor
     int pirError = 0;
     // Holds the debug state of the dip switch
@@ -145,17 +223,20 @@ private:
     // error code
     int errorId = 0;
     // error messages corresponding to the errorId
-    char *errorMsg[5] = {"No error",
-                         "SPI Flash not detected",
-                         "Floating interrupt pin detected.",
-                         "PIR sensor error",
-                         "Error while sending message"};
+    const char *errorMsg[5] = {"No error",
+                               "SPI Flash not detected",
+                               "Floating interrupt pin detected.",
+                               "PIR sensor error",
+                               "Error while sending message"};
     // recovered from error
     bool recErr = false;
     // sleep state variables
     Status preSleepStatus = setupStep;
     unsigned long sleepEndMillis = 0UL;
 
+    /// @brief Processes the current state
+    void runState();
+
     /// @brief
     /// @return
     int setup();
@@ -165,9 +246,43 @@ private:
     int processInput();
 
     /// @brief
+    /// @param epoch
+    /// @return
+    int recordMotion(uint32_t epoch);
+
+    /// @brief Takes the next motion captured by the interrupt
+    /// @param epoch corrected epoch of the motion
+    /// @return true if a motion was pending
+    bool popMotion(uint32_t *epoch);
+    /// @brief true if motions wait to be recorded
+    bool hasPendingMotions() { return drainedMotionIndex < drainedMotionCount || !motionEvents.empty(); }
+
+    /// @brief Reads the events which were not sent before the last restart from the event log
+    /// @return 0=all events restored; 1=send package
+    int restoreEvents();
+
+    /// @brief Encodes the package and appends it to the backlog (the time sync message is sent directly)
     /// @return 0=message sent correctly, 1=there was already a message in the queue, 2=error
     int sendUplinkMessage();
 
+    /// @brief Enqueues the oldest package of the backlog in the LoRaConnector
+    /// @return 0=message enqueued, 1=wait for the duty cycle (or backlog empty), 2=error, 3=restore the events
+    int sendBacklog();
+
+    /// @brief Drops the backlog and the current package, their events are restored from the event log into
+    /// packages of the payload budget of the current data rate (the package is held if the log misses events)
+    /// @return 1=wait, 3=restore the events
+    int reencodeBacklog();
+
+    /// @brief Time until the oldest package of the backlog may be sent (duty cycle and retry delay)
+    /// @param epoch current time (RTC)
+    /// @return seconds (0 = send now)
+    uint32_t getBacklogWaitTime(uint32_t epoch);
+
+    /// @brief Applies the payload budget to the package and the traffic controller
+    /// A smaller budget is applied from the next package on (the counts of the current package would not fit).
+    void updatePayloadSize();
+
     /// @brief blinks the on-board led
     /// @param times number of times to blink
     /// @param mode 0=blink, 1=fade-in, 2=fade-out, 3=pulsate
@@ -180,6 +295,15 @@ private:
     /// @return Battery voltage
     float getBatteryVoltage();
 
+    /// @brief Restores the RTC drift estimate from the flash
+    void loadDriftEstimate();
+    /// @brief Stores the RTC drift estimate in the flash
+    void saveDriftEstimate();
+
+    /// @brief Logs the RTC time, date and epoch (info level)
+    /// @param title text in front of the time
+    void logRTCTime(const char *title);
+
     /// @brief
     /// @param ms
     void sleep(int ms, bool noInterrupt = false);
@@ -187,6 +311,15 @@ private:
     /// @brief
     void handleError();
 
+    /// @brief RTC epoch corrected by the drift estimate
+    /// @return epoch
+    uint32_t getEpoch() { return driftCompensator.correct(hal->rtcGetEpoch()); }
+
+    /// @brief Interval length of the package (interval class of the DataPackage)
+    /// @param time time of the motion
+    /// @return minutes
+    unsigned int getIntervalMinutes(std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> time);
+
     /// @brief
     unsigned long getRemainingSleepTime(std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentTime);
 
@@ -202,7 +335,8 @@ private:
     /// @brief
     static void onMotionDetected()
     {
-        BikeCounter::getInstance()->motionDetected = 1;
+        BikeCounter *bc = BikeCounter::getInstance();
+        bc->motionEvents.push(bc->hal->rtcGetEpoch());
     }
 };
 
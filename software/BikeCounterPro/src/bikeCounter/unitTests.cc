@@ -0,0 +1,636 @@
+#include <gtest/gtest.h>
+#include "bikeCounter.hpp"
+#include "../HAL/sim_hal.hpp"
+
+class BikeCounterTest : public ::testing::Test
+{
+protected:
+    // 01.06.2024 00:00:00
+    const uint32_t worldStart = 1717200000ul;
+    SimHAL hal{worldStart};
+    BikeCounter *bc = BikeCounter::getInstance();
+
+    void SetUp() override
+    {
+        hal.setMotionSensorPins(0, 3);
+        hal.setAnalogInput(15, 950);
+
+        // same configuration as BikeCounterPro.ino (LED_BUILTIN = 6, A0 = 15)
+        bc->injectHal(&hal);
+        bc->reset();
+        // the configuration of the singleton is kept over a reset
+        bc->clearLocation();
+        bc->setPayloadFormat(DataPackage::PayloadFormat::fixedBits);
+        bc->setAdaptiveInterval(false);
+        bc->setCounterInterruptPin(0);
+        bc->setSwitchPowerPin(10);
+        bc->setDebugSwitchPin(7);
+        bc->setConfigSwitchPin(8);
+        bc->setBatteryVoltagePin(15);
+        bc->setPirPowerPin(3);
+        bc->setSyncTimeInterval(120ul);
+        bc->setLedPin(6);
+        bc->setMaxBlinks(50);
+        bc->setMaxCount(1000);
+    }
+
+    // Arduino runtime: loop() { bc->loop(); }
+    void runUntil(uint32_t epoch)
+    {
+        hal.runUntil(epoch, [this]()
+                     { bc->loop(); });
+    }
+
+    // runs until the device collects data (setup and time sync done)
+    void runUntilCollecting()
+    {
+        while (bc->getWakeUpStatus() != BikeCounter::Status::collectData && hal.worldEpoch() < worldStart + 3600ul)
+        {
+            bc->loop();
+        }
+    }
+};
+
+TEST_F(BikeCounterTest, SetupTests)
+{
+    // the first loop runs the setup and the first sleep
+    bc->loop();
+    ASSERT_EQ(bc->getStatus(), BikeCounter::Status::sleepState);
+    ASSERT_EQ(bc->getWakeUpStatus(), BikeCounter::Status::firstWakeUp);
+    ASSERT_EQ(hal.getSleepMillis(), 2000u);
+    // the PIR sensor is off until the time is synced
+    ASSERT_EQ(hal.getPinValue(3), 0);
+}
+
+TEST_F(BikeCounterTest, SetupErrorTests)
+{
+    hal.setFlashConfig(false);
+    bc->loop();
+    ASSERT_EQ(bc->getErrorId(), 1);
+
+    // the error handler sleeps an hour and restarts the setup
+    ASSERT_EQ(bc->getStatus(), BikeCounter::Status::sleepState);
+    ASSERT_EQ(bc->getWakeUpStatus(), BikeCounter::Status::setupStep);
+    ASSERT_GE(hal.now(), 60ull * 60ull * 1000ull);
+}
+
+TEST_F(BikeCounterTest, TimeSyncTests)
+{
+    runUntilCollecting();
+    ASSERT_EQ(bc->getWakeUpStatus(), BikeCounter::Status::collectData);
+
+    // the first uplink is the sync call (status 7) which is answered with the time drift
+    ASSERT_GE(hal.getUplinks().size(), 1u);
+    ASSERT_EQ(hal.getUplinks()[0].payload[2] & 0x07, 7);
+    ASSERT_EQ(hal.getDownlinkCount(), 1u);
+    ASSERT_LE(std::abs((int32_t)(hal.rtcGetEpoch() - hal.worldEpoch())), 60);
+}
+
+TEST_F(BikeCounterTest, TimerUplinkTests)
+{
+    runUntilCollecting();
+    hal.clearUplinks();
+
+    // 10:00 - 12:00 UTC is a 2h day interval
+    hal.injectMotion(worldStart + 10ul * 3600ul + 600ul);
+    hal.injectMotion(worldStart + 10ul * 3600ul + 1800ul);
+    hal.injectMotion(worldStart + 10ul * 3600ul + 3000ul);
+    runUntil(worldStart + 12ul * 3600ul + 300ul);
+
+    // the timer call at 12:01 sends the three motions
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_GE(uplinks.size(), 1u);
+    const SimHAL::Uplink &u = uplinks.back();
+    ASSERT_EQ(u.payload[0], 3);
+    ASSERT_EQ(u.payload[4] & 0x07, 1);  // 2h interval id
+    ASSERT_EQ(u.payload[4] >> 3, 10);   // hour of the day
+    ASSERT_EQ(u.payload.size(), 8u + 3u); // 3 x 7 bits
+}
+
+TEST_F(BikeCounterTest, LocationScheduleTests)
+{
+    // New York: sunrise 09:25 UTC, sunset after UTC midnight -> 2h day intervals from 09:00 until the end of the UTC day
+    hal.setLocationConfig(true, 40.71f, -74.01f);
+    runUntilCollecting();
+    hal.clearUplinks();
+
+    // 21:00 - 23:00 UTC is a 2h day interval in New York (night interval in the built in table)
+    hal.injectMotion(worldStart + 21ul * 3600ul + 1800ul);
+    runUntil(worldStart + 23ul * 3600ul + 300ul);
+
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_GE(uplinks.size(), 1u);
+    const SimHAL::Uplink &u = uplinks.back();
+    ASSERT_EQ(u.payload[0], 1);
+    ASSERT_EQ(u.payload[4] & 0x07, 1); // 2h interval id
+    ASSERT_EQ(u.payload[4] >> 3, 21);  // hour of the day
+}
+
+TEST_F(BikeCounterTest, AdaptiveIntervalTests)
+{
+    // quiet trail: 2 riders a day at 07:30 and 17:30
+    for (uint32_t d = 0; d < 4; ++d)
+    {
+        hal.injectMotion(worldStart + d * 86400ul + 7ul * 3600ul + 1800ul);
+        hal.injectMotion(worldStart + d * 86400ul + 17ul * 3600ul + 1800ul);
+    }
+    bc->setAdaptiveInterval(true);
+    runUntilCollecting();
+
+    // the fixed schedule is used while the profile is learned (first day)
+    runUntil(worldStart + 2ul * 86400ul);
+    hal.clearUplinks();
+    runUntil(worldStart + 3ul * 86400ul);
+    // 8h intervals: 00:01, 08:01, 16:01 and 23:50 (the fixed schedule sends 11 packages in June)
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_EQ(uplinks.size(), 4u);
+    int motions = 0;
+    for (const SimHAL::Uplink &u : uplinks)
+    {
+        motions += u.payload[0];
+    }
+    ASSERT_EQ(motions, 2);
+    // the package of the 08:01 call contains the motion of 07:30 (8h interval class)
+    ASSERT_EQ(uplinks[1].payload[0], 1);
+    ASSERT_EQ(uplinks[1].payload[4] & 0x07, 3);
+    ASSERT_EQ(uplinks[1].payload[4] >> 3, 7);
+}
+
+TEST_F(BikeCounterTest, RtcDriftTests)
+{
+    // the RTC runs 3000 ppm fast (4.3 min per day), the network server answers deviations above 2 min
+    hal.setRtcDriftPpm(3000.0);
+    runUntilCollecting();
+    ASSERT_EQ(hal.getDownlinkCount(), 1u);
+
+    // the deviations after the sync call refine the drift estimate without a correction of the RTC,
+    // a few of them are enough for the rest of the time
+    runUntil(worldStart + 40ul * 86400ul);
+    const unsigned long learned = hal.getDownlinkCount();
+    ASSERT_GE(learned, 2u);
+    ASSERT_LE(learned, 4u);
+    ASSERT_EQ(hal.getStateWriteCount(HAL::STATE_RTC_DRIFT), learned - 1);
+    uint8_t record[4];
+    ASSERT_EQ(hal.stateRead(HAL::STATE_RTC_DRIFT, record, sizeof(record)), sizeof(record));
+    int32_t rate = (int32_t)(((uint32_t)record[3] << 24) | ((uint32_t)record[2] << 16) | ((uint32_t)record[1] << 8) | record[0]);
+    ASSERT_NEAR((double)rate * 1e6 / 4294967296.0, 3000.0, 10.0);
+    // the device time in the package (minutes) follows the real time
+    const SimHAL::Uplink &u = hal.getUplinks().back();
+    uint32_t deviceTime = ((uint32_t)u.payload[7] << 16) | ((uint32_t)u.payload[6] << 8) | u.payload[5];
+    ASSERT_NEAR((double)(deviceTime * 60ul + 1640995200ul), (double)u.worldEpoch, 2.0 * 60.0);
+
+    // the estimate survives a restart: one time sync, no further corrections
+    bc->reset();
+    while (bc->getWakeUpStatus() != BikeCounter::Status::collectData)
+    {
+        bc->loop();
+    }
+    ASSERT_EQ(hal.getDownlinkCount(), learned + 1);
+    runUntil(worldStart + 60ul * 86400ul);
+    ASSERT_EQ(hal.getDownlinkCount(), learned + 1);
+}
+
+TEST_F(BikeCounterTest, RtcCorrectionMotionTests)
+{
+    // the RTC jumps 20 min ahead on the second day, riders pass while the next uplink waits for the time correction
+    std::vector<uint32_t> motions;
+    hal.setDownlinkResponder([this, &motions](const SimHAL::Uplink &uplink)
+                             {
+        std::vector<uint8_t> downlink = SimHAL::timeSyncResponder(uplink);
+        if (!downlink.empty() && uplink.worldEpoch > worldStart + 86400ul && motions.empty())
+        {
+            for (uint64_t i = 1; i <= 5; ++i)
+            {
+                hal.injectMotionAtMillis(uplink.millis + i * 100ull);
+                motions.push_back(uplink.worldEpoch);
+            }
+        }
+        return downlink; });
+    runUntilCollecting();
+    runUntil(worldStart + 86400ul + 6ul * 3600ul);
+    hal.rtcSetEpoch(hal.rtcGetEpoch() + 1200ul);
+    runUntil(worldStart + 86400ul + 12ul * 3600ul);
+    ASSERT_GE(hal.getDownlinkCount(), 2u);
+    ASSERT_EQ(motions.size(), 5u);
+
+    // the motions captured before the correction are counted at their real time, not with the offset of the old RTC time
+    const SimHAL::Uplink *package = nullptr;
+    for (size_t i = 0; i < hal.getUplinks().size() && package == nullptr; ++i)
+    {
+        const SimHAL::Uplink &u = hal.getUplinks()[i];
+        package = u.worldEpoch > motions.front() && u.payload[0] > 0 ? &u : nullptr;
+    }
+    ASSERT_NE(package, nullptr);
+    unsigned int minutes[DataPackage::maxDeltaCount];
+    DataPackage decoded;
+    decoded.setTimeArray(minutes);
+    ASSERT_EQ(decoded.decodePayload(package->payload.data(), (int)package->payload.size()), 0);
+    ASSERT_EQ(decoded.getMotionCount(), 5);
+    for (int i = 0; i < 5; ++i)
+    {
+        uint32_t recorded = worldStart + 86400ul + decoded.getHourOfTheDay() * 3600ul + minutes[i] * 60ul;
+        ASSERT_LE(std::abs((int32_t)(recorded - motions[i])), 120);
+    }
+}
+
+TEST_F(BikeCounterTest, SessionResumeTests)
+{
+    // a weekly restart resumes the LoRaWAN session, one join per device-month
+    runUntilCollecting();
+    for (int week = 1; week <= 4; ++week)
+    {
+        runUntil(worldStart + week * 7ul * 86400ul);
+        bc->reset();
+        while (bc->getWakeUpStatus() != BikeCounter::Status::collectData)
+        {
+            bc->loop();
+        }
+    }
+    runUntil(worldStart + 30ul * 86400ul);
+    ASSERT_EQ(hal.getJoinCount(), 1u);
+    ASSERT_EQ(hal.getSessionRestoreCount(), 4u);
+    ASSERT_GT(hal.getUplinks().size(), 100u);
+}
+
+TEST_F(BikeCounterTest, ThresholdUplinkTests)
+{
+    // the max. count of the 2h interval (49) triggers an immediate send
+    const uint32_t lastMotion = worldStart + 10ul * 3600ul + 300ul + 48ul * 30ul;
+    for (int i = 0; i < 49; ++i)
+    {
+        hal.injectMotion(worldStart + 10ul * 3600ul + 300ul + i * 30ul);
+    }
+    runUntilCollecting();
+    runUntil(lastMotion + 60ul);
+
+    const SimHAL::Uplink &u = hal.getUplinks().back();
+    ASSERT_EQ(u.payload[0], 49);
+    ASSERT_EQ(u.payload.size(), 51u);
+    ASSERT_LE(u.worldEpoch, lastMotion + 60ul);
+}
+
+TEST_F(BikeCounterTest, AdaptiveDataRateTests)
+{
+    // near a gateway the ADR assigns DR5 (222 bytes), 150 motions of the 2h interval fit into one package
+    hal.setLinkDataRate(5);
+    for (int i = 0; i < 150; ++i)
+    {
+        hal.injectMotion(worldStart + 10ul * 3600ul + 300ul + i * 20ul);
+    }
+    runUntilCollecting();
+    runUntil(worldStart + 13ul * 3600ul);
+
+    const SimHAL::Uplink *package = nullptr;
+    size_t packageCount = 0;
+    for (size_t i = 0; i < hal.getUplinks().size(); ++i)
+    {
+        const SimHAL::Uplink &u = hal.getUplinks()[i];
+        if (u.worldEpoch > worldStart + 10ul * 3600ul && u.payload[0] > 0)
+        {
+            package = &u;
+            ++packageCount;
+        }
+    }
+    ASSERT_EQ(packageCount, 1u);
+    ASSERT_EQ(package->payload[0], 150);
+    ASSERT_EQ(package->payload.size(), 140u);
+    ASSERT_EQ(package->dataRate, 5);
+}
+
+TEST_F(BikeCounterTest, LowerDataRateTests)
+{
+    // a DR5 package of 150 motions waits in the backlog during a network outage, after the outage the link
+    // is weak and the ADR keeps DR0 (51 bytes)
+    hal.setLinkDataRate(5);
+    for (int i = 0; i < 150; ++i)
+    {
+        hal.injectMotion(worldStart + 10ul * 3600ul + 300ul + i * 20ul);
+    }
+    runUntilCollecting();
+    runUntil(worldStart + 10ul * 3600ul);
+    hal.clearUplinks();
+    hal.setUplinkResult(false);
+    hal.setJoinResult(false);
+    runUntil(worldStart + 13ul * 3600ul);
+    hal.setLinkDataRate(0);
+    hal.setUplinkResult(true);
+    hal.setJoinResult(true);
+    runUntil(worldStart + 16ul * 3600ul);
+
+    // the events are restored from the event log into packages which fit into DR0, none is lost
+    unsigned long counted = 0;
+    for (size_t i = 0; i < hal.getUplinks().size(); ++i)
+    {
+        const SimHAL::Uplink &u = hal.getUplinks()[i];
+        ASSERT_EQ(u.dataRate, 0);
+        ASSERT_LE(u.payload.size(), 51u);
+        counted += u.payload[0];
+    }
+    ASSERT_EQ(counted, 150ul);
+    ASSERT_TRUE(hal.getEventLog().empty());
+}
+
+TEST_F(BikeCounterTest, FloatingPinTests)
+{
+    bc->setMaxCount(60);
+
+    // a floating interrupt pin triggers continuously
+    for (int i = 0; i < 200; ++i)
+    {
+        hal.injectMotion(worldStart + 10ul * 3600ul + 300ul + i * 5ul);
+    }
+    runUntilCollecting();
+    bool errorDetected = false;
+    while (hal.worldEpoch() < worldStart + 10ul * 3600ul + 1400ul && !errorDetected)
+    {
+        bc->loop();
+        errorDetected = bc->getErrorId() == 2;
+    }
+    ASSERT_TRUE(errorDetected);
+}
+
+TEST_F(BikeCounterTest, DeltaFormatTests)
+{
+    bc->setPayloadFormat(DataPackage::PayloadFormat::deltaRice);
+
+    // twice the max. count of the fixed format (49) fits into the package of the timer call at 11:01
+    for (int i = 0; i < 98; ++i)
+    {
+        hal.injectMotion(worldStart + 9ul * 3600ul + 120ul + i * 70ul);
+    }
+    runUntilCollecting();
+    runUntil(worldStart + 11ul * 3600ul + 300ul);
+
+    const SimHAL::Uplink &u = hal.getUplinks().back();
+    ASSERT_EQ(u.payload[0], 98);
+    ASSERT_EQ(u.payload[4] & 0x07, 5); // delta format id
+    ASSERT_LE(u.payload.size(), 51u);
+    // no threshold call in between
+    int uplinksSince9 = 0;
+    for (size_t i = 0; i < hal.getUplinks().size(); ++i)
+    {
+        uplinksSince9 += hal.getUplinks()[i].worldEpoch > worldStart + 9ul * 3600ul + 120ul ? 1 : 0;
+    }
+    ASSERT_EQ(uplinksSince9, 1);
+}
+
+TEST_F(BikeCounterTest, HistogramFormatTests)
+{
+    bc->setPayloadFormat(DataPackage::PayloadFormat::smallest);
+
+    // race day: 400 riders within the 2h interval are sent with the timer call at 11:01 (no threshold calls)
+    for (int i = 0; i < 400; ++i)
+    {
+        hal.injectMotion(worldStart + 9ul * 3600ul + 120ul + i * 17ul);
+    }
+    runUntilCollecting();
+    runUntil(worldStart + 11ul * 3600ul + 300ul);
+
+    int uplinksSince9 = 0;
+    for (size_t i = 0; i < hal.getUplinks().size(); ++i)
+    {
+        uplinksSince9 += hal.getUplinks()[i].worldEpoch > worldStart + 9ul * 3600ul + 120ul ? 1 : 0;
+    }
+    ASSERT_EQ(uplinksSince9, 1);
+
+    const SimHAL::Uplink &u = hal.getUplinks().back();
+    ASSERT_EQ(u.payload[4] & 0x07, 6); // histogram format id
+    uint16_t bins[DataPackage::maxBinCount] = {0};
+    DataPackage decoded;
+    decoded.setBinArray(bins);
+    ASSERT_EQ(decoded.decodePayload(u.payload.data(), (int)u.payload.size()), 0);
+    int total = 0;
+    for (unsigned int i = 0; i < decoded.getHistogramBinCount(); ++i)
+    {
+        total += bins[i];
+    }
+    ASSERT_EQ(total, 400);
+}
+
+TEST_F(BikeCounterTest, HistogramFloatingPinTests)
+{
+    bc->setPayloadFormat(DataPackage::PayloadFormat::smallest);
+    bc->setMaxCount(300);
+
+    // a floating interrupt pin is detected although the histogram is not full
+    for (int i = 0; i < 400; ++i)
+    {
+        hal.injectMotion(worldStart + 9ul * 3600ul + 120ul + i * 5ul);
+    }
+    runUntilCollecting();
+    bool errorDetected = false;
+    while (hal.worldEpoch() < worldStart + 9ul * 3600ul + 2400ul && !errorDetected)
+    {
+        bc->loop();
+        errorDetected = bc->getErrorId() == 2;
+    }
+    ASSERT_TRUE(errorDetected);
+}
+
+TEST_F(BikeCounterTest, MotionDuringSendTests)
+{
+    // the threshold call after 49 motions is followed by riders passing while the package is sent
+    const uint32_t lastMotion = worldStart + 9ul * 3600ul + 300ul + 48ul * 30ul;
+    for (int i = 0; i < 49; ++i)
+    {
+        hal.injectMotion(worldStart + 9ul * 3600ul + 300ul + i * 30ul);
+    }
+    for (int i = 1; i <= 5; ++i)
+    {
+        hal.injectMotion(lastMotion + i * 2ul);
+    }
+    runUntilCollecting();
+    runUntil(worldStart + 11ul * 3600ul + 300ul);
+
+    // the motions captured during the send are counted with the timer call at 11:01
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_GE(uplinks.size(), 2u);
+    const SimHAL::Uplink &u = uplinks.back();
+    ASSERT_EQ(uplinks[uplinks.size() - 2].payload[0], 49);
+    ASSERT_EQ(u.payload[0], 5);
+    ASSERT_EQ(u.payload[4] >> 3, 9); // hour of the day of the first motion
+    ASSERT_EQ(hal.getDispatchedInterruptCount(), 54u);
+}
+
+TEST_F(BikeCounterTest, EventLogTests)
+{
+    for (int i = 0; i < 5; ++i)
+    {
+        hal.injectMotion(worldStart + 9ul * 3600ul + 300ul + i * 300ul);
+    }
+    runUntilCollecting();
+    while (hal.getEventLog().size() < 5u && hal.worldEpoch() < worldStart + 11ul * 3600ul)
+    {
+        bc->loop();
+    }
+    ASSERT_EQ(hal.getEventLog().size(), 5u);
+
+    // brownout at the timer call (the device slept until 11:01): the events are sent from the log after the restart
+    hal.clearUplinks();
+    hal.injectMotion(worldStart + 12ul * 3600ul);
+    bc->reset();
+    runUntil(worldStart + 11ul * 3600ul + 1800ul);
+
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    bool restored = false;
+    for (size_t i = 0; i < uplinks.size(); ++i)
+    {
+        restored |= uplinks[i].payload[0] == 5 && (uplinks[i].payload[4] >> 3) == 9;
+    }
+    ASSERT_TRUE(restored);
+
+    // the motion at 12:00 stays in the log until the timer call at 13:01 sends it
+    runUntil(worldStart + 12ul * 3600ul + 60ul);
+    ASSERT_EQ(hal.getEventLog().size(), 1u);
+    ASSERT_LE(std::abs((int32_t)(hal.getEventLog().front() - (worldStart + 12ul * 3600ul))), 60);
+    runUntil(worldStart + 13ul * 3600ul + 300ul);
+    ASSERT_TRUE(hal.getEventLog().empty());
+    ASSERT_EQ(hal.getUplinks().back().payload[0], 1);
+}
+
+TEST_F(BikeCounterTest, EventLogMidnightTests)
+{
+    // brownout after midnight: the unsent events of the 6h night interval (22:00 - 04:00) are restored from the log
+    runUntilCollecting();
+    runUntil(worldStart + 25ul * 3600ul);
+    const uint32_t night = worldStart + 22ul * 3600ul;
+    hal.eventLogAppend(night + 1800ul);
+    hal.eventLogAppend(night + 5400ul);
+    hal.eventLogAppend(night + 9000ul);
+    hal.eventLogAppend(night + 12600ul);
+    hal.clearUplinks();
+    bc->reset();
+    runUntil(hal.worldEpoch() + 3600ul);
+
+    // the restored package ends at midnight, the events after it go into the package of the next day
+    unsigned int minutes[DataPackage::maxDeltaCount];
+    std::vector<std::pair<int, std::vector<unsigned int>>> packages;
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    for (size_t i = 0; i < uplinks.size(); ++i)
+    {
+        DataPackage decoded;
+        decoded.setTimeArray(minutes);
+        ASSERT_EQ(decoded.decodePayload(uplinks[i].payload.data(), (int)uplinks[i].payload.size()), 0);
+        if (decoded.getMotionCount() > 0)
+        {
+            packages.push_back(std::make_pair((int)decoded.getHourOfTheDay(), std::vector<unsigned int>(minutes, minutes + decoded.getMotionCount())));
+        }
+    }
+    ASSERT_EQ(packages.size(), 2u);
+    ASSERT_EQ(packages[0].first, 22);
+    ASSERT_EQ(packages[0].second, (std::vector<unsigned int>{30u, 90u}));
+    ASSERT_EQ(packages[1].first, 0);
+    ASSERT_EQ(packages[1].second, (std::vector<unsigned int>{30u, 90u}));
+    ASSERT_TRUE(hal.getEventLog().empty());
+}
+
+TEST_F(BikeCounterTest, BacklogTests)
+{
+    // two riders in every 2h interval during a network outage from 9:00 to 15:00
+    for (int h = 9; h < 15; h += 2)
+    {
+        hal.injectMotion(worldStart + h * 3600ul + 600ul);
+        hal.injectMotion(worldStart + h * 3600ul + 4200ul);
+    }
+    runUntilCollecting();
+    runUntil(worldStart + 9ul * 3600ul);
+    hal.clearUplinks();
+    hal.setUplinkResult(false);
+    hal.setJoinResult(false);
+    runUntil(worldStart + 15ul * 3600ul);
+    ASSERT_TRUE(hal.getUplinks().empty());
+    ASSERT_EQ(hal.getEventLog().size(), 6u);
+
+    // the backlog is sent with the next retry (oldest first, starting with the empty package of 9:01)
+    // and the counts keep their interval
+    hal.setUplinkResult(true);
+    hal.setJoinResult(true);
+    runUntil(worldStart + 17ul * 3600ul);
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_GE(uplinks.size(), 4u);
+    ASSERT_EQ(uplinks[0].payload[0], 0);
+    for (size_t i = 1; i < 4; ++i)
+    {
+        ASSERT_EQ(uplinks[i].payload[0], 2);
+        ASSERT_EQ(uplinks[i].payload[4] >> 3, 7 + 2 * i);
+    }
+    ASSERT_TRUE(hal.getEventLog().empty());
+    ASSERT_EQ(hal.getDroppedInterruptCount(), 0u);
+
+    // the uplinks respect the duty cycle (airtime of a sub-band in the last hour)
+    ASSERT_GT(bc->getAirtimeLedger().getUplinkCount(), 4ul);
+    ASSERT_LE(bc->getAirtimeLedger().getPeakUsage(), AirtimeLedger::getBudget());
+}
+
+TEST_F(BikeCounterTest, DutyCycleTests)
+{
+    // far from a gateway (DR0 / SF12) a rush fills a package every 100s, more than the duty cycle allows
+    hal.setLinkDataRate(0);
+    bc->setMaxCount(100000);
+    const uint32_t rushStart = worldStart + 10ul * 3600ul + 60ul;
+    for (uint32_t t = 0; t < 3600ul; t += 2)
+    {
+        hal.injectMotion(rushStart + t);
+    }
+    runUntilCollecting();
+    runUntil(rushStart + 2ul * 3600ul);
+
+    // the airtime of the uplinks in any hour stays within the budget of the two sub-bands
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    for (size_t i = 0; i < uplinks.size(); ++i)
+    {
+        unsigned long airtime = 0;
+        for (size_t j = i; j < uplinks.size() && uplinks[j].millis < uplinks[i].millis + 3600000ull; ++j)
+        {
+            airtime += AirtimeLedger::getTimeOnAir(uplinks[j].payload.size(), 12);
+        }
+        ASSERT_LE(airtime, AirtimeLedger::subBandCount * AirtimeLedger::getBudget());
+    }
+    ASSERT_LE(bc->getAirtimeLedger().getPeakUsage(), AirtimeLedger::getBudget());
+    ASSERT_GT(bc->getAirtimeLedger().getPeakUsage(), AirtimeLedger::getBudget() - AirtimeLedger::getTimeOnAir(51, 12));
+    // the packages wait in the backlog, none is dropped (a dropped package would lose 49 motions,
+    // a full package only misses the few motions which arrive while it is handed over)
+    unsigned long counted = 0;
+    for (size_t i = 0; i < uplinks.size(); ++i)
+    {
+        counted += uplinks[i].payload[0];
+    }
+    ASSERT_GE(counted, 1800ul - 10ul);
+}
+
+TEST_F(BikeCounterTest, DelayedBacklogTests)
+{
+    // network outage from 9:00 to 15:00 on the third day, more than 24h after the time correction of the sync call
+    const uint32_t day = worldStart + 2ul * 86400ul;
+    for (int h = 9; h < 15; h += 2)
+    {
+        hal.injectMotion(day + h * 3600ul + 600ul);
+    }
+    runUntilCollecting();
+    runUntil(day + 9ul * 3600ul);
+    ASSERT_EQ(hal.getDownlinkCount(), 1u);
+    hal.clearUplinks();
+    hal.setUplinkResult(false);
+    hal.setJoinResult(false);
+    runUntil(day + 15ul * 3600ul);
+    hal.setUplinkResult(true);
+    hal.setJoinResult(true);
+    runUntil(day + 17ul * 3600ul);
+
+    // the packages of the timer calls at 9:01, 11:01, 13:01 and 15:01 are marked as delayed and keep their device time
+    // (the package of 15:01 is sent after the three older ones, more than 2 min after its timer call)
+    const std::vector<SimHAL::Uplink> &uplinks = hal.getUplinks();
+    ASSERT_GE(uplinks.size(), 4u);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        ASSERT_EQ(uplinks[i].payload[0], i == 0 ? 0 : 1);
+        ASSERT_EQ(uplinks[i].payload[2] & DataPackage::delayedStatus, DataPackage::delayedStatus);
+        uint32_t deviceTime = DataPackage::getPayloadDeviceTime(uplinks[i].payload.data(), (int)uplinks[i].payload.size());
+        ASSERT_LE(std::abs((int32_t)(deviceTime - (day + (9ul + 2ul * i) * 3600ul + 60ul))), 60);
+    }
+
+    // no time correction: the RTC keeps the real time and the drift estimate is not touched
+    ASSERT_EQ(hal.getDownlinkCount(), 1u);
+    ASSERT_LE(std::abs((int32_t)(hal.rtcGetEpoch() - hal.worldEpoch())), 60);
+    ASSERT_EQ(hal.getStateWriteCount(HAL::STATE_RTC_DRIFT), 0u);
+}
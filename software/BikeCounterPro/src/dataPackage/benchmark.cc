@@ -0,0 +1,50 @@
+#include <benchmark/benchmark.h>
+#include "dataPackage.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+namespace
+{
+    // timer interval in minutes and max. motion count of every interval id (DataPackage::TimerInterval)
+    const int intervalTimes[5] = {60, 120, 240, 480, 1020};
+    const int maxCounts[5] = {57, 49, 43, 38, 34};
+
+    // every interval with the motion counts 0, 1, 8, 16, ... up to the max. count
+    void intervalAndCountArgs(benchmark::internal::Benchmark *b)
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            b->Args({intervalTimes[i], 0});
+            b->Args({intervalTimes[i], 1});
+            for (int count = 8; count < maxCounts[i]; count += 8)
+            {
+                b->Args({intervalTimes[i], count});
+            }
+            b->Args({intervalTimes[i], maxCounts[i]});
+        }
+    }
+}
+
+static void BM_GetPayload(benchmark::State &state, DataPackage::PayloadFormat format)
+{
+    unsigned int intervalTime = (unsigned int)state.range(0);
+    uint8_t count = (uint8_t)state.range(1);
+    unsigned int timeArray[57];
+    for (int i = 0; i < 57; ++i)
+    {
+        timeArray[i] = i * intervalTime / 57;
+    }
+    DataPackage dp(intervalTime, count, 1, 1, 0, 21, 17, 3, 12, 1717200000ul, timeArray);
+    dp.setPayloadFormat(format);
+
+    uint8_t payload[DataPackage::maxPayloadSize];
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(dp.encodePayload(payload));
+        benchmark::ClobberMemory();
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+    state.SetBytesProcessed((int64_t)state.iterations() * dp.getPayloadLength());
+}
+BENCHMARK_CAPTURE(BM_GetPayload, fixed, DataPackage::PayloadFormat::fixedBits)->Apply(intervalAndCountArgs)->ArgNames({"interval", "count"});
+BENCHMARK_CAPTURE(BM_GetPayload, delta, DataPackage::PayloadFormat::deltaRice)->Apply(intervalAndCountArgs)->ArgNames({"interval", "count"});
@@ -0,0 +1,159 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Writes fields of 1 - 32 bits lsb first into a byte buffer
+ * The bits are collected in a 32 bit accumulator and stored byte by byte as soon as 8 bits are available,
+ * so a field costs a few shifts instead of a bitRead/bitWrite per bit.
+ * Writing beyond the capacity of the buffer sets the overflow flag and the data is discarded.
+ */
+class BitStreamWriter
+{
+public:
+    /**
+     * @brief Construct a new Bit Stream Writer object
+     * @param buf destination buffer
+     * @param cap capacity of the buffer in bytes
+     */
+    BitStreamWriter(uint8_t *buf, size_t cap) : buffer(buf), capacity(cap) {}
+
+    /**
+     * @brief Appends the lower bitCount bits of value
+     * @param value field value (higher bits are ignored)
+     * @param bitCount number of bits (0 - 32)
+     */
+    void write(uint32_t value, unsigned int bitCount)
+    {
+        if (bitCount > 24)
+        {
+            // the accumulator holds max. 7 pending bits, split large fields to stay within 32 bits
+            write(value & 0xffff, 16);
+            value >>= 16;
+            bitCount -= 16;
+        }
+        if (bitCount < 32)
+        {
+            value &= (((uint32_t)1) << bitCount) - 1;
+        }
+        accumulator |= value << pendingBits;
+        pendingBits += bitCount;
+        while (pendingBits >= 8)
+        {
+            storeByte((uint8_t)(accumulator & 0xff));
+            accumulator >>= 8;
+            pendingBits -= 8;
+        }
+    }
+
+    /**
+     * @brief Stores the pending bits (padded with zeros) to the buffer
+     * @return size_t number of written bytes
+     */
+    size_t flush()
+    {
+        if (pendingBits > 0)
+        {
+            storeByte((uint8_t)(accumulator & 0xff));
+            accumulator = 0;
+            pendingBits = 0;
+        }
+        return length;
+    }
+
+    /// @brief number of written bits (including the pending bits)
+    size_t getBitCount() const { return length * 8 + pendingBits; }
+    /// @brief number of complete bytes stored in the buffer
+    size_t getLength() const { return length; }
+    /// @brief true if a write exceeded the capacity of the buffer
+    bool hasOverflow() const { return overflow; }
+
+private:
+    uint8_t *buffer;
+    size_t capacity;
+    size_t length = 0;
+    uint32_t accumulator = 0;
+    unsigned int pendingBits = 0;
+    bool overflow = false;
+
+    void storeByte(uint8_t b)
+    {
+        if (length < capacity)
+        {
+            buffer[length++] = b;
+        }
+        else
+        {
+            overflow = true;
+        }
+    }
+};
+
+/**
+ * @brief Reads fields of 1 - 32 bits lsb first from a byte buffer (counterpart of the BitStreamWriter)
+ * Reading beyond the end of the buffer returns zero bits and sets the underflow flag.
+ */
+class BitStreamReader
+{
+public:
+    /**
+     * @brief Construct a new Bit Stream Reader object
+     * @param buf source buffer
+     * @param len length of the buffer in bytes
+     */
+    BitStreamReader(const uint8_t *buf, size_t len) : buffer(buf), length(len) {}
+
+    /**
+     * @brief Reads the next field
+     * @param bitCount number of bits (0 - 32)
+     * @return uint32_t field value
+     */
+    uint32_t read(unsigned int bitCount)
+    {
+        if (bitCount > 24)
+        {
+            uint32_t low = read(16);
+            return low | (read(bitCount - 16) << 16);
+        }
+        while (availableBits < bitCount)
+        {
+            accumulator |= ((uint32_t)loadByte()) << availableBits;
+            availableBits += 8;
+        }
+        uint32_t value = accumulator;
+        if (bitCount < 32)
+        {
+            value &= (((uint32_t)1) << bitCount) - 1;
+        }
+        accumulator = bitCount < 32 ? accumulator >> bitCount : 0;
+        availableBits -= bitCount;
+        return value;
+    }
+
+    /// @brief number of bits which can still be read
+    size_t getRemainingBits() const { return (length - position) * 8 + availableBits; }
+    /// @brief true if a read exceeded the end of the buffer
+    bool hasUnderflow() const { return underflow; }
+
+private:
+    const uint8_t *buffer;
+    size_t length;
+    size_t position = 0;
+    uint32_t accumulator = 0;
+    unsigned int availableBits = 0;
+    bool underflow = false;
+
+    uint8_t loadByte()
+    {
+        if (position < length)
+        {
+            return buffer[position++];
+        }
+        underflow = true;
+        return 0;
+    }
+};
+
+#endif // BITSTREAM_H
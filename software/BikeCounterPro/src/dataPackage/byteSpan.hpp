@@ -0,0 +1,33 @@
+#ifndef BYTESPAN_H
+#define BYTESPAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Non-owning view of a byte buffer (std::span<uint8_t> is C++20, the firmware is built with C++11)
+ * Hands the buffer of the owner (e.g. a packet slot of the LoRaConnector) to an encoder without a copy.
+ */
+class ByteSpan
+{
+public:
+    ByteSpan() : ptr(nullptr), length(0) {}
+    ByteSpan(uint8_t *data, size_t size) : ptr(data), length(size) {}
+    template <size_t N>
+    ByteSpan(uint8_t (&array)[N]) : ptr(array), length(N) {}
+
+    uint8_t *data() const { return ptr; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    uint8_t *begin() const { return ptr; }
+    uint8_t *end() const { return ptr + length; }
+    uint8_t &operator[](size_t index) const { return ptr[index]; }
+    /// @brief view of the first count bytes (max. size())
+    ByteSpan first(size_t count) const { return ByteSpan(ptr, count < length ? count : length); }
+
+private:
+    uint8_t *ptr;
+    size_t length;
+};
+
+#endif // BYTESPAN_H
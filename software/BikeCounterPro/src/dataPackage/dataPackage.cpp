@@ -1,9 +1,13 @@
 #include "dataPackage.hpp"
+#include "bitStream.hpp"
 
-#define bitSet(value, bit) ((value) |= (1UL << (bit)))
-#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
-#define bitWrite(value, bit, bitValue) (bitValue ? bitSet(value, bit) : bitClear(value, bit))
-#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+const size_t DataPackage::basePayloadSize;
+const size_t DataPackage::maxPayloadSize;
+const int DataPackage::maxDeltaCount;
+const unsigned int DataPackage::binMinutes;
+const unsigned int DataPackage::maxBinCount;
+const uint8_t DataPackage::delayedStatus;
+const uint32_t DataPackage::startEpoch;
 
 DataPackage::DataPackage(unsigned int intervalTime,
                          uint8_t count,
@@ -58,84 +62,435 @@ void DataPackage::setTimerInterval(unsigned int intervalTime)
     }
 }
 
-uint8_t *DataPackage::getPayload()
+void DataPackage::setHistogramBinMinutes(unsigned int minutes)
 {
-    // reset array to avoid sending old data
-    // this should not happen due to the payload length property (getPayloadLength()) but you never know
-    for (int i = 0; i < 51; ++i)
+    histogramWidth = 0;
+    while (histogramWidth < 3 && histogramMinutes[histogramWidth] < minutes)
     {
-        payload[i] = 0;
+        ++histogramWidth;
     }
+}
 
-    // 1. byte - counter value
-    payload[0] = (uint8_t)(motionCount & 0xff);
+DataPackage::PayloadFormat DataPackage::getEncodedFormat() const
+{
+    if (payloadFormat != smallest)
+    {
+        return payloadFormat;
+    }
 
-    // 2. byte - software and hardware version
-    uint8_t swAndHwVersion;
-    bitWrite(swAndHwVersion, 0, bitRead(swVersion, 0));
-    bitWrite(swAndHwVersion, 1, bitRead(swVersion, 1));
-    bitWrite(swAndHwVersion, 2, bitRead(swVersion, 2));
-    bitWrite(swAndHwVersion, 3, bitRead(swVersion, 3));
-    bitWrite(swAndHwVersion, 4, bitRead(hwVersion, 0));
-    bitWrite(swAndHwVersion, 5, bitRead(hwVersion, 1));
-    bitWrite(swAndHwVersion, 6, bitRead(hwVersion, 2));
-    bitWrite(swAndHwVersion, 7, bitRead(hwVersion, 3));
-    payload[1] = swAndHwVersion;
+    // the per motion formats are only valid if they contain every motion of the bin array
+    uint32_t total = (binVector != nullptr) ? binTotal() : motionCount;
+    PayloadFormat best = (binVector != nullptr) ? histogram : deltaRice;
+    unsigned int bestBits = (binVector != nullptr) ? payloadBits(histogram) : 0xffffffff;
+    PayloadFormat perMotion[2] = {fixedBits, deltaRice};
+    for (int i = 1; i >= 0; --i)
+    {
+        if (total == motionCount && encodedMotionCount(perMotion[i]) == motionCount)
+        {
+            unsigned int bits = payloadBits(perMotion[i]);
+            if (bits <= bestBits)
+            {
+                best = perMotion[i];
+                bestBits = bits;
+            }
+        }
+    }
+    return best;
+}
 
-    // 3. byte - status and battery Voltage
-    uint8_t statusAndBat;
-    bitWrite(statusAndBat, 0, bitRead(status, 0));
-    bitWrite(statusAndBat, 1, bitRead(status, 1));
-    bitWrite(statusAndBat, 2, bitRead(status, 2));
-    bitWrite(statusAndBat, 3, bitRead(batteryVoltage, 0));
-    bitWrite(statusAndBat, 4, bitRead(batteryVoltage, 1));
-    bitWrite(statusAndBat, 5, bitRead(batteryVoltage, 2));
-    bitWrite(statusAndBat, 6, bitRead(batteryVoltage, 3));
-    bitWrite(statusAndBat, 7, bitRead(batteryVoltage, 4));
-    payload[2] = statusAndBat;
+int DataPackage::getPayloadLength() const
+{
+    return (int)((payloadBits(getEncodedFormat()) + 7) / 8);
+}
 
-    // 4. byte - temperature and humidity
-    uint8_t tempAndHum;
-    bitWrite(tempAndHum, 0, bitRead(temperature, 0));
-    bitWrite(tempAndHum, 1, bitRead(temperature, 1));
-    bitWrite(tempAndHum, 2, bitRead(temperature, 2));
-    bitWrite(tempAndHum, 3, bitRead(temperature, 3));
-    bitWrite(tempAndHum, 4, bitRead(temperature, 4));
-    bitWrite(tempAndHum, 5, bitRead(humidity, 0));
-    bitWrite(tempAndHum, 6, bitRead(humidity, 1));
-    bitWrite(tempAndHum, 7, bitRead(humidity, 2));
-    payload[3] = tempAndHum;
-
-    // 5. byte - interval index and hour of the day
-    uint8_t indexAndHOD;
-    bitWrite(indexAndHOD, 0, bitRead(selectedInterval, 0));
-    bitWrite(indexAndHOD, 1, bitRead(selectedInterval, 1));
-    bitWrite(indexAndHOD, 2, bitRead(selectedInterval, 2));
-    bitWrite(indexAndHOD, 3, bitRead(hourOfTheDay, 0));
-    bitWrite(indexAndHOD, 4, bitRead(hourOfTheDay, 1));
-    bitWrite(indexAndHOD, 5, bitRead(hourOfTheDay, 2));
-    bitWrite(indexAndHOD, 6, bitRead(hourOfTheDay, 3));
-    bitWrite(indexAndHOD, 7, bitRead(hourOfTheDay, 4));
-    payload[4] = indexAndHOD;
+bool DataPackage::isPayloadFull() const
+{
+    PayloadFormat format = (payloadFormat == smallest && binVector == nullptr) ? deltaRice : payloadFormat;
+    if (format == deltaRice)
+    {
+        // the next motion costs max. one escaped Rice code (with the current parameter)
+        sortTimeVector();
+        unsigned int bits = offsetBits + riceParameterBits + deltaBits(bestRiceParameter(motionCount), motionCount);
+        return (motionCount >= maxDeltaCount) || (bits + riceMaxQuotient + riceEscapeBits > payloadSize * 8);
+    }
+    if (format == histogram || format == smallest)
+    {
+        // the next motion might add one bit to every bin of the widest histogram up to the end of the interval
+        unsigned int widest = 3;
+        unsigned int bins = (intervalSpan[selectedInterval] + histogramMinutes[widest] - 1) / histogramMinutes[widest];
+        unsigned int usedBins = histogramUsedBins(widest);
+        bins = usedBins > bins ? usedBins : bins;
+        unsigned int valueBits = histogramValueBits(widest);
+        bool binOverflow = false;
+        for (unsigned int i = 0; i < usedBins; ++i)
+        {
+            binOverflow = binOverflow || histogramBin(widest, i) >= ((((uint32_t)1) << 15) - 1);
+        }
+        for (unsigned int i = 0; binVector != nullptr && i < maxBinCount; ++i)
+        {
+            binOverflow = binOverflow || binVector[i] == 0xffff;
+        }
+        return binOverflow ||
+               (offsetBits + histogramWidthBits + histogramBinCountBits + histogramCountBits + bins * (valueBits + 1) > payloadSize * 8);
+    }
+    return motionCount >= fixedMaxCount(payloadSize);
+}
 
+size_t DataPackage::encodePayload(ByteSpan buffer)
+{
+    PayloadFormat format = getEncodedFormat();
+    size_t length = (payloadBits(format) + 7) / 8;
+    if (buffer.size() < length)
+    {
+        return 0;
+    }
+    // motions which do not fit into the payload anymore are dropped
+    uint32_t count = encodedMotionCount(format);
+    unsigned int formatId = selectedInterval;
+    if (format == deltaRice)
+    {
+        formatId = deltaFormatId;
+    }
+    else if (format == histogram)
+    {
+        formatId = histogramFormatId;
+    }
+
+    BitStreamWriter writer(buffer.data(), length);
+    // 1. byte - counter value
+    writer.write(count > 255 ? 255 : count, 8);
+    // 2. byte - software and hardware version
+    writer.write(swVersion, 4);
+    writer.write(hwVersion, 4);
+    // 3. byte - status and battery Voltage
+    writer.write(status, 3);
+    writer.write(batteryVoltage, bitCountBat);
+    // 4. byte - temperature and humidity
+    writer.write(temperature, bitCountTemp);
+    writer.write(humidity, bitCountHum);
+    // 5. byte - interval index (or format id) and hour of the day
+    writer.write(formatId, 3);
+    writer.write(hourOfTheDay, 5);
     // 6. - 8. byte - device time
-    uint32_t deviceTimeMinutes = (deviceTime - startEpoch) / 60;
-    payload[5] = (uint8_t)(deviceTimeMinutes & 0xff);
-    payload[6] = (uint8_t)((deviceTimeMinutes >> 8) & 0xff);
-    payload[7] = (uint8_t)((deviceTimeMinutes >> 16) & 0xff);
+    writer.write((deviceTime - startEpoch) / 60, bitCountTime);
 
     // 9. - 51. byte - detected minutes
-    for (int payloadBit = offsetBits; payloadBit < ((motionCount * minuteBits[selectedInterval]) + offsetBits); ++payloadBit)
+    if (format == deltaRice)
+    {
+        // Rice parameter followed by the gaps between the sorted minutes
+        // gap: quotient (gap >> k) as unary code (ones terminated by a zero) and the k lower bits
+        // gaps with a quotient >= riceMaxQuotient are escaped: riceMaxQuotient ones and the gap with riceEscapeBits
+        unsigned int k = bestRiceParameter(count);
+        writer.write(k, riceParameterBits);
+        unsigned int previous = 0;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            unsigned int gap = timeVector[i] - previous;
+            unsigned int quotient = gap >> k;
+            if (quotient < riceMaxQuotient)
+            {
+                writer.write((((uint32_t)1) << quotient) - 1, quotient + 1);
+                writer.write(gap, k);
+            }
+            else
+            {
+                writer.write((((uint32_t)1) << riceMaxQuotient) - 1, riceMaxQuotient);
+                writer.write(gap, riceEscapeBits);
+            }
+            previous = timeVector[i];
+        }
+    }
+    else if (format == histogram)
+    {
+        // bin width index, bin count, bit count of the bins followed by the motion count of every bin
+        unsigned int width = histogramFitWidth();
+        unsigned int bins = histogramEncodedBins(width);
+        unsigned int valueBits = histogramValueBits(width);
+        writer.write(width, histogramWidthBits);
+        writer.write(bins, histogramBinCountBits);
+        writer.write(valueBits, histogramCountBits);
+        for (unsigned int i = 0; i < bins; ++i)
+        {
+            writer.write(histogramBin(width, i), valueBits);
+        }
+    }
+    else
+    {
+        unsigned int bits = minuteBits[selectedInterval];
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            writer.write(timeVector[i], bits);
+        }
+    }
+    return writer.flush();
+}
+
+int DataPackage::decodePayload(const uint8_t *data, int length)
+{
+    if (length < (int)(offsetBits / 8))
+    {
+        return 1;
+    }
+
+    BitStreamReader reader(data, length);
+    motionCount = reader.read(8);
+    swVersion = reader.read(4);
+    hwVersion = reader.read(4);
+    status = reader.read(3);
+    batteryVoltage = reader.read(bitCountBat);
+    temperature = reader.read(bitCountTemp);
+    humidity = reader.read(bitCountHum);
+    unsigned int intervalId = reader.read(3);
+    hourOfTheDay = reader.read(5);
+    deviceTime = startEpoch + reader.read(bitCountTime) * 60;
+
+    if (intervalId == deltaFormatId)
+    {
+        payloadFormat = deltaRice;
+        if (motionCount > maxDeltaCount)
+        {
+            return 1;
+        }
+        unsigned int k = reader.read(riceParameterBits);
+        unsigned int value = 0;
+        for (unsigned int i = 0; i < motionCount; ++i)
+        {
+            unsigned int quotient = 0;
+            while (quotient < riceMaxQuotient && reader.read(1) == 1)
+            {
+                ++quotient;
+            }
+            value += (quotient < riceMaxQuotient) ? ((quotient << k) | reader.read(k)) : reader.read(riceEscapeBits);
+            if (reader.hasUnderflow())
+            {
+                return 1;
+            }
+            if (timeVector != nullptr)
+            {
+                timeVector[i] = value;
+            }
+        }
+        return 0;
+    }
+
+    if (intervalId == histogramFormatId)
+    {
+        payloadFormat = histogram;
+        histogramWidth = reader.read(histogramWidthBits);
+        histogramBinCount = reader.read(histogramBinCountBits);
+        unsigned int valueBits = reader.read(histogramCountBits);
+        if (histogramBinCount > maxBinCount)
+        {
+            return 1;
+        }
+        for (unsigned int i = 0; i < histogramBinCount; ++i)
+        {
+            uint32_t value = reader.read(valueBits);
+            if (binVector != nullptr)
+            {
+                binVector[i] = (uint16_t)value;
+            }
+        }
+        return reader.hasUnderflow() ? 1 : 0;
+    }
+
+    if (intervalId > max_17h)
+    {
+        return 2;
+    }
+    payloadFormat = fixedBits;
+    selectedInterval = (TimerInterval)intervalId;
+    // the budget of the sender is unknown, the payload holds at least the encoded minutes
+    size_t budget = (size_t)length > payloadSize ? (size_t)length : payloadSize;
+    if (motionCount > fixedMaxCount(budget < maxPayloadSize ? budget : maxPayloadSize) || length < getPayloadLength())
+    {
+        return 1;
+    }
+
+    unsigned int bits = minuteBits[selectedInterval];
+    for (unsigned int i = 0; i < motionCount && timeVector != nullptr; ++i)
+    {
+        timeVector[i] = reader.read(bits);
+    }
+
+    return 0;
+}
+
+unsigned int DataPackage::payloadBits(PayloadFormat format) const
+{
+    unsigned int count = encodedMotionCount(format);
+    if (format == deltaRice)
+    {
+        return offsetBits + riceParameterBits + deltaBits(bestRiceParameter(count), count);
+    }
+    if (format == histogram)
+    {
+        return offsetBits + histogramBits(histogramFitWidth());
+    }
+    return offsetBits + count * minuteBits[selectedInterval];
+}
+
+unsigned int DataPackage::encodedMotionCount(PayloadFormat format) const
+{
+    if (format == deltaRice)
+    {
+        sortTimeVector();
+        unsigned int count = motionCount < maxDeltaCount ? motionCount : maxDeltaCount;
+        while (count > 0 && offsetBits + riceParameterBits + deltaBits(bestRiceParameter(count), count) > payloadSize * 8)
+        {
+            --count;
+        }
+        return count;
+    }
+    if (format == histogram)
+    {
+        unsigned int width = histogramFitWidth();
+        unsigned int bins = histogramEncodedBins(width);
+        uint32_t total = 0;
+        for (unsigned int i = 0; i < bins; ++i)
+        {
+            total += histogramBin(width, i);
+        }
+        return total;
+    }
+    int maxCount = fixedMaxCount(payloadSize);
+    return motionCount < maxCount ? motionCount : maxCount;
+}
+
+uint32_t DataPackage::histogramBin(unsigned int width, unsigned int bin) const
+{
+    // sum of the bins of the bin array (binMinutes) which belong to the histogram bin
+    unsigned int factor = histogramMinutes[width] / binMinutes;
+    uint32_t sum = 0;
+    for (unsigned int i = bin * factor; i < (bin + 1) * factor && i < maxBinCount; ++i)
     {
-        unsigned int currentMotionByte = (payloadBit - offsetBits) / minuteBits[selectedInterval];
-        unsigned int currentMotionBit = (payloadBit - offsetBits) % minuteBits[selectedInterval];
-        unsigned int currentPayloadByte = payloadBit / 8;
-        unsigned int currentPayloadBit = payloadBit % 8;
+        sum += binVector[i];
+    }
+    // the max. value of a bin is limited by the count bit count field
+    uint32_t maxValue = (((uint32_t)1) << ((1u << histogramCountBits) - 1)) - 1;
+    return sum < maxValue ? sum : maxValue;
+}
 
-        bitWrite(payload[currentPayloadByte], currentPayloadBit, bitRead(timeVector[currentMotionByte], currentMotionBit));
+unsigned int DataPackage::histogramUsedBins(unsigned int width) const
+{
+    // bins up to the last bin with a motion
+    if (binVector == nullptr)
+    {
+        return 0;
     }
+    unsigned int used = maxBinCount;
+    while (used > 0 && binVector[used - 1] == 0)
+    {
+        --used;
+    }
+    unsigned int factor = histogramMinutes[width] / binMinutes;
+    return (used + factor - 1) / factor;
+}
 
-    return payload;
+unsigned int DataPackage::histogramValueBits(unsigned int width) const
+{
+    uint32_t maxValue = 0;
+    unsigned int bins = histogramUsedBins(width);
+    for (unsigned int i = 0; i < bins; ++i)
+    {
+        uint32_t value = histogramBin(width, i);
+        maxValue = value > maxValue ? value : maxValue;
+    }
+    unsigned int bits = 0;
+    while (maxValue >> bits)
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+unsigned int DataPackage::histogramEncodedBins(unsigned int width) const
+{
+    // the bins at the end which do not fit into the payload are dropped
+    unsigned int bins = histogramUsedBins(width);
+    unsigned int valueBits = histogramValueBits(width);
+    unsigned int availableBits = payloadSize * 8 - offsetBits - histogramWidthBits - histogramBinCountBits - histogramCountBits;
+    if (valueBits > 0 && bins * valueBits > availableBits)
+    {
+        bins = availableBits / valueBits;
+    }
+    return bins;
+}
+
+unsigned int DataPackage::histogramBits(unsigned int width) const
+{
+    return histogramWidthBits + histogramBinCountBits + histogramCountBits + histogramEncodedBins(width) * histogramValueBits(width);
+}
+
+unsigned int DataPackage::histogramFitWidth() const
+{
+    // the selected bin width or the next wider one which fits into the payload
+    unsigned int width = histogramWidth;
+    while (width < 3 && histogramUsedBins(width) > histogramEncodedBins(width))
+    {
+        ++width;
+    }
+    return width;
+}
+
+uint32_t DataPackage::binTotal() const
+{
+    uint32_t total = 0;
+    for (unsigned int i = 0; binVector != nullptr && i < maxBinCount; ++i)
+    {
+        total += binVector[i];
+    }
+    return total;
+}
+
+void DataPackage::sortTimeVector() const
+{
+    // insertion sort, the minutes are usually already in ascending order (linear time)
+    for (unsigned int i = 1; i < motionCount; ++i)
+    {
+        unsigned int value = timeVector[i];
+        unsigned int j = i;
+        while (j > 0 && timeVector[j - 1] > value)
+        {
+            timeVector[j] = timeVector[j - 1];
+            --j;
+        }
+        timeVector[j] = value;
+    }
+}
+
+unsigned int DataPackage::riceBits(unsigned int value, unsigned int k) const
+{
+    unsigned int quotient = value >> k;
+    return (quotient < riceMaxQuotient) ? quotient + 1 + k : riceMaxQuotient + riceEscapeBits;
+}
+
+unsigned int DataPackage::deltaBits(unsigned int k, unsigned int count) const
+{
+    unsigned int bits = 0;
+    unsigned int previous = 0;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        bits += riceBits(timeVector[i] - previous, k);
+        previous = timeVector[i];
+    }
+    return bits;
+}
+
+unsigned int DataPackage::bestRiceParameter(unsigned int count) const
+{
+    unsigned int bestK = 0;
+    unsigned int bestBits = deltaBits(0, count);
+    for (unsigned int k = 1; k < (1u << riceParameterBits); ++k)
+    {
+        unsigned int bits = deltaBits(k, count);
+        if (bits < bestBits)
+        {
+            bestBits = bits;
+            bestK = k;
+        }
+    }
+    return bestK;
 }
 
 uint8_t DataPackage::reduceFloat(float value, float min, float max, unsigned int bitCount)
@@ -194,5 +549,49 @@ float DataPackage::getHumidity() const
 int DataPackage::getMaxCount(unsigned int intervalTime)
 {
     setTimerInterval(intervalTime);
-    return maxCount[selectedInterval];
-}
\ No newline at end of file
+    return fixedMaxCount(payloadSize);
+}
+
+int DataPackage::fixedMaxCount(size_t size) const
+{
+    // minutes which fit behind the header (57, 49, 43, 38 and 34 with the base payload size)
+    int count = (int)((size * 8 - offsetBits) / minuteBits[selectedInterval]);
+    return count < maxDeltaCount ? count : maxDeltaCount;
+}
+
+void DataPackage::setPayloadSize(size_t size)
+{
+    payloadSize = size < basePayloadSize ? basePayloadSize : (size > maxPayloadSize ? maxPayloadSize : size);
+}
+
+uint32_t DataPackage::getPayloadDeviceTime(const uint8_t *data, int length)
+{
+    if (length < 8)
+    {
+        return 0;
+    }
+    // 6. - 8. byte - device time (minutes since startEpoch, lsb first)
+    return startEpoch + (((uint32_t)data[7] << 16) | ((uint32_t)data[6] << 8) | data[5]) * 60ul;
+}
+
+void DataPackage::setPayloadDeviceTime(uint8_t *data, int length, uint32_t epoch)
+{
+    if (length < 8 || epoch < startEpoch)
+    {
+        return;
+    }
+    uint32_t minutes = (epoch - startEpoch) / 60ul;
+    data[5] = (uint8_t)(minutes & 0xff);
+    data[6] = (uint8_t)((minutes >> 8) & 0xff);
+    data[7] = (uint8_t)((minutes >> 16) & 0xff);
+}
+
+void DataPackage::setPayloadDelayed(uint8_t *data, int length)
+{
+    // 3. byte - status in the lower 3 bits
+    if (length < 8 || (data[2] & 0x07) == 7)
+    {
+        return;
+    }
+    data[2] |= delayedStatus;
+}
@@ -3,10 +3,38 @@
 
 #include <math.h>
 #include <stdint.h>
+#include "byteSpan.hpp"
 
 class DataPackage
 {
 public:
+    /**
+     * @brief Encoding of the detected minutes
+     * fixedBits: every minute with the bit count of the timer interval (interval id 0 - 4)
+     * deltaRice: the sorted minutes as Rice coded gaps (interval id 5), fits more motions into a package
+     * as riders arrive in bursts
+     * histogram: motion count per time bin (interval id 6), the size does not depend on the motion count
+     * smallest: the smallest of the above formats for every package
+     */
+    enum PayloadFormat
+    {
+        fixedBits,
+        deltaRice,
+        histogram,
+        smallest
+    };
+    // max. payload size of an EU868 uplink at DR0 - DR2 (default budget) and at DR4 - DR7
+    static const size_t basePayloadSize = 51;
+    static const size_t maxPayloadSize = 222;
+    // max. motion count of the deltaRice and fixedBits formats (time array of the BikeCounter)
+    static const int maxDeltaCount = 200;
+    // time span of a bin of the bin array in minutes
+    static const unsigned int binMinutes = 5;
+    // bin array size (24h)
+    static const unsigned int maxBinCount = 288;
+    // status bit of a package which was sent later than it was encoded (status 7 = time sync call is never delayed)
+    static const uint8_t delayedStatus = 0x04;
+
     /**
      * @brief Construct a new Data Package object
      * The DataPackage object handles the protocol encoding/decoding to send the lora data
@@ -61,11 +89,88 @@ public:
     uint32_t getDeviceTime() const { return deviceTime; }
     void setTimeArray(unsigned int *arr) { timeVector = arr; }
     unsigned int *getTimeArray() const { return timeVector; }
+    /**
+     * @brief Motion counts per binMinutes since the hour of the day (maxBinCount entries), used by the histogram format
+     * The decoder stores the counts of the decoded bins (see getHistogramBinMinutes()).
+     * @param arr pointer to the bin array
+     */
+    void setBinArray(uint16_t *arr) { binVector = arr; }
+    uint16_t *getBinArray() const { return binVector; }
+    void setPayloadFormat(PayloadFormat f) { payloadFormat = f; }
+    PayloadFormat getPayloadFormat() const { return payloadFormat; }
+    /**
+     * @brief Format of the payload written by encodePayload() (resolves the smallest format)
+     * @return PayloadFormat fixedBits, deltaRice or histogram
+     */
+    PayloadFormat getEncodedFormat() const;
+    /**
+     * @brief Time span of the histogram bins (5, 10, 15 or 30 minutes)
+     * Wider bins are used if the histogram does not fit into the payload.
+     * @param minutes
+     */
+    void setHistogramBinMinutes(unsigned int minutes);
+    unsigned int getHistogramBinMinutes() const { return histogramMinutes[histogramWidth]; }
+    /**
+     * @brief Number of bins of the last decoded histogram
+     * @return unsigned int
+     */
+    unsigned int getHistogramBinCount() const { return histogramBinCount; }
+    /**
+     * @brief Payload budget of the current data rate (see LoRaConnector::getMaxPayloadSize())
+     * The max. counts and with them the send threshold grow with the budget.
+     * @param size bytes (limited to basePayloadSize - maxPayloadSize)
+     */
+    void setPayloadSize(size_t size);
+    size_t getPayloadSize() const { return payloadSize; }
     // payload operations
-    int getPayloadLength() const { return (int)(offsetBits / 8) + (int)ceil(((float)(motionCount * minuteBits[selectedInterval])) / 8.0f); }
-    uint8_t *getPayload();
+    int getPayloadLength() const;
+    /**
+     * @brief Encodes the payload into a buffer of the caller (e.g. the packet slot of the LoRaConnector)
+     * Only the getPayloadLength() bytes of the payload are written, the rest of the buffer is not touched.
+     * The deltaRice format sorts the time array in place (the minutes are recorded in ascending order anyway).
+     * Motions which exceed the capacity of the payload (see isPayloadFull()) are not encoded.
+     * @param buffer destination (getPayloadSize() bytes are always enough)
+     * @return size_t payload length, 0 if the buffer is too small
+     */
+    size_t encodePayload(ByteSpan buffer);
+    /**
+     * @brief Checks if the next motion might not fit into the payload anymore
+     * Like encodePayload(), the deltaRice format sorts the time array in place to count the bits of the gaps.
+     * @return true if the package should be sent
+     */
+    bool isPayloadFull() const;
+    /**
+     * @brief Decodes a payload created by encodePayload()
+     * The motion minutes are written to the time array (if set), it must hold at least the decoded motion count.
+     * @param data payload bytes
+     * @param length payload length
+     * The histogram bins are written to the bin array (if set), the motion count is the sum of the bins (max. 255).
+     * @return int 0 = success, 1 = payload too short or invalid motion count, 2 = unknown interval id
+     */
+    int decodePayload(const uint8_t *data, int length);
     int getMaxCount(unsigned int intervalTime);
     void setTimerInterval(unsigned int intervalTime);
+    /**
+     * @brief Device time of an encoded payload
+     * @param data payload bytes
+     * @param length payload length
+     * @return uint32_t epoch (minute resolution), 0 if the payload is too short
+     */
+    static uint32_t getPayloadDeviceTime(const uint8_t *data, int length);
+    /**
+     * @brief Sets the device time of an encoded payload (e.g. to the time of the transmission)
+     * @param data payload bytes
+     * @param length payload length
+     * @param epoch device time (minute resolution)
+     */
+    static void setPayloadDeviceTime(uint8_t *data, int length, uint32_t epoch);
+    /**
+     * @brief Sets the delayedStatus bit of an encoded payload (package sent from the backlog after an outage)
+     * The network server dates the events of a delayed package from the device time and does not use it for a time sync.
+     * @param data payload bytes
+     * @param length payload length
+     */
+    static void setPayloadDelayed(uint8_t *data, int length);
 
 private:
     enum TimerInterval
@@ -76,8 +181,26 @@ private:
         max_8h,
         max_17h
     };
-    int maxCount[5] = {57, 49, 43, 38, 34};
     TimerInterval selectedInterval = max_1h;
+    PayloadFormat payloadFormat = fixedBits;
+    size_t payloadSize = basePayloadSize;
+    // interval id field value of the deltaRice format
+    static const unsigned int deltaFormatId = 5;
+    // Rice code: parameter bit count, max. quotient (unary part) and escape value bit count
+    static const unsigned int riceParameterBits = 3;
+    static const unsigned int riceMaxQuotient = 16;
+    static const unsigned int riceEscapeBits = 11;
+    // interval id field value of the histogram format
+    static const unsigned int histogramFormatId = 6;
+    // histogram: bin width index, bin count and count bit count fields
+    static const unsigned int histogramWidthBits = 2;
+    static const unsigned int histogramBinCountBits = 9;
+    static const unsigned int histogramCountBits = 4;
+    unsigned int histogramMinutes[4] = {5, 10, 15, 30};
+    unsigned int histogramWidth = 2;
+    unsigned int histogramBinCount = 0;
+    // longest time span (minutes since the hour of the day) of the timer intervals
+    unsigned int intervalSpan[5] = {120, 180, 300, 540, 1080};
     int minuteBits[5] = {6, 7, 8, 9, 10};
     unsigned int bitCountBat = 5;
     unsigned int bitCountTemp = 5;
@@ -87,7 +210,7 @@ private:
     float maxTemp = 50.0f;
     float minVoltage = 3.0f;
     float maxVoltage = 4.5f;
-    uint32_t startEpoch = 1640995200; // 01.01.2022
+    static const uint32_t startEpoch = 1640995200; // 01.01.2022
 
     uint8_t motionCount;
     uint8_t status;
@@ -99,11 +222,25 @@ private:
     uint8_t hourOfTheDay;
     uint32_t deviceTime;
     unsigned int *timeVector;
+    uint16_t *binVector = nullptr;
 
-    uint8_t payload[51] = {0};
     unsigned int offsetBits = 8 * 8;
 
     uint8_t reduceFloat(float value, float min, float max, unsigned int bitCount);
+    int fixedMaxCount(size_t size) const;
+    unsigned int payloadBits(PayloadFormat format) const;
+    unsigned int encodedMotionCount(PayloadFormat format) const;
+    uint32_t histogramBin(unsigned int width, unsigned int bin) const;
+    unsigned int histogramUsedBins(unsigned int width) const;
+    unsigned int histogramValueBits(unsigned int width) const;
+    unsigned int histogramEncodedBins(unsigned int width) const;
+    unsigned int histogramBits(unsigned int width) const;
+    unsigned int histogramFitWidth() const;
+    uint32_t binTotal() const;
+    void sortTimeVector() const;
+    unsigned int riceBits(unsigned int value, unsigned int k) const;
+    unsigned int deltaBits(unsigned int k, unsigned int count) const;
+    unsigned int bestRiceParameter(unsigned int count) const;
     float expandFloat(uint8_t value, float min, float max, unsigned int bitCount) const;
 };
 
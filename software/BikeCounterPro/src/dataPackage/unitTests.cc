@@ -0,0 +1,523 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "dataPackage.hpp"
+#include "bitStream.hpp"
+
+class DataPackageTest : public ::testing::Test
+{
+protected:
+    // reads a value of bitCount bits (lsb first) from the payload
+    static unsigned int readBits(const uint8_t *payload, unsigned int bitOffset, unsigned int bitCount)
+    {
+        unsigned int value = 0;
+        for (unsigned int i = 0; i < bitCount; ++i)
+        {
+            unsigned int bit = bitOffset + i;
+            value |= ((payload[bit / 8] >> (bit % 8)) & 0x01) << i;
+        }
+        return value;
+    }
+};
+
+TEST_F(DataPackageTest, PayloadLengthTests)
+{
+    unsigned int timeArray[57] = {0};
+    DataPackage dp(60, 0, 0, 0, 0, 0, 0, 0, 0, 0, timeArray);
+
+    // header only
+    ASSERT_EQ(dp.getPayloadLength(), 8);
+
+    // 10 motions with 6 bits (< 1h interval) = 60 bits = 8 bytes
+    dp.setMotionCount(10);
+    ASSERT_EQ(dp.getPayloadLength(), 8 + 8);
+
+    // 10 motions with 7 bits (< 2h interval) = 70 bits = 9 bytes
+    dp.setTimerInterval(120);
+    ASSERT_EQ(dp.getPayloadLength(), 8 + 9);
+
+    // the max. count of every interval fits into 51 bytes
+    unsigned int intervals[5] = {60, 120, 240, 480, 1020};
+    for (int i = 0; i < 5; ++i)
+    {
+        int maxCount = dp.getMaxCount(intervals[i]);
+        dp.setMotionCount(maxCount);
+        ASSERT_LE(dp.getPayloadLength(), 51);
+    }
+}
+
+TEST_F(DataPackageTest, MaxCountTests)
+{
+    DataPackage dp(60);
+    ASSERT_EQ(dp.getMaxCount(30), 57);
+    ASSERT_EQ(dp.getMaxCount(60), 57);
+    ASSERT_EQ(dp.getMaxCount(120), 49);
+    ASSERT_EQ(dp.getMaxCount(240), 43);
+    ASSERT_EQ(dp.getMaxCount(360), 38);
+    ASSERT_EQ(dp.getMaxCount(480), 38);
+    ASSERT_EQ(dp.getMaxCount(1020), 34);
+    ASSERT_EQ(dp.getMaxCount(2000), 34);
+}
+
+TEST_F(DataPackageTest, PayloadSizeTests)
+{
+    DataPackage dp(60);
+    ASSERT_EQ(dp.getPayloadSize(), DataPackage::basePayloadSize);
+    // DR3 (115 bytes)
+    dp.setPayloadSize(115);
+    ASSERT_EQ(dp.getMaxCount(60), 142);
+    ASSERT_EQ(dp.getMaxCount(1020), 85);
+    // DR4 - DR7 (222 bytes), the short intervals are limited by the time array
+    dp.setPayloadSize(222);
+    ASSERT_EQ(dp.getMaxCount(60), DataPackage::maxDeltaCount);
+    ASSERT_EQ(dp.getMaxCount(1020), 171);
+    // limited to the EU868 payload sizes
+    dp.setPayloadSize(10);
+    ASSERT_EQ(dp.getPayloadSize(), DataPackage::basePayloadSize);
+    ASSERT_EQ(dp.getMaxCount(60), 57);
+    dp.setPayloadSize(300);
+    ASSERT_EQ(dp.getPayloadSize(), DataPackage::maxPayloadSize);
+
+    // a larger package is decoded without knowing the budget of the sender
+    unsigned int timeArray[DataPackage::maxDeltaCount];
+    for (int i = 0; i < DataPackage::maxDeltaCount; ++i)
+    {
+        timeArray[i] = i / 4;
+    }
+    DataPackage large(60, DataPackage::maxDeltaCount, 0, 0, 0, 0, 0, 0, 0, 1640995200ul, timeArray);
+    large.setPayloadSize(115);
+    ASSERT_TRUE(large.isPayloadFull());
+    uint8_t payload[DataPackage::maxPayloadSize];
+    ASSERT_EQ(large.encodePayload(payload), 115u);
+    ASSERT_EQ(payload[0], 142);
+
+    unsigned int decodedArray[DataPackage::maxDeltaCount] = {0};
+    DataPackage decoded;
+    decoded.setTimeArray(decodedArray);
+    ASSERT_EQ(decoded.decodePayload(payload, 115), 0);
+    ASSERT_EQ(decoded.getMotionCount(), 142);
+    ASSERT_EQ(decoded.getPayloadSize(), DataPackage::basePayloadSize);
+    ASSERT_EQ(decodedArray[141], timeArray[141]);
+    ASSERT_EQ(decoded.decodePayload(payload, 114), 1);
+}
+
+TEST_F(DataPackageTest, HeaderEncodingTests)
+{
+    DataPackage dp(120);
+    dp.setMotionCount(0);
+    dp.setSwVersion(7);
+    dp.setHwVersion(4);
+    dp.setStatus(5);
+    dp.setBatteryVoltage((uint8_t)21);
+    dp.setTemperature((uint8_t)17);
+    dp.setHumidity((uint8_t)3);
+    dp.setHourOfTheDay(13);
+    dp.setDeviceTime(1640995200ul + 123456ul * 60ul);
+
+    uint8_t payload[DataPackage::maxPayloadSize];
+    ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+    // the buffer must hold the whole payload
+    ASSERT_EQ(dp.encodePayload(ByteSpan(payload, 7)), 0u);
+    ASSERT_EQ(payload[0], 0);
+    ASSERT_EQ(payload[1], (4 << 4) | 7);
+    ASSERT_EQ(payload[2], (21 << 3) | 5);
+    ASSERT_EQ(payload[3], (3 << 5) | 17);
+    ASSERT_EQ(payload[4], (13 << 3) | 1);
+    ASSERT_EQ(readBits(payload, 40, 24), 123456u);
+}
+
+TEST_F(DataPackageTest, DelayedStatusTests)
+{
+    DataPackage dp(120);
+    dp.setMotionCount(0);
+    dp.setStatus(1);
+    dp.setBatteryVoltage((uint8_t)21);
+    dp.setHourOfTheDay(22);
+    dp.setDeviceTime(1717282800ul + 59ul);
+
+    uint8_t payload[DataPackage::maxPayloadSize];
+    int length = (int)dp.encodePayload(payload);
+    ASSERT_EQ(DataPackage::getPayloadDeviceTime(payload, length), 1717282800ul);
+    ASSERT_EQ(DataPackage::getPayloadDeviceTime(payload, 7), 0ul);
+
+    // only the status bit changes
+    DataPackage::setPayloadDelayed(payload, length);
+    ASSERT_EQ(payload[2], (21 << 3) | DataPackage::delayedStatus | 1);
+    DataPackage decoded;
+    ASSERT_EQ(decoded.decodePayload(payload, length), 0);
+    ASSERT_EQ(decoded.getStatus(), DataPackage::delayedStatus | 1);
+    ASSERT_EQ(decoded.getHourOfTheDay(), 22);
+    ASSERT_EQ(decoded.getDeviceTime(), 1717282800ul);
+
+    // the device time is replaced by the time of the transmission (the other fields are kept)
+    DataPackage::setPayloadDeviceTime(payload, length, 1717282800ul + 3661ul);
+    ASSERT_EQ(DataPackage::getPayloadDeviceTime(payload, length), 1717282800ul + 3660ul);
+    ASSERT_EQ(decoded.decodePayload(payload, length), 0);
+    ASSERT_EQ(decoded.getHourOfTheDay(), 22);
+    ASSERT_EQ(decoded.getStatus(), DataPackage::delayedStatus | 1);
+
+    // the time sync call is never delayed
+    dp.setStatus(7);
+    length = (int)dp.encodePayload(payload);
+    DataPackage::setPayloadDelayed(payload, length);
+    ASSERT_EQ(payload[2] & 0x07, 7);
+}
+
+TEST_F(DataPackageTest, TimeArrayEncodingTests)
+{
+    unsigned int timeArray[49];
+    for (int i = 0; i < 49; ++i)
+    {
+        timeArray[i] = (i * 5) % 120;
+    }
+    DataPackage dp(120, 49, 0, 0, 0, 0, 0, 0, 0, 1640995200ul, timeArray);
+
+    uint8_t payload[DataPackage::maxPayloadSize];
+    ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+    for (int i = 0; i < 49; ++i)
+    {
+        ASSERT_EQ(readBits(payload, 64 + i * 7, 7), timeArray[i]);
+    }
+}
+
+TEST_F(DataPackageTest, FloatReductionTests)
+{
+    DataPackage dp(60);
+
+    dp.setBatteryVoltage(3.9f);
+    ASSERT_NEAR(dp.getBatteryVoltage(), 3.9f, 1.5f / 31.0f);
+    dp.setBatteryVoltage(2.0f);
+    ASSERT_FLOAT_EQ(dp.getBatteryVoltage(), 3.0f);
+
+    dp.setTemperature(21.3f);
+    ASSERT_NEAR(dp.getTemperature(), 21.3f, 70.0f / 31.0f);
+    dp.setTemperature(-40.0f);
+    ASSERT_FLOAT_EQ(dp.getTemperature(), -20.0f);
+
+    dp.setHumidity(55.0f);
+    ASSERT_NEAR(dp.getHumidity(), 55.0f, 100.0f / 7.0f);
+}
+
+TEST_F(DataPackageTest, BitStreamTests)
+{
+    uint8_t buffer[8] = {0};
+    BitStreamWriter writer(buffer, sizeof(buffer));
+    writer.write(0x5, 3);
+    writer.write(0x1ff, 9);
+    writer.write(0xabcdef, 24);
+    writer.write(0x3, 1);  // only the lowest bit is written
+    writer.write(0xdeadbeef, 32);
+    ASSERT_EQ(writer.getBitCount(), 69u);
+    // 69 bits do not fit into 8 bytes
+    ASSERT_EQ(writer.flush(), 8u);
+    ASSERT_TRUE(writer.hasOverflow());
+
+    uint8_t large[9] = {0};
+    BitStreamWriter w(large, sizeof(large));
+    w.write(0x5, 3);
+    w.write(0x1ff, 9);
+    w.write(0xabcdef, 24);
+    w.write(0x3, 1);
+    w.write(0xdeadbeef, 32);
+    ASSERT_EQ(w.flush(), 9u);
+    ASSERT_FALSE(w.hasOverflow());
+    ASSERT_EQ(readBits(large, 0, 3), 0x5u);
+    ASSERT_EQ(readBits(large, 3, 9), 0x1ffu);
+    ASSERT_EQ(readBits(large, 12, 24), 0xabcdefu);
+    ASSERT_EQ(readBits(large, 36, 1), 0x1u);
+
+    BitStreamReader reader(large, sizeof(large));
+    ASSERT_EQ(reader.read(3), 0x5u);
+    ASSERT_EQ(reader.read(9), 0x1ffu);
+    ASSERT_EQ(reader.read(24), 0xabcdefu);
+    ASSERT_EQ(reader.read(1), 0x1u);
+    ASSERT_EQ(reader.read(32), 0xdeadbeefu);
+    ASSERT_EQ(reader.getRemainingBits(), 3u);
+    ASSERT_FALSE(reader.hasUnderflow());
+    ASSERT_EQ(reader.read(8), 0u);
+    ASSERT_TRUE(reader.hasUnderflow());
+}
+
+// payloads of the bit by bit encoder (before the bit stream) for every interval with 0, half and max. motion count
+TEST_F(DataPackageTest, GoldenPayloadTests)
+{
+    struct Golden
+    {
+        unsigned int intervalTime;
+        int count;
+        const char *hex;
+    };
+    const Golden golden[] = {
+        {60, 0, "0012000000000000"},
+        {60, 29, "1D17092338EF1E000B5CE91F913A33D68B071BD91B502A2F957B03DAC817"},
+        {60, 57, "391C124670DE3D000B5CE91F913A33D68B071BD91B502A2F957B03DAC8171F1A2B546B3F99B813DE0927135B3B58A80F9DF923"},
+        {120, 0, "0042392B2943420F"},
+        {120, 25, "1947424E6132610F0B5855FF21A61D336C5F7464476C5B4049F9A6E4BC03"},
+        {120, 49, "314C4B719921800F0B5855FF21A61D336C5F7464476C5B4049F9A6E4BC0354537EE1850D2B685DF323275C537C477866C4AC7B"},
+        {240, 0, "007272565286841E"},
+        {240, 22, "16777B798A75A31E0B30557A9FC4E90E33587DA2C7EC11365B80A5CAEF14"},
+        {240, 43, "2B7C849C0264C21E0B30557A9FC4E90E33587DA2C7EC11365B80A5CAEF14395E83A8CDF2173C6186ABD0F51A3F6489AED3F81D"},
+        {480, 0, "00A2AB617BC9C62D"},
+        {480, 20, "14A7B484B3B8E52D0B6054D1F389583A8733B1F6157D9C7D041B5B00955206"},
+        {480, 38, "26ACBDA72BA7042E0B6054D1F389583A8733B1F6157D9C7D041B5B009552F68E624EAF835137977F81471843ABA0D5D3F8932C"},
+        {1020, 0, "00D2E48CA40C093D"},
+        {1020, 18, "12D7EDAF1CFB273D0BC050851E9F10938E433361D59768C7B117A18D5B020A"},
+        {1020, 34, "22DCF6D254EA463D0BC050851E9F10938E433361D59768C7B117A18D5B025AAAB2EF529CB3D783A3DEBCFC17F0108621AB4003"},
+    };
+
+    for (unsigned int g = 0; g < sizeof(golden) / sizeof(golden[0]); ++g)
+    {
+        int k = (int)g / 3;
+        int c = (int)g % 3;
+        unsigned int timeArray[57];
+        for (unsigned int i = 0; i < 57; ++i)
+        {
+            timeArray[i] = (i * 37u + 11u) % (1u << (6 + k));
+        }
+        DataPackage dp(golden[g].intervalTime, golden[g].count, (k + c) % 8, (k * 3 + 1) % 16, (c * 5 + 2) % 16, (k * 7 + c) % 32,
+                       (k * 11 + c * 3) % 32, (k + c) % 8, (k * 5 + c * 7) % 24, 1640995200ul + (uint32_t)(k * 1000003 + c * 7919) * 60ul, timeArray);
+
+        uint8_t payload[DataPackage::maxPayloadSize];
+        ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+        std::string hex;
+        char buffer[3];
+        for (int i = 0; i < dp.getPayloadLength(); ++i)
+        {
+            snprintf(buffer, sizeof(buffer), "%02X", payload[i]);
+            hex += buffer;
+        }
+        ASSERT_EQ(hex, golden[g].hex) << "interval " << golden[g].intervalTime << " count " << golden[g].count;
+
+        // the decoder restores every field
+        unsigned int decodedTimes[57] = {0};
+        DataPackage decoded;
+        decoded.setTimeArray(decodedTimes);
+        ASSERT_EQ(decoded.decodePayload(payload, dp.getPayloadLength()), 0);
+        ASSERT_EQ(decoded.getMotionCount(), dp.getMotionCount());
+        ASSERT_EQ(decoded.getStatus(), dp.getStatus());
+        ASSERT_EQ(decoded.getSwVersion(), dp.getSwVersion());
+        ASSERT_EQ(decoded.getHwVersion(), dp.getHwVersion());
+        ASSERT_EQ(decoded.getBatteryVoltage(), dp.getBatteryVoltage());
+        ASSERT_EQ(decoded.getTemperature(), dp.getTemperature());
+        ASSERT_EQ(decoded.getHumidity(), dp.getHumidity());
+        ASSERT_EQ(decoded.getHourOfTheDay(), dp.getHourOfTheDay());
+        ASSERT_EQ(decoded.getDeviceTime(), dp.getDeviceTime());
+        ASSERT_EQ(decoded.getPayloadLength(), dp.getPayloadLength());
+        for (int i = 0; i < golden[g].count; ++i)
+        {
+            ASSERT_EQ(decodedTimes[i], timeArray[i]);
+        }
+    }
+}
+
+TEST_F(DataPackageTest, DecodeErrorTests)
+{
+    unsigned int timeArray[57] = {0};
+    DataPackage dp(120, 10, 0, 0, 0, 0, 0, 0, 0, 1640995200ul, timeArray);
+    uint8_t payload[DataPackage::maxPayloadSize];
+    ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+
+    DataPackage decoded;
+    decoded.setTimeArray(timeArray);
+    // header incomplete
+    ASSERT_EQ(decoded.decodePayload(payload, 7), 1);
+    // time array incomplete
+    ASSERT_EQ(decoded.decodePayload(payload, dp.getPayloadLength() - 1), 1);
+    // unknown interval id
+    uint8_t invalid[8] = {0, 0, 0, 0, 0x07, 0, 0, 0};
+    ASSERT_EQ(decoded.decodePayload(invalid, 8), 2);
+}
+
+TEST_F(DataPackageTest, DeltaEncodingTests)
+{
+    // two bursts of riders
+    unsigned int timeArray[DataPackage::maxDeltaCount];
+    unsigned int expected[DataPackage::maxDeltaCount];
+    for (int i = 0; i < 60; ++i)
+    {
+        timeArray[i] = (i < 30) ? 12 + i / 3 : 95 + i / 2;
+        expected[i] = timeArray[i];
+    }
+    DataPackage dp(120, 60, 0, 4, 7, 20, 17, 3, 10, 1717200000ul, timeArray);
+    int fixedLength = dp.getPayloadLength();
+    ASSERT_TRUE(dp.isPayloadFull());
+
+    dp.setPayloadFormat(DataPackage::PayloadFormat::deltaRice);
+    ASSERT_FALSE(dp.isPayloadFull());
+    ASSERT_LT(dp.getPayloadLength(), fixedLength);
+
+    uint8_t payload[DataPackage::maxPayloadSize];
+    ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+    ASSERT_EQ(payload[0], 60);
+    ASSERT_EQ(payload[4] & 0x07, 5); // format id
+    ASSERT_EQ(payload[4] >> 3, 10);
+
+    unsigned int decodedTimes[DataPackage::maxDeltaCount] = {0};
+    DataPackage decoded;
+    decoded.setTimeArray(decodedTimes);
+    ASSERT_EQ(decoded.decodePayload(payload, dp.getPayloadLength()), 0);
+    ASSERT_EQ(decoded.getPayloadFormat(), DataPackage::PayloadFormat::deltaRice);
+    ASSERT_EQ(decoded.getMotionCount(), 60);
+    ASSERT_EQ(decoded.getDeviceTime(), dp.getDeviceTime());
+    ASSERT_EQ(decoded.getPayloadLength(), dp.getPayloadLength());
+    for (int i = 0; i < 60; ++i)
+    {
+        ASSERT_EQ(decodedTimes[i], expected[i]);
+    }
+}
+
+TEST_F(DataPackageTest, DeltaSortAndEscapeTests)
+{
+    // unsorted minutes with a gap which needs an escape code
+    unsigned int timeArray[5] = {900, 3, 1, 2, 1439};
+    DataPackage dp(1020, 5, 0, 0, 0, 0, 0, 0, 0, 1717200000ul, timeArray);
+    dp.setPayloadFormat(DataPackage::PayloadFormat::deltaRice);
+    uint8_t payload[DataPackage::maxPayloadSize];
+    ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+
+    unsigned int decodedTimes[5] = {0};
+    DataPackage decoded;
+    decoded.setTimeArray(decodedTimes);
+    ASSERT_EQ(decoded.decodePayload(payload, dp.getPayloadLength()), 0);
+    unsigned int expected[5] = {1, 2, 3, 900, 1439};
+    for (int i = 0; i < 5; ++i)
+    {
+        ASSERT_EQ(decodedTimes[i], expected[i]);
+    }
+    // truncated payload
+    ASSERT_EQ(decoded.decodePayload(payload, dp.getPayloadLength() - 2), 1);
+}
+
+TEST_F(DataPackageTest, DeltaCapacityTests)
+{
+    // one rider every minute of the day
+    unsigned int timeArray[DataPackage::maxDeltaCount];
+    for (int i = 0; i < DataPackage::maxDeltaCount; ++i)
+    {
+        timeArray[i] = i;
+    }
+    DataPackage dp(1020, 0, 0, 0, 0, 0, 0, 0, 0, 1717200000ul, timeArray);
+    dp.setPayloadFormat(DataPackage::PayloadFormat::deltaRice);
+
+    int count = 0;
+    while (!dp.isPayloadFull())
+    {
+        dp.setMotionCount(++count);
+        ASSERT_LE(dp.getPayloadLength(), 51);
+    }
+    // gaps of one minute cost 2 bits (k = 0), a fixed bit package holds 34 motions for this interval
+    ASSERT_GE(count, 2 * dp.getMaxCount(1020));
+
+    // the count is limited by the payload size
+    dp.setMotionCount(DataPackage::maxDeltaCount);
+    ASSERT_LE(dp.getPayloadLength(), 51);
+    for (int i = 0; i < DataPackage::maxDeltaCount; ++i)
+    {
+        timeArray[i] = i * 7;
+    }
+    ASSERT_TRUE(dp.isPayloadFull());
+    ASSERT_EQ(dp.getPayloadLength(), 51);
+    uint8_t payload[DataPackage::maxPayloadSize];
+    ASSERT_EQ(dp.encodePayload(payload), 51u);
+    ASSERT_LT(payload[0], DataPackage::maxDeltaCount);
+}
+
+TEST_F(DataPackageTest, HistogramEncodingTests)
+{
+    // race day: 600 riders in 2h, 5 per minute
+    uint16_t bins[DataPackage::maxBinCount] = {0};
+    for (int minute = 0; minute < 120; ++minute)
+    {
+        bins[minute / DataPackage::binMinutes] += 5;
+    }
+    DataPackage dp(120, 0, 0, 4, 7, 20, 17, 3, 9, 1717200000ul);
+    dp.setBinArray(bins);
+    dp.setPayloadFormat(DataPackage::PayloadFormat::histogram);
+    dp.setHistogramBinMinutes(15);
+    ASSERT_FALSE(dp.isPayloadFull());
+
+    // 8 bins of 15 minutes with 75 motions (7 bits)
+    ASSERT_EQ(dp.getPayloadLength(), (int)(8 + (2 + 9 + 4 + 8 * 7 + 7) / 8));
+    uint8_t payload[DataPackage::maxPayloadSize];
+    ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+    ASSERT_EQ(payload[0], 255);
+    ASSERT_EQ(payload[4] & 0x07, 6); // format id
+    ASSERT_EQ(readBits(payload, 64, 2), 2u);
+    ASSERT_EQ(readBits(payload, 66, 9), 8u);
+    ASSERT_EQ(readBits(payload, 75, 4), 7u);
+
+    uint16_t decodedBins[DataPackage::maxBinCount] = {0};
+    DataPackage decoded;
+    decoded.setBinArray(decodedBins);
+    ASSERT_EQ(decoded.decodePayload(payload, dp.getPayloadLength()), 0);
+    ASSERT_EQ(decoded.getPayloadFormat(), DataPackage::PayloadFormat::histogram);
+    ASSERT_EQ(decoded.getHistogramBinMinutes(), 15u);
+    ASSERT_EQ(decoded.getHistogramBinCount(), 8u);
+    ASSERT_EQ(decoded.getHourOfTheDay(), 9);
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_EQ(decodedBins[i], 75);
+    }
+
+    // 5 minute bins need too much space for the 17h interval, the encoder falls back to wider bins
+    for (unsigned int i = 0; i < 17 * 60 / DataPackage::binMinutes; ++i)
+    {
+        bins[i] = 50;
+    }
+    dp.setHistogramBinMinutes(5);
+    ASSERT_LE(dp.getPayloadLength(), 51);
+    ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+    ASSERT_EQ(decoded.decodePayload(payload, dp.getPayloadLength()), 0);
+    ASSERT_EQ(decoded.getHistogramBinMinutes(), 30u);
+    ASSERT_EQ(decoded.getHistogramBinCount(), 34u);
+    ASSERT_EQ(decodedBins[33], 300);
+
+    // the bins at the end of the day are dropped if even the widest bins do not fit
+    for (unsigned int i = 0; i < DataPackage::maxBinCount; ++i)
+    {
+        bins[i] = 100;
+    }
+    ASSERT_TRUE(dp.isPayloadFull());
+    ASSERT_LE(dp.getPayloadLength(), 51);
+    ASSERT_EQ(dp.encodePayload(payload), (size_t)dp.getPayloadLength());
+    ASSERT_EQ(decoded.decodePayload(payload, dp.getPayloadLength()), 0);
+    ASSERT_LT(decoded.getHistogramBinCount(), 48u);
+}
+
+TEST_F(DataPackageTest, SmallestFormatTests)
+{
+    unsigned int timeArray[DataPackage::maxDeltaCount];
+    uint16_t bins[DataPackage::maxBinCount] = {0};
+    DataPackage dp(120, 0, 0, 4, 7, 20, 17, 3, 9, 1717200000ul, timeArray);
+    dp.setBinArray(bins);
+    dp.setPayloadFormat(DataPackage::PayloadFormat::smallest);
+
+    // a few riders: one timestamp per rider
+    timeArray[0] = 30;
+    timeArray[1] = 100;
+    ++bins[30 / DataPackage::binMinutes];
+    ++bins[100 / DataPackage::binMinutes];
+    dp.setMotionCount(2);
+    ASSERT_NE(dp.getEncodedFormat(), DataPackage::PayloadFormat::histogram);
+    ASSERT_EQ(dp.getPayloadLength(), 8 + 2);
+
+    // busy trail: the histogram is smaller
+    int count = 2;
+    for (; count < DataPackage::maxDeltaCount; ++count)
+    {
+        timeArray[count] = count * 119 / DataPackage::maxDeltaCount;
+        ++bins[timeArray[count] / DataPackage::binMinutes];
+    }
+    dp.setMotionCount(count);
+    ASSERT_EQ(dp.getEncodedFormat(), DataPackage::PayloadFormat::histogram);
+    ASSERT_FALSE(dp.isPayloadFull());
+
+    // more motions than the time array holds are only counted in the bins
+    bins[3] += 1000;
+    ASSERT_EQ(dp.getEncodedFormat(), DataPackage::PayloadFormat::histogram);
+    ASSERT_LE(dp.getPayloadLength(), 51);
+    ASSERT_FALSE(dp.isPayloadFull());
+
+    // a full bin array is sent
+    bins[3] = 0xffff;
+    ASSERT_TRUE(dp.isPayloadFull());
+}
@@ -0,0 +1,20 @@
+#include <benchmark/benchmark.h>
+#include "driftCompensator.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+// corrected RTC reading (every motion and timer call)
+static void BM_Correct(benchmark::State &state)
+{
+    DriftCompensator compensator;
+    uint32_t epoch = 1717200000ul;
+    compensator.applyCorrection(epoch, 0);
+    compensator.setRate(-429497);
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(compensator.correct(epoch));
+        epoch += 61;
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_Correct);
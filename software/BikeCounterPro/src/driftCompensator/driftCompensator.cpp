@@ -0,0 +1,47 @@
+#include "driftCompensator.hpp"
+
+uint32_t DriftCompensator::correct(uint32_t rtcEpoch) const
+{
+    if (!anchorValid || rtcEpoch < anchorEpoch)
+    {
+        return rtcEpoch;
+    }
+    // seconds the RTC ran ahead since the last correction (rounded towards zero)
+    int64_t product = (int64_t)(rtcEpoch - anchorEpoch) * rate;
+    int32_t offset = product >= 0 ? (int32_t)(product >> 32) : -(int32_t)((-product) >> 32);
+    return rtcEpoch - (uint32_t)offset;
+}
+
+uint32_t DriftCompensator::applyCorrection(uint32_t rtcEpoch, int32_t timeDrift)
+{
+    uint32_t corrected = correct(rtcEpoch) + (uint32_t)timeDrift;
+    estimate(rtcEpoch, timeDrift);
+    anchorValid = true;
+    anchorEpoch = corrected;
+    return corrected;
+}
+
+bool DriftCompensator::observeDrift(uint32_t rtcEpoch, int32_t timeDrift)
+{
+    // the anchor is kept: the new rate applies to the whole time since the last correction and with it
+    // compensates the observed deviation
+    return estimate(rtcEpoch, timeDrift);
+}
+
+bool DriftCompensator::estimate(uint32_t rtcEpoch, int32_t timeDrift)
+{
+    if (!anchorValid || rtcEpoch < anchorEpoch + minObservationSeconds)
+    {
+        return false;
+    }
+    // the remaining error (positive drift = the RTC is slow) refines the rate
+    int64_t residual = -((int64_t)timeDrift * 4294967296ll) / (int64_t)(rtcEpoch - anchorEpoch);
+    int64_t value = (int64_t)rate + residual;
+    const int64_t maxRate = (int64_t)maxDriftPpm * 4294967296ll / 1000000ll;
+    if (value > maxRate || value < -maxRate)
+    {
+        return false;
+    }
+    rate = (int32_t)value;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef DRIFTCOMPENSATOR_H
+#define DRIFTCOMPENSATOR_H
+
+#include <stdint.h>
+
+/**
+ * @brief Software correction of the RTC drift
+ * The drift rate is estimated from the time deviations reported by the network server (the error which accumulated
+ * since the last correction divided by the elapsed time) and applied to every RTC reading. The rate is stored as
+ * Q32 fixed point seconds per second, so a correction costs a multiplication and a shift (no division on the M0).
+ */
+class DriftCompensator
+{
+public:
+    // shortest time between two corrections to estimate the drift
+    static const uint32_t minObservationSeconds = 6ul * 60ul * 60ul;
+    // larger estimates are discarded (e.g. a manual change of the time)
+    static const int32_t maxDriftPpm = 20000;
+
+    /**
+     * @brief Corrected time of an RTC reading
+     * @param rtcEpoch RTC epoch
+     * @return uint32_t epoch (the RTC epoch until the first correction)
+     */
+    uint32_t correct(uint32_t rtcEpoch) const;
+    /**
+     * @brief Learns the drift from a time correction of the network server
+     * @param rtcEpoch current RTC epoch
+     * @param timeDrift network time - corrected device time in seconds
+     * @return uint32_t new RTC epoch (the correction restarts from it)
+     */
+    uint32_t applyCorrection(uint32_t rtcEpoch, int32_t timeDrift);
+    /**
+     * @brief Learns the drift from a time deviation which is too small to correct the RTC
+     * The deviation accumulated since the last correction, the corrected time follows the new rate.
+     * @param rtcEpoch current RTC epoch
+     * @param timeDrift network time - corrected device time in seconds
+     * @return true if the rate was updated (at least minObservationSeconds since the last correction)
+     */
+    bool observeDrift(uint32_t rtcEpoch, int32_t timeDrift);
+    /// @brief The RTC was set to a time unrelated to the last correction (the drift estimate is kept)
+    void clearAnchor() { anchorValid = false; }
+
+    /// @brief drift rate (Q32 seconds per second, positive = RTC runs fast)
+    int32_t getRate() const { return rate; }
+    void setRate(int32_t r) { rate = r; }
+    /// @brief drift in parts per million (positive = RTC runs fast)
+    float getDriftPpm() const { return (float)rate * (1e6f / 4294967296.0f); }
+
+private:
+    int32_t rate = 0;
+    bool anchorValid = false;
+    // RTC epoch of the last correction
+    uint32_t anchorEpoch = 0;
+
+    bool estimate(uint32_t rtcEpoch, int32_t timeDrift);
+};
+
+#endif // DRIFTCOMPENSATOR_H
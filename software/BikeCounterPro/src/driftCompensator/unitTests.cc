@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include "driftCompensator.hpp"
+
+namespace
+{
+    // 01.06.2024 00:00:00
+    const uint32_t worldStart = 1717200000ul;
+
+    // RTC which runs ppm too fast since the world time start
+    uint32_t rtcAt(uint32_t worldEpoch, uint32_t rtcStart, double ppm)
+    {
+        return rtcStart + (uint32_t)((double)(worldEpoch - worldStart) * (1.0 + ppm * 1e-6));
+    }
+}
+
+TEST(DriftCompensatorTests, CorrectTests)
+{
+    DriftCompensator compensator;
+    // no correction without an anchor
+    compensator.setRate(429497); // 100 ppm
+    ASSERT_EQ(compensator.correct(worldStart), worldStart);
+
+    ASSERT_EQ(compensator.applyCorrection(worldStart, 0), worldStart);
+    ASSERT_EQ(compensator.correct(worldStart + 10000ul), worldStart + 9999ul);
+    ASSERT_EQ(compensator.correct(worldStart + 1000000ul), worldStart + 1000000ul - 100ul);
+    // readings before the anchor (RTC set back) are not corrected
+    ASSERT_EQ(compensator.correct(worldStart - 10ul), worldStart - 10ul);
+
+    // slow RTC
+    compensator.setRate(-429497);
+    ASSERT_EQ(compensator.correct(worldStart + 1000000ul), worldStart + 1000000ul + 100ul);
+    ASSERT_NEAR(compensator.getDriftPpm(), -100.0f, 0.01f);
+
+    compensator.clearAnchor();
+    ASSERT_EQ(compensator.correct(worldStart + 1000000ul), worldStart + 1000000ul);
+}
+
+TEST(DriftCompensatorTests, EstimateTests)
+{
+    const double ppm = 150.0;
+    DriftCompensator compensator;
+
+    // first sync from the default time of the RTC: no estimate
+    uint32_t rtcStart = 1640995200ul;
+    uint32_t rtc = rtcAt(worldStart, rtcStart, ppm);
+    rtcStart = compensator.applyCorrection(rtc, (int32_t)(worldStart - rtc));
+    ASSERT_EQ(rtcStart, worldStart);
+    ASSERT_EQ(compensator.getRate(), 0);
+
+    // a correction too early is applied without an estimate
+    uint32_t world = worldStart + 3600ul;
+    rtc = rtcAt(world, rtcStart, ppm);
+    ASSERT_EQ(compensator.applyCorrection(rtc, (int32_t)(world - rtc)), world);
+    ASSERT_EQ(compensator.getRate(), 0);
+
+    // the network server corrects the time after 10 days (device time in minutes: 1 minute / 10 days = 70 ppm)
+    world = worldStart + 3600ul + 10ul * 86400ul;
+    rtc = worldStart + 3600ul + (uint32_t)((double)(world - worldStart - 3600ul) * (1.0 + ppm * 1e-6));
+    int32_t drift = (int32_t)(world - (compensator.correct(rtc) / 60ul) * 60ul);
+    compensator.applyCorrection(rtc, drift);
+    ASSERT_NEAR(compensator.getDriftPpm(), ppm, 70.0f);
+
+    // 10 days later the corrected time deviates less than the resolution of the device time
+    uint32_t anchor = world;
+    world += 10ul * 86400ul;
+    rtc = anchor + (uint32_t)((double)(world - anchor) * (1.0 + ppm * 1e-6));
+    ASSERT_NEAR((double)compensator.correct(rtc), (double)world, 90.0);
+
+    // implausible corrections do not change the estimate
+    int32_t rate = compensator.getRate();
+    compensator.applyCorrection(rtc, -6 * 3600);
+    ASSERT_EQ(compensator.getRate(), rate);
+}
+
+TEST(DriftCompensatorTests, ObserveTests)
+{
+    // a 50 ppm crystal drifts 4.3s per day, the network server reports deviations above 2 min
+    const double ppm = 50.0;
+    DriftCompensator compensator;
+    uint32_t rtcStart = compensator.applyCorrection(1640995200ul, (int32_t)(worldStart - 1640995200ul));
+    ASSERT_EQ(rtcStart, worldStart);
+
+    // no estimate before minObservationSeconds
+    ASSERT_FALSE(compensator.observeDrift(worldStart + 3600ul, -1));
+    ASSERT_EQ(compensator.getRate(), 0);
+
+    // the deviation after 30 days (device time in minutes) gives the rate without a correction of the RTC
+    uint32_t world = worldStart + 30ul * 86400ul;
+    uint32_t rtc = rtcAt(world, rtcStart, ppm);
+    int32_t drift = (int32_t)(world - (compensator.correct(rtc) / 60ul) * 60ul);
+    ASSERT_TRUE(compensator.observeDrift(rtc, drift));
+    ASSERT_NEAR(compensator.getDriftPpm(), ppm, 25.0f);
+    // the corrected time follows the new rate
+    ASSERT_NEAR((double)compensator.correct(rtc), (double)world, 60.0);
+
+    // the next deviation 30 days later refines the rate over the whole time span
+    world += 30ul * 86400ul;
+    rtc = rtcAt(world, rtcStart, ppm);
+    drift = (int32_t)(world - (compensator.correct(rtc) / 60ul) * 60ul);
+    ASSERT_TRUE(compensator.observeDrift(rtc, drift));
+    ASSERT_NEAR(compensator.getDriftPpm(), ppm, 12.0f);
+    ASSERT_NEAR((double)compensator.correct(rtc), (double)world, 60.0);
+
+    // implausible deviations do not change the estimate
+    int32_t rate = compensator.getRate();
+    ASSERT_FALSE(compensator.observeDrift(rtc, -6 * 3600 * 24));
+    ASSERT_EQ(compensator.getRate(), rate);
+}
@@ -0,0 +1,21 @@
+#include <benchmark/benchmark.h>
+#include <stdint.h>
+#include "ringBuffer.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+// push of a motion timestamp (interrupt) and pop (main loop)
+static void BM_PushPop(benchmark::State &state)
+{
+    RingBuffer<uint32_t, 32> rb;
+    uint32_t epoch = 1717200000ul;
+    uint32_t value = 0;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        rb.push(epoch++);
+        rb.pop(value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_PushPop);
@@ -0,0 +1,75 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * @brief Lock-free single producer / single consumer ring buffer
+ * The producer (e.g. an interrupt service routine) only writes the head index, the consumer (main loop)
+ * only writes the tail index, so no locks or disabled interrupts are needed. The indices are loaded and
+ * stored atomically (plain word access on the Cortex-M0+) with acquire/release ordering.
+ * @tparam T element type
+ * @tparam N capacity (power of two)
+ */
+template <typename T, unsigned int N>
+class RingBuffer
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+public:
+    /**
+     * @brief Appends an element (producer side)
+     * @param item
+     * @return true if the element was stored, false if the buffer is full (the element is dropped)
+     */
+    bool push(const T &item)
+    {
+        unsigned int h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N)
+        {
+            ++dropped;
+            return false;
+        }
+        buffer[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element (consumer side)
+     * @param item receives the element
+     * @return true if an element was removed, false if the buffer is empty
+     */
+    bool pop(T &item)
+    {
+        unsigned int t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = buffer[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+    unsigned int size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    unsigned int capacity() const { return N; }
+    /// @brief number of elements dropped because the buffer was full (written by the producer)
+    unsigned int getDroppedCount() const { return dropped; }
+
+    /**
+     * @brief Removes all elements (consumer side)
+     */
+    void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+    T buffer[N];
+    // free running indices (the difference is the fill level)
+    std::atomic<unsigned int> head{0};
+    std::atomic<unsigned int> tail{0};
+    volatile unsigned int dropped = 0;
+};
+
+#endif // RINGBUFFER_H
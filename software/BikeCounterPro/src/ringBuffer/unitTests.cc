@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include "ringBuffer.hpp"
+
+TEST(RingBufferTest, PushPopTests)
+{
+    RingBuffer<uint32_t, 4> rb;
+    uint32_t value = 0;
+    ASSERT_TRUE(rb.empty());
+    ASSERT_FALSE(rb.pop(value));
+
+    ASSERT_TRUE(rb.push(1));
+    ASSERT_TRUE(rb.push(2));
+    ASSERT_EQ(rb.size(), 2u);
+    ASSERT_TRUE(rb.pop(value));
+    ASSERT_EQ(value, 1u);
+    ASSERT_TRUE(rb.pop(value));
+    ASSERT_EQ(value, 2u);
+    ASSERT_TRUE(rb.empty());
+}
+
+TEST(RingBufferTest, OverflowTests)
+{
+    RingBuffer<uint32_t, 4> rb;
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        rb.push(i);
+    }
+    // the newest elements are dropped
+    ASSERT_EQ(rb.size(), 4u);
+    ASSERT_EQ(rb.getDroppedCount(), 2u);
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(rb.pop(value));
+        ASSERT_EQ(value, i);
+    }
+
+    rb.push(7);
+    rb.clear();
+    ASSERT_TRUE(rb.empty());
+}
+
+TEST(RingBufferTest, WrapAroundTests)
+{
+    RingBuffer<uint32_t, 8> rb;
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        rb.push(i);
+    }
+    // the indices wrap around the buffer several times
+    for (uint32_t i = 3; i < 100; ++i)
+    {
+        ASSERT_TRUE(rb.push(i));
+        ASSERT_TRUE(rb.pop(value));
+        ASSERT_EQ(value, i - 3);
+        ASSERT_EQ(rb.size(), 3u);
+    }
+}
+
+TEST(RingBufferTest, ConcurrentTests)
+{
+    // producer thread in place of the interrupt
+    RingBuffer<uint32_t, 16> rb;
+    const uint32_t count = 20000;
+    std::atomic<bool> stop(false);
+    std::thread producer([&rb, &stop]()
+                         {
+                             for (uint32_t i = 0; i < count && !stop;)
+                             {
+                                 if (rb.push(i))
+                                 {
+                                     ++i;
+                                 }
+                                 else
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             }
+                         });
+    uint32_t expected = 0;
+    uint32_t value = 0;
+    while (expected < count)
+    {
+        if (!rb.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        EXPECT_EQ(value, expected);
+        if (value != expected)
+        {
+            break;
+        }
+        ++expected;
+    }
+    // the producer must be joined before the test returns (a failed ASSERT would terminate with a joinable thread)
+    stop = true;
+    producer.join();
+    ASSERT_EQ(expected, count);
+    ASSERT_TRUE(rb.empty());
+}
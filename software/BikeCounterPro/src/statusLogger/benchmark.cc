@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include "extendedStatusLogger.hpp"
+#include "../HAL/sim_hal.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+// push of a string literal (copied into a slot), the queue is flushed every 16 messages
+static void BM_ExtendedPushString(benchmark::State &state)
+{
+    SimHAL hal;
+    StatusLogger::getInstance()->setup(static_cast<StatusLogger::Output>(state.range(0)), &hal);
+    ExtendedStatusLogger logger("Benchmark:");
+    int n = 0;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        logger.push("Motion detected");
+        if (++n % 16 == 0)
+        {
+            logger.loop();
+        }
+    }
+    logger.loop();
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ExtendedPushString)->Arg(StatusLogger::Output::noOutput)->Arg(StatusLogger::Output::toSerial)->ArgName("output");
+
+// push of a number (snprintf into a stack buffer), the queue is flushed every 16 messages
+static void BM_ExtendedPushNumber(benchmark::State &state)
+{
+    SimHAL hal;
+    StatusLogger::getInstance()->setup(static_cast<StatusLogger::Output>(state.range(0)), &hal);
+    ExtendedStatusLogger logger("Benchmark:");
+    unsigned long value = 1717200000ul;
+    int n = 0;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        logger.push(value++);
+        if (++n % 16 == 0)
+        {
+            logger.loop();
+        }
+    }
+    logger.loop();
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ExtendedPushNumber)->Arg(StatusLogger::Output::noOutput)->Arg(StatusLogger::Output::toSerial)->ArgName("output");
+
+// printf style log message with four arguments, formatted only if the output is enabled
+static void BM_ExtendedLogFormat(benchmark::State &state)
+{
+    SimHAL hal;
+    StatusLogger::getInstance()->setup(static_cast<StatusLogger::Output>(state.range(0)), &hal);
+    ExtendedStatusLogger logger("Benchmark:");
+    int n = 0;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        LOG_DEBUG(logger, "Motion detected (current count = %d / time: %d:%d:%d)", n, 7, 12, 59);
+        if (++n % 16 == 0)
+        {
+            logger.loop();
+        }
+    }
+    logger.loop();
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ExtendedLogFormat)->Arg(StatusLogger::Output::noOutput)->Arg(StatusLogger::Output::toSerial)->ArgName("output");
+
+// encoding of a tokenized record (token + four arguments) compared to BM_ExtendedLogFormat
+static void BM_TraceRecordEncode(benchmark::State &state)
+{
+    int n = 0;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        TraceRecordWriter record((uint8_t)StatusLogger::Level::debug, LOG_TOKEN("Motion detected (current count = %d / time: %d:%d:%d)"));
+        record.add(n++, 7, 12, 59);
+        benchmark::DoNotOptimize(record.getData());
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_TraceRecordEncode);
@@ -1,40 +1,92 @@
 #ifndef EXTENDEDSTATUSLOGGER_H
 #define EXTENDEDSTATUSLOGGER_H
 
+#include <stdio.h>
+#include <type_traits>
 #include "statusLogger.hpp"
+#include "traceRecord.hpp"
+
+// the token is a template argument to force the evaluation by the compiler
+#define LOG_TOKEN(format) (std::integral_constant<uint32_t, StatusLogger::tokenize(format)>::value)
+#ifdef BIKECOUNTER_LOG_TOKENIZED
+#define LOG_FORMAT(format) nullptr
+#else
+#define LOG_FORMAT(format) format
+#endif
+
+// printf style logging with a string literal as format: LOG_INFO(logger, "count = %d", counter);
+// The host tool simulation/detokenize finds the format strings of these macros in the sources.
+#define LOG_DEBUG(logger, format, ...) (logger).log(StatusLogger::Level::debug, LOG_TOKEN(format), LOG_FORMAT(format), ##__VA_ARGS__)
+#define LOG_INFO(logger, format, ...) (logger).log(StatusLogger::Level::info, LOG_TOKEN(format), LOG_FORMAT(format), ##__VA_ARGS__)
+#define LOG_WARNING(logger, format, ...) (logger).log(StatusLogger::Level::warning, LOG_TOKEN(format), LOG_FORMAT(format), ##__VA_ARGS__)
+#define LOG_ERROR(logger, format, ...) (logger).log(StatusLogger::Level::error, LOG_TOKEN(format), LOG_FORMAT(format), ##__VA_ARGS__)
 
 class ExtendedStatusLogger
 {
 public:
-    ExtendedStatusLogger(std::string prefix)
-    {
-        unitPrefix = prefix;
-        unitPrefix.append(16 - unitPrefix.length(), ' ');
-    }
+    /// @param prefix module prefix (string literal, the pointer is stored by the StatusLogger)
+    ExtendedStatusLogger(const char *prefix) : moduleId(StatusLogger::getInstance()->registerModule(prefix)) {}
     void loop() { logger->loop(); }
 
-    void push(const std::string msg)
+    void push(const std::string &msg)
     {
-        logger->push(unitPrefix + msg);
+        logger->push(moduleId, msg.c_str());
     }
 
     void push(const char *msg)
     {
-        std::string str{msg};
-        logger->push(unitPrefix + str);
+        logger->push(moduleId, msg);
     }
 
     template <typename T,
               typename = typename std::enable_if<std::is_arithmetic<T>::value, T>::type>
     void push(T msg)
     {
-        std::string str = std::to_string(msg);
-        logger->push(unitPrefix + str);
+        if (!logger->isEnabled(StatusLogger::Level::info))
+        {
+            return;
+        }
+        char str[32];
+        format(str, sizeof(str), msg);
+        logger->push(moduleId, str);
+    }
+
+    /// @brief printf style logging, use the LOG_ macros which add the token of the format string.
+    /// The level and the output are checked before the message is formatted or encoded,
+    /// calls below StatusLogger::compiledLevel are removed by the compiler.
+    /// @param level log level
+    /// @param token StatusLogger::tokenize(format)
+    /// @param format printf format string (nullptr in tokenized builds)
+    template <typename... Args>
+    void log(StatusLogger::Level level, uint32_t token, const char *format, Args... args)
+    {
+        if (level >= StatusLogger::compiledLevel && logger->isEnabled(level))
+        {
+            if (logger->isTokenized() || format == nullptr)
+            {
+                // only the token and the raw arguments are stored
+                TraceRecordWriter record((uint8_t)level, token);
+                record.add(args...);
+                logger->pushRecord(moduleId, record.getData(), record.getLength());
+            }
+            else
+            {
+                logger->pushFormat(moduleId, format, args...);
+            }
+        }
     }
 
 private:
-    std::string unitPrefix;
+    uint8_t moduleId;
     StatusLogger *logger = StatusLogger::getInstance();
+
+    // same output as std::to_string
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type format(char *str, size_t size, T value) { snprintf(str, size, "%f", (double)value); }
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type format(char *str, size_t size, T value) { snprintf(str, size, "%ld", (long)value); }
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type format(char *str, size_t size, T value) { snprintf(str, size, "%lu", (unsigned long)value); }
 };
 
 #endif // EXTENDEDSTATUSLOGGER_H
\ No newline at end of file
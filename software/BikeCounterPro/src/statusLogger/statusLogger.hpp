@@ -1,9 +1,16 @@
 #ifndef STATUSLOGGER_H
 #define STATUSLOGGER_H
 
-#include <queue>
+#include <stdint.h>
 #include <string>
-#include "../hal/hal_interface.hpp"
+#include "../HAL/hal_interface.hpp"
+
+// lowest log level compiled into the firmware (0=debug, 1=info, 2=warning, 3=error)
+// messages below this level are removed by the compiler including their format strings and arguments
+#ifndef BIKECOUNTER_LOG_LEVEL
+#define BIKECOUNTER_LOG_LEVEL 0
+#endif
+// BIKECOUNTER_LOG_TOKENIZED removes the format strings from the firmware, the serial output is binary (see traceRecord.hpp)
 
 class StatusLogger
 {
@@ -21,9 +28,77 @@ public:
         toMemory
     };
 
+    enum class Level : uint8_t
+    {
+        debug,
+        info,
+        warning,
+        error
+    };
+
+    // lowest level compiled into the firmware
+    static constexpr Level compiledLevel = static_cast<Level>(BIKECOUNTER_LOG_LEVEL);
+#ifdef BIKECOUNTER_LOG_TOKENIZED
+    static constexpr bool tokenizedBuild = true;
+#else
+    static constexpr bool tokenizedBuild = false;
+#endif
+
+    /// @brief Id of a format string (32 bit FNV-1a hash), evaluated by the compiler for the LOG_ macros
+    static constexpr uint32_t tokenize(const char *format, uint32_t hash = 2166136261u)
+    {
+        return *format == '\0' ? hash : tokenize(format + 1, (hash ^ (uint8_t)*format) * 16777619u);
+    }
+    // token of the messages without format (push), the text is the only argument
+    static constexpr uint32_t getTextToken() { return tokenize("%s"); }
+
+    // number of messages kept until the next loop (older messages are discarded)
+    static const int slotCount = 20;
+    // max. message length (longer messages are truncated)
+    static const int maxMessageLength = 95;
+    // max. number of modules (prefixes)
+    static const int maxModuleCount = 8;
+    // the prefix is padded to this width
+    static const int prefixWidth = 16;
+
+    /// @brief Selects the output, toMemory writes tokenized records to the trace log of the HAL
     void setup(Output ot, HAL *hal_ptr);
+    /// @brief Sets the lowest level which is output at runtime (default = debug)
+    void setLevel(Level level) { minLevel = level; }
+    /// @brief Checks the level and the output before a message is formatted
+    /// @return true if a message of this level would be output
+    bool isEnabled(Level level) const
+    {
+        return level >= compiledLevel && level >= minLevel && outputType != noOutput && currentStatus == ready;
+    }
     void loop();
-    void push(const std::string msg);
+    void push(const std::string &msg) { push(0, msg.c_str()); }
+    void push(const char *msg) { push(0, msg); }
+    /// @brief Copies the message into the next slot (no heap allocation), the message is logged as info
+    /// @param moduleId id of registerModule() (0 = no prefix)
+    /// @param msg message
+    void push(uint8_t moduleId, const char *msg);
+    /// @brief Formats the message directly into the next slot (printf format, truncated to maxMessageLength)
+    /// The level is not checked, use isEnabled() before the arguments are evaluated.
+    /// @param moduleId id of registerModule() (0 = no prefix)
+    /// @param format printf format string
+    void pushFormat(uint8_t moduleId, const char *format, ...) __attribute__((format(printf, 3, 4)));
+    /// @brief Copies a binary trace record (TraceRecordWriter) into the next slot
+    /// @param moduleId id of registerModule() (0 = no prefix)
+    /// @param record record including the length byte
+    /// @param length length of the record (max. maxMessageLength + 1)
+    void pushRecord(uint8_t moduleId, const uint8_t *record, size_t length);
+    /// @brief true if the messages are stored as binary trace records instead of text
+    bool isTokenized() const { return tokenizedBuild || outputType == toMemory; }
+    /// @brief Writes all records of the trace log to the serial port (binary)
+    /// @return number of records
+    size_t dumpTrace();
+    /// @brief Registers the prefix of a module
+    /// @param prefix string with static storage duration (the pointer is stored)
+    /// @return module id (0 = no prefix, all ids are in use)
+    uint8_t registerModule(const char *prefix);
+    /// @brief number of messages waiting for the output
+    int getMessageCount() const { return messageCount; }
 
 protected:
     StatusLogger() {}
@@ -43,7 +118,27 @@ private:
     };
     Status currentStatus = notReady;
     Output outputType = noOutput;
-    std::queue<std::string> msgQueue;
+    Level minLevel = Level::debug;
+
+    struct Slot
+    {
+        uint8_t moduleId;
+        // length of a binary record (0 = text message)
+        uint8_t recordLength;
+        char text[maxMessageLength + 1];
+    };
+    // ring of message slots
+    Slot slots[slotCount];
+    int firstSlot = 0;
+    int messageCount = 0;
+    // module prefixes (index = module id - 1)
+    const char *modulePrefixes[maxModuleCount] = {nullptr};
+    int moduleCount = 0;
+
+    // writes a record to the output
+    void writeRecord(const uint8_t *record, size_t length);
+    // returns the next free slot (the oldest message is discarded if all slots are in use)
+    Slot &nextSlot();
 };
 
 #endif // STATUSLOGGER_H
\ No newline at end of file
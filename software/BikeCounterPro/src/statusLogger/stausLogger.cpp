@@ -1,6 +1,16 @@
 #include "statusLogger.hpp"
+#include "traceRecord.hpp"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
 
 StatusLogger *StatusLogger::instance = nullptr;
+const int StatusLogger::slotCount;
+const int StatusLogger::maxMessageLength;
+const int StatusLogger::maxModuleCount;
+const int StatusLogger::prefixWidth;
+constexpr StatusLogger::Level StatusLogger::compiledLevel;
+constexpr bool StatusLogger::tokenizedBuild;
 // Thread-save Singleton (not needed for Arduino)
 // std::mutex LoRaConnector::mutex_;
 
@@ -33,8 +43,8 @@ void StatusLogger::setup(Output ot, HAL *hal_ptr)
         break;
 
     case toMemory:
-        // not implemented
-        currentStatus = ready;
+        // open the trace log in the flash
+        currentStatus = hal->traceLogBegin() ? ready : error;
         break;
 
     default:
@@ -46,38 +56,141 @@ void StatusLogger::setup(Output ot, HAL *hal_ptr)
 
 void StatusLogger::loop()
 {
-    while (!msgQueue.empty())
+    // prefix + message
+    char line[prefixWidth + maxMessageLength + 1];
+    while (messageCount > 0)
     {
-        std::string msg = msgQueue.front();
-        msgQueue.pop();
-        if (currentStatus == ready)
+        const Slot &slot = slots[firstSlot];
+        if (currentStatus == ready && outputType != noOutput)
         {
-            switch (outputType)
+            if (slot.recordLength > 0)
+            {
+                writeRecord((const uint8_t *)slot.text, slot.recordLength);
+            }
+            else if (isTokenized())
+            {
+                // text messages are stored as record of the text token
+                TraceRecordWriter record((uint8_t)Level::info, getTextToken());
+                record.add(slot.text);
+                writeRecord(record.getData(), record.getLength());
+            }
+            else if (slot.moduleId > 0)
+            {
+                snprintf(line, sizeof(line), "%-*s%s", prefixWidth, modulePrefixes[slot.moduleId - 1], slot.text);
+                hal->SerialPrintLn(line);
+            }
+            else
             {
-            case toSerial:
+                hal->SerialPrintLn(slot.text);
+            }
+        }
+        firstSlot = (firstSlot + 1) % slotCount;
+        --messageCount;
+    }
+}
 
-                hal->SerialPrintLn(msg);
-                break;
+void StatusLogger::writeRecord(const uint8_t *record, size_t length)
+{
+    switch (outputType)
+    {
+    case toSerial:
+        hal->SerialWrite(record, length);
+        break;
 
-            case toMemory:
-                // not implemented
-                break;
+    case toMemory:
+        // the length byte is stored by the trace log
+        hal->traceLogAppend(record + 1, length - 1);
+        break;
 
-            case noOutput:
-                // no action needed
-                break;
-            }
-        }
+    case noOutput:
+        // no action needed
+        break;
+    }
+}
+
+size_t StatusLogger::dumpTrace()
+{
+    if (!hal->traceLogBegin())
+    {
+        return 0;
     }
+    uint8_t record[maxMessageLength + 1];
+    size_t count = hal->traceLogSize();
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t length = hal->traceLogRead(i, record + 1, maxMessageLength);
+        record[0] = (uint8_t)length;
+        hal->SerialWrite(record, length + 1);
+    }
+    return count;
+}
+
+void StatusLogger::push(uint8_t moduleId, const char *msg)
+{
+    // messages without level are logged as info
+    if (!isEnabled(Level::info))
+    {
+        return;
+    }
+
+    Slot &slot = nextSlot();
+    slot.moduleId = moduleId;
+    slot.recordLength = 0;
+    strncpy(slot.text, msg, maxMessageLength);
+    slot.text[maxMessageLength] = '\0';
+}
+
+void StatusLogger::pushFormat(uint8_t moduleId, const char *format, ...)
+{
+    Slot &slot = nextSlot();
+    slot.moduleId = moduleId;
+    slot.recordLength = 0;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot.text, sizeof(slot.text), format, args);
+    va_end(args);
 }
 
-void StatusLogger::push(const std::string msg)
+void StatusLogger::pushRecord(uint8_t moduleId, const uint8_t *record, size_t length)
+{
+    if (length == 0 || length > sizeof(Slot::text))
+    {
+        return;
+    }
+
+    Slot &slot = nextSlot();
+    slot.moduleId = moduleId;
+    slot.recordLength = (uint8_t)length;
+    memcpy(slot.text, record, length);
+}
+
+StatusLogger::Slot &StatusLogger::nextSlot()
 {
-    msgQueue.push(msg);
-    
     // discard old messages if queue grows to fast
-    if (msgQueue.size() > 20)
+    if (messageCount == slotCount)
+    {
+        firstSlot = (firstSlot + 1) % slotCount;
+        --messageCount;
+    }
+
+    Slot &slot = slots[(firstSlot + messageCount) % slotCount];
+    ++messageCount;
+    return slot;
+}
+
+uint8_t StatusLogger::registerModule(const char *prefix)
+{
+    for (int i = 0; i < moduleCount; ++i)
+    {
+        if (strcmp(modulePrefixes[i], prefix) == 0)
+        {
+            return (uint8_t)(i + 1);
+        }
+    }
+    if (moduleCount == maxModuleCount)
     {
-        msgQueue.pop();
+        return 0;
     }
+    modulePrefixes[moduleCount++] = prefix;
+    return (uint8_t)moduleCount;
 }
\ No newline at end of file
@@ -0,0 +1,334 @@
+#ifndef TRACEDECODER_H
+#define TRACEDECODER_H
+
+// Host only: turns the binary trace records (traceRecord.hpp) back into text.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include "statusLogger.hpp"
+#include "traceRecord.hpp"
+
+class TraceDecoder
+{
+public:
+    TraceDecoder() { addFormat("%s"); }
+
+    /// @brief Adds a format string to the token table
+    void addFormat(const std::string &format) { table[StatusLogger::tokenize(format.c_str())] = format; }
+
+    /// @brief Adds the format strings of all LOG_ macros of a source file to the token table
+    /// @param source content of the source file
+    /// @return number of found format strings
+    size_t addSource(const std::string &source)
+    {
+        static const char *macros[] = {"LOG_DEBUG(", "LOG_INFO(", "LOG_WARNING(", "LOG_ERROR("};
+        size_t count = 0;
+        for (const char *macro : macros)
+        {
+            for (size_t pos = source.find(macro); pos != std::string::npos; pos = source.find(macro, pos + 1))
+            {
+                if (pos > 0 && source[pos - 1] == '"')
+                {
+                    // macro name in a string literal
+                    continue;
+                }
+                // the format is the first string literal after the logger argument
+                size_t comma = source.find(',', pos);
+                size_t quote = comma == std::string::npos ? comma : source.find_first_not_of(" \t\r\n", comma + 1);
+                if (quote == std::string::npos || source[quote] != '"')
+                {
+                    // macro definition or call without literal
+                    continue;
+                }
+                std::string format;
+                if (parseLiteral(source, quote, &format))
+                {
+                    addFormat(format);
+                    ++count;
+                }
+            }
+        }
+        return count;
+    }
+
+    /// @brief Reads a token table (one "<token in hex> <format>" per line, see writeTable)
+    void readTable(std::istream &in)
+    {
+        std::string line;
+        while (std::getline(in, line))
+        {
+            size_t space = line.find(' ');
+            if (space == std::string::npos)
+            {
+                continue;
+            }
+            table[(uint32_t)std::stoul(line.substr(0, space), nullptr, 16)] = unescape(line.substr(space + 1));
+        }
+    }
+
+    /// @brief Writes the token table (the formats are escaped to one line)
+    void writeTable(std::ostream &out) const
+    {
+        for (const auto &entry : table)
+        {
+            char token[9];
+            snprintf(token, sizeof(token), "%08x", entry.first);
+            out << token << ' ' << escape(entry.second) << '\n';
+        }
+    }
+
+    size_t getTableSize() const { return table.size(); }
+
+    /// @brief Decodes a record
+    /// @param record record without the length byte (level, token, arguments)
+    /// @param length length of the record
+    /// @param level decoded level
+    /// @return text of the message
+    std::string decode(const uint8_t *record, size_t length, StatusLogger::Level *level = nullptr) const
+    {
+        if (length < TraceRecordWriter::headerLength - 1)
+        {
+            return "<invalid record>";
+        }
+        if (level)
+        {
+            *level = static_cast<StatusLogger::Level>(record[0] & 0x03);
+        }
+        bool truncated = (record[0] & TraceRecordWriter::truncatedFlag) != 0;
+        uint32_t token = record[1] | ((uint32_t)record[2] << 8) | ((uint32_t)record[3] << 16) | ((uint32_t)record[4] << 24);
+        std::map<uint32_t, std::string>::const_iterator it = table.find(token);
+        if (it == table.end())
+        {
+            char unknown[32];
+            snprintf(unknown, sizeof(unknown), "<unknown token %08x>", token);
+            return unknown;
+        }
+
+        Reader reader{record + 5, record + length};
+        const std::string &format = it->second;
+        std::string text;
+        for (size_t i = 0; i < format.size(); ++i)
+        {
+            if (format[i] != '%')
+            {
+                text += format[i];
+                continue;
+            }
+            // conversion specification: %[flags][width][.precision][length]conversion
+            size_t end = format.find_first_of("diuxXocfFeEgGs%", i + 1);
+            if (end == std::string::npos)
+            {
+                text += format.substr(i);
+                break;
+            }
+            char conversion = format[end];
+            // the length modifiers are replaced with the widest type
+            std::string spec;
+            for (size_t j = i; j < end; ++j)
+            {
+                if (!strchr("hlLjzt", format[j]))
+                {
+                    spec += format[j];
+                }
+            }
+            i = end;
+            if (conversion == '%')
+            {
+                text += '%';
+                continue;
+            }
+
+            char buffer[128] = "";
+            bool ok = true;
+            if (strchr("diuxXoc", conversion))
+            {
+                // zigzag decoding
+                uint64_t zigzag = reader.varint(&ok);
+                int64_t v = (int64_t)((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+                if (conversion == 'd' || conversion == 'i')
+                {
+                    snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), (long long)v);
+                }
+                else if (conversion == 'c')
+                {
+                    snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), (int)v);
+                }
+                else
+                {
+                    snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), (unsigned long long)v);
+                }
+            }
+            else if (conversion == 's')
+            {
+                uint64_t n = reader.varint(&ok);
+                std::string s = reader.bytes((size_t)n, &ok);
+                snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), s.c_str());
+            }
+            else
+            {
+                snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), (double)reader.float32(&ok));
+            }
+            if (!ok)
+            {
+                text += "<truncated>";
+                return text;
+            }
+            text += buffer;
+        }
+        if (truncated)
+        {
+            text += "<truncated>";
+        }
+        return text;
+    }
+
+    static const char *getLevelName(StatusLogger::Level level)
+    {
+        static const char *names[] = {"debug", "info", "warning", "error"};
+        return names[static_cast<int>(level) & 0x03];
+    }
+
+private:
+    std::map<uint32_t, std::string> table;
+
+    struct Reader
+    {
+        const uint8_t *position;
+        const uint8_t *end;
+
+        uint64_t varint(bool *ok)
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (position >= end)
+                {
+                    *ok = false;
+                    return 0;
+                }
+                uint8_t b = *position++;
+                value |= (uint64_t)(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                {
+                    break;
+                }
+            }
+            return value;
+        }
+        float float32(bool *ok)
+        {
+            if (end - position < 4)
+            {
+                *ok = false;
+                return 0.0f;
+            }
+            uint32_t bits = position[0] | ((uint32_t)position[1] << 8) | ((uint32_t)position[2] << 16) | ((uint32_t)position[3] << 24);
+            position += 4;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        std::string bytes(size_t n, bool *ok)
+        {
+            if ((size_t)(end - position) < n)
+            {
+                *ok = false;
+                return std::string();
+            }
+            std::string s((const char *)position, n);
+            position += n;
+            return s;
+        }
+    };
+
+    // parses a C string literal starting at the quote (adjacent literals are concatenated)
+    static bool parseLiteral(const std::string &source, size_t quote, std::string *literal)
+    {
+        size_t i = quote;
+        while (i < source.size() && source[i] == '"')
+        {
+            for (++i; i < source.size() && source[i] != '"'; ++i)
+            {
+                if (source[i] == '\\' && i + 1 < source.size())
+                {
+                    ++i;
+                    switch (source[i])
+                    {
+                    case 'n':
+                        *literal += '\n';
+                        break;
+                    case 't':
+                        *literal += '\t';
+                        break;
+                    default:
+                        *literal += source[i];
+                        break;
+                    }
+                }
+                else
+                {
+                    *literal += source[i];
+                }
+            }
+            if (i >= source.size())
+            {
+                return false;
+            }
+            // skip the closing quote and the whitespace to the next literal
+            i = source.find_first_not_of(" \t\r\n", i + 1);
+            if (i == std::string::npos)
+            {
+                return true;
+            }
+        }
+        return true;
+    }
+
+    static std::string escape(const std::string &s)
+    {
+        std::string out;
+        for (char c : s)
+        {
+            switch (c)
+            {
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            default:
+                out += c;
+                break;
+            }
+        }
+        return out;
+    }
+
+    static std::string unescape(const std::string &s)
+    {
+        std::string out;
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            if (s[i] == '\\' && i + 1 < s.size())
+            {
+                ++i;
+                out += s[i] == 'n' ? '\n' : (s[i] == 't' ? '\t' : s[i]);
+            }
+            else
+            {
+                out += s[i];
+            }
+        }
+        return out;
+    }
+};
+
+#endif // TRACEDECODER_H
@@ -0,0 +1,136 @@
+#ifndef TRACERECORD_H
+#define TRACERECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/**
+ * @brief Binary trace record of a tokenized log message
+ * Layout: length byte (number of following bytes), level, token (4 bytes lsb first), arguments.
+ * The arguments are stored without type information, the detokenizer derives the types from the format string:
+ * integers as zigzag varint (signed and unsigned, the format may print a signed value as hex), floating point
+ * numbers as 4 byte float and strings as varint length followed by the characters.
+ * Arguments which do not fit into the record are dropped and the record is marked as truncated.
+ */
+class TraceRecordWriter
+{
+public:
+    // max. size of a record (including the length byte)
+    static const size_t maxLength = 96;
+    static const size_t headerLength = 6;
+    // level byte flag of a truncated record
+    static const uint8_t truncatedFlag = 0x80;
+
+    /**
+     * @brief Construct a new Trace Record Writer object
+     * @param level log level
+     * @param token id of the format string (see StatusLogger::tokenize)
+     */
+    TraceRecordWriter(uint8_t level, uint32_t token)
+    {
+        buffer[1] = level;
+        buffer[2] = (uint8_t)(token & 0xff);
+        buffer[3] = (uint8_t)((token >> 8) & 0xff);
+        buffer[4] = (uint8_t)((token >> 16) & 0xff);
+        buffer[5] = (uint8_t)(token >> 24);
+    }
+
+    /// @brief Appends all arguments
+    template <typename T, typename... Args>
+    void add(T value, Args... args)
+    {
+        addValue(value);
+        add(args...);
+    }
+    void add() {}
+
+    /// @brief record including the length byte
+    const uint8_t *getData()
+    {
+        buffer[0] = (uint8_t)(length - 1);
+        return buffer;
+    }
+    /// @brief size of the record including the length byte
+    size_t getLength() const { return length; }
+
+private:
+    uint8_t buffer[maxLength];
+    size_t length = headerLength;
+    bool full = false;
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value>::type addValue(T value)
+    {
+        // zigzag encoding, small negative numbers stay short
+        int64_t v = (int64_t)value;
+        addVarint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type addValue(T value)
+    {
+        float f = (float)value;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        uint8_t bytes[4] = {(uint8_t)(bits & 0xff), (uint8_t)((bits >> 8) & 0xff), (uint8_t)((bits >> 16) & 0xff), (uint8_t)(bits >> 24)};
+        addBytes(bytes, 4);
+    }
+    void addValue(const char *value)
+    {
+        size_t n = strlen(value);
+        // the string is shortened to the remaining space (the record is never longer than maxLength bytes, the varint needs 1 byte)
+        size_t available = maxLength - length;
+        if (!full && n + 1 > available && available > 1)
+        {
+            n = available - 1;
+            addVarint(n);
+            addBytes((const uint8_t *)value, n);
+            markTruncated();
+            return;
+        }
+        addVarint(n);
+        addBytes((const uint8_t *)value, n);
+    }
+
+    void addVarint(uint64_t value)
+    {
+        uint8_t bytes[10];
+        size_t n = 0;
+        do
+        {
+            bytes[n] = (uint8_t)(value & 0x7f);
+            value >>= 7;
+            if (value)
+            {
+                bytes[n] |= 0x80;
+            }
+            ++n;
+        } while (value);
+        addBytes(bytes, n);
+    }
+
+    void addBytes(const uint8_t *bytes, size_t n)
+    {
+        if (full)
+        {
+            return;
+        }
+        if (length + n > maxLength)
+        {
+            // all following arguments are dropped
+            markTruncated();
+            return;
+        }
+        memcpy(buffer + length, bytes, n);
+        length += n;
+    }
+
+    void markTruncated()
+    {
+        full = true;
+        buffer[1] |= truncatedFlag;
+    }
+};
+
+#endif // TRACERECORD_H
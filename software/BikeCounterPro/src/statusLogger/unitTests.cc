@@ -0,0 +1,297 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "extendedStatusLogger.hpp"
+#include "traceDecoder.hpp"
+#include "../HAL/sim_hal.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+class StatusLoggerTest : public ::testing::Test
+{
+protected:
+    SimHAL hal;
+    std::vector<std::string> lines;
+
+    void SetUp() override
+    {
+        hal.setSerialSink([this](const std::string &line)
+                          { lines.push_back(line); });
+        StatusLogger::getInstance()->setup(StatusLogger::Output::toSerial, &hal);
+        StatusLogger::getInstance()->setLevel(StatusLogger::Level::debug);
+    }
+};
+
+TEST_F(StatusLoggerTest, SerialOutputTests)
+{
+    StatusLogger *logger = StatusLogger::getInstance();
+    logger->push("first");
+    logger->push("second");
+    ASSERT_TRUE(lines.empty());
+
+    logger->loop();
+    ASSERT_EQ(lines.size(), 2u);
+    ASSERT_EQ(lines[0], "first");
+    ASSERT_EQ(lines[1], "second");
+
+    // queue is empty after the loop
+    logger->loop();
+    ASSERT_EQ(lines.size(), 2u);
+}
+
+TEST_F(StatusLoggerTest, QueueLimitTests)
+{
+    StatusLogger *logger = StatusLogger::getInstance();
+    for (int i = 0; i < 30; ++i)
+    {
+        logger->push(std::to_string(i));
+    }
+    logger->loop();
+
+    // old messages are discarded
+    ASSERT_EQ(lines.size(), 20u);
+    ASSERT_EQ(lines.front(), "10");
+    ASSERT_EQ(lines.back(), "29");
+}
+
+TEST_F(StatusLoggerTest, NoOutputTests)
+{
+    StatusLogger *logger = StatusLogger::getInstance();
+    logger->setup(StatusLogger::Output::noOutput, &hal);
+    logger->push("hidden");
+    logger->loop();
+    ASSERT_TRUE(lines.empty());
+}
+
+TEST_F(StatusLoggerTest, ExtendedStatusLoggerTests)
+{
+    ExtendedStatusLogger logger("Test:");
+    logger.push("message");
+    logger.push(std::string("string"));
+    logger.push(42);
+    logger.loop();
+
+    // the prefix is padded to 16 characters
+    ASSERT_EQ(lines.size(), 3u);
+    ASSERT_EQ(lines[0], "Test:           message");
+    ASSERT_EQ(lines[1], "Test:           string");
+    ASSERT_EQ(lines[2], "Test:           42");
+}
+
+TEST_F(StatusLoggerTest, TruncationTests)
+{
+    StatusLogger *logger = StatusLogger::getInstance();
+    std::string longMessage(200, 'x');
+    logger->push(longMessage);
+    logger->loop();
+
+    ASSERT_EQ(lines.size(), 1u);
+    ASSERT_EQ(lines[0], std::string(StatusLogger::maxMessageLength, 'x'));
+}
+
+TEST_F(StatusLoggerTest, ModuleTests)
+{
+    StatusLogger *logger = StatusLogger::getInstance();
+    // the same prefix gets the same id
+    uint8_t id = logger->registerModule("Module:");
+    ASSERT_GT(id, 0);
+    ASSERT_EQ(logger->registerModule("Module:"), id);
+
+    ExtendedStatusLogger a("Module:");
+    ExtendedStatusLogger b("Other:");
+    a.push("a");
+    b.push(1.5f);
+    b.push(-7);
+    logger->loop();
+    ASSERT_EQ(lines.size(), 3u);
+    ASSERT_EQ(lines[0], "Module:         a");
+    ASSERT_EQ(lines[1], "Other:          1.500000");
+    ASSERT_EQ(lines[2], "Other:          -7");
+}
+
+TEST_F(StatusLoggerTest, ZeroAllocationTests)
+{
+    // the serial sink of the SimHAL allocates the std::string of the line
+    hal.setSerialSink(nullptr);
+    ExtendedStatusLogger logger("Test:");
+    std::string preformatted = "preformatted message";
+
+    for (int output = StatusLogger::Output::noOutput; output <= StatusLogger::Output::toSerial; ++output)
+    {
+        StatusLogger::getInstance()->setup(static_cast<StatusLogger::Output>(output), &hal);
+        uint64_t allocations = allocCounter::allocations();
+        for (int i = 0; i < 100; ++i)
+        {
+            logger.push("Motion detected");
+            logger.push(preformatted);
+            logger.push(i);
+            logger.push(3.3f);
+            LOG_DEBUG(logger, "Motion detected (current count = %d / time: %d:%d:%d)", i, 7, 12, 59);
+            logger.loop();
+        }
+        ASSERT_EQ(allocCounter::allocations() - allocations, 0u);
+    }
+}
+
+TEST_F(StatusLoggerTest, FormatTests)
+{
+    ExtendedStatusLogger logger("Test:");
+    LOG_DEBUG(logger, "count = %d / epoch = %lu", 12, 1717200000ul);
+    LOG_INFO(logger, "%s", "info");
+    LOG_WARNING(logger, "voltage = %.2f V", 3.7);
+    LOG_ERROR(logger, "error %d", 4);
+    logger.loop();
+
+    ASSERT_EQ(lines.size(), 4u);
+    ASSERT_EQ(lines[0], "Test:           count = 12 / epoch = 1717200000");
+    ASSERT_EQ(lines[1], "Test:           info");
+    ASSERT_EQ(lines[2], "Test:           voltage = 3.70 V");
+    ASSERT_EQ(lines[3], "Test:           error 4");
+}
+
+TEST_F(StatusLoggerTest, LevelTests)
+{
+    StatusLogger *statusLogger = StatusLogger::getInstance();
+    ExtendedStatusLogger logger("Test:");
+
+    statusLogger->setLevel(StatusLogger::Level::warning);
+    ASSERT_FALSE(statusLogger->isEnabled(StatusLogger::Level::info));
+    ASSERT_TRUE(statusLogger->isEnabled(StatusLogger::Level::error));
+    LOG_DEBUG(logger, "debug %d", 1);
+    LOG_INFO(logger, "info %d", 2);
+    // messages without level are logged as info
+    logger.push("push");
+    logger.push(3);
+    LOG_WARNING(logger, "warning %d", 4);
+    ASSERT_EQ(statusLogger->getMessageCount(), 1);
+    logger.loop();
+    ASSERT_EQ(lines.size(), 1u);
+    ASSERT_EQ(lines[0], "Test:           warning 4");
+
+    // nothing is queued without output
+    statusLogger->setLevel(StatusLogger::Level::debug);
+    statusLogger->setup(StatusLogger::Output::noOutput, &hal);
+    ASSERT_FALSE(statusLogger->isEnabled(StatusLogger::Level::error));
+    LOG_ERROR(logger, "error %d", 5);
+    logger.push("push");
+    ASSERT_EQ(statusLogger->getMessageCount(), 0);
+}
+
+TEST_F(StatusLoggerTest, TokenTests)
+{
+    // FNV-1a reference values
+    static_assert(StatusLogger::tokenize("") == 2166136261u, "offset basis");
+    static_assert(StatusLogger::tokenize("a") == 0xe40c292cu, "hash of a");
+    ASSERT_EQ(LOG_TOKEN("count = %d"), StatusLogger::tokenize(std::string("count = %d").c_str()));
+    ASSERT_NE(LOG_TOKEN("count = %d"), LOG_TOKEN("count = %u"));
+}
+
+TEST_F(StatusLoggerTest, TokenizedMemoryTests)
+{
+    StatusLogger *statusLogger = StatusLogger::getInstance();
+    statusLogger->setup(StatusLogger::Output::toMemory, &hal);
+    ASSERT_TRUE(statusLogger->isTokenized());
+    ExtendedStatusLogger logger("Test:");
+
+    LOG_DEBUG(logger, "Motion detected (current count = %d / time: %d:%d:%d)", 12, 7, 5, 59);
+    LOG_INFO(logger, "epoch = %lu / drift = %ld", 1717200000ul, -42l);
+    LOG_WARNING(logger, "voltage = %.2f V / %s", 3.7, "low");
+    LOG_ERROR(logger, "%02X %c 100%%", 0xab, 'x');
+    logger.push("plain text");
+    logger.push(-7);
+    logger.loop();
+
+    // nothing is written as text
+    ASSERT_TRUE(lines.empty());
+    const std::deque<std::vector<uint8_t>> &trace = hal.getTraceLog();
+    ASSERT_EQ(trace.size(), 6u);
+    // token and raw arguments only
+    ASSERT_EQ(trace[0].size(), 9u);
+
+    TraceDecoder decoder;
+    decoder.addFormat("Motion detected (current count = %d / time: %d:%d:%d)");
+    decoder.addFormat("epoch = %lu / drift = %ld");
+    decoder.addFormat("voltage = %.2f V / %s");
+    decoder.addFormat("%02X %c 100%%");
+    StatusLogger::Level level;
+    ASSERT_EQ(decoder.decode(trace[0].data(), trace[0].size(), &level), "Motion detected (current count = 12 / time: 7:5:59)");
+    ASSERT_EQ(level, StatusLogger::Level::debug);
+    ASSERT_EQ(decoder.decode(trace[1].data(), trace[1].size(), &level), "epoch = 1717200000 / drift = -42");
+    ASSERT_EQ(level, StatusLogger::Level::info);
+    ASSERT_EQ(decoder.decode(trace[2].data(), trace[2].size(), &level), "voltage = 3.70 V / low");
+    ASSERT_EQ(level, StatusLogger::Level::warning);
+    ASSERT_EQ(decoder.decode(trace[3].data(), trace[3].size(), &level), "AB x 100%");
+    ASSERT_EQ(level, StatusLogger::Level::error);
+    // messages without format are stored as text
+    ASSERT_EQ(decoder.decode(trace[4].data(), trace[4].size()), "plain text");
+    ASSERT_EQ(decoder.decode(trace[5].data(), trace[5].size()), "-7");
+
+    // unknown formats are reported with the token
+    ASSERT_EQ(TraceDecoder().decode(trace[0].data(), trace[0].size()), "<unknown token 8571fc4b>");
+}
+
+TEST_F(StatusLoggerTest, TokenizedTruncationTests)
+{
+    StatusLogger::getInstance()->setup(StatusLogger::Output::toMemory, &hal);
+    ExtendedStatusLogger logger("Test:");
+    std::string longText(200, 'x');
+    LOG_INFO(logger, "%d %s %d", 1, longText.c_str(), 2);
+    logger.loop();
+
+    ASSERT_EQ(hal.getTraceLog().size(), 1u);
+    const std::vector<uint8_t> &record = hal.getTraceLog()[0];
+    ASSERT_EQ(record.size(), TraceRecordWriter::maxLength - 1);
+    TraceDecoder decoder;
+    decoder.addFormat("%d %s %d");
+    ASSERT_EQ(decoder.decode(record.data(), record.size()), "1 " + std::string(TraceRecordWriter::maxLength - 8, 'x') + " <truncated>");
+}
+
+TEST_F(StatusLoggerTest, DumpTests)
+{
+    StatusLogger *statusLogger = StatusLogger::getInstance();
+    statusLogger->setup(StatusLogger::Output::toMemory, &hal);
+    ExtendedStatusLogger logger("Test:");
+    for (int i = 0; i < 3; ++i)
+    {
+        LOG_INFO(logger, "count = %d", i);
+    }
+    logger.loop();
+
+    // the records are written with the length byte
+    std::vector<uint8_t> serial;
+    hal.setSerialDataSink([&serial](const uint8_t *data, size_t size)
+                          { serial.insert(serial.end(), data, data + size); });
+    statusLogger->setup(StatusLogger::Output::toSerial, &hal);
+    ASSERT_EQ(statusLogger->dumpTrace(), 3u);
+
+    TraceDecoder decoder;
+    decoder.addFormat("count = %d");
+    size_t position = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_LT(position, serial.size());
+        size_t length = serial[position];
+        ASSERT_EQ(decoder.decode(serial.data() + position + 1, length), "count = " + std::to_string(i));
+        position += length + 1;
+    }
+    ASSERT_EQ(position, serial.size());
+}
+
+TEST_F(StatusLoggerTest, SourceScanTests)
+{
+    TraceDecoder decoder;
+    std::string source = "#define LOG_INFO(logger, format, ...) (logger).log(...)\n"
+                         "LOG_INFO(logger, \"Module version: %s\", version);\n"
+                         "LOG_DEBUG(logger, \"quoted \\\"%d\\\" \"\n    \"concatenated\", 1);\n"
+                         "LOG_ERROR(logger, format);\n";
+    ASSERT_EQ(decoder.addSource(source), 2u);
+
+    // the table survives a write / read cycle
+    std::stringstream table;
+    decoder.writeTable(table);
+    TraceDecoder copy;
+    copy.readTable(table);
+    ASSERT_EQ(copy.getTableSize(), decoder.getTableSize());
+
+    TraceRecordWriter record((uint8_t)StatusLogger::Level::debug, StatusLogger::tokenize("quoted \"%d\" concatenated"));
+    record.add(5);
+    ASSERT_EQ(copy.decode(record.getData() + 1, record.getLength() - 1), "quoted \"5\" concatenated");
+}
@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+#include "timerSchedule.hpp"
+#include "timerScheduleReference.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+namespace
+{
+    typedef std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> EpochTime;
+    // 01.01.2024 00:00:00 (leap year)
+    const EpochTime yearStart{std::chrono::seconds{1704067200}};
+    const int minutesPerYear = 366 * 24 * 60;
+}
+
+// The benchmarks run with the lookup table implementation (TimerSchedule) and the former date.h implementation
+// (TimerScheduleReference) for comparison.
+
+// single call, the timestamp walks through the year in steps of 7 minutes (every hour and minute pattern)
+template <typename Schedule>
+static void BM_GetNextIntervalTime(benchmark::State &state)
+{
+    Schedule schedule;
+    int minute = 0;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(schedule.getNextIntervalTime(yearStart + std::chrono::minutes{minute}));
+        minute = (minute + 7) % minutesPerYear;
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_TEMPLATE(BM_GetNextIntervalTime, TimerSchedule);
+BENCHMARK_TEMPLATE(BM_GetNextIntervalTime, TimerScheduleReference);
+
+// interval length of a motion (called for every motion event), motions every 3 minutes
+template <typename Schedule>
+static void BM_GetCurrentIntervalSeconds(benchmark::State &state)
+{
+    Schedule schedule;
+    int minute = 0;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(schedule.getCurrentIntervalSeconds(yearStart + std::chrono::minutes{minute}));
+        minute = (minute + 3) % minutesPerYear;
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_TEMPLATE(BM_GetCurrentIntervalSeconds, TimerSchedule);
+BENCHMARK_TEMPLATE(BM_GetCurrentIntervalSeconds, TimerScheduleReference);
+
+// follows the schedule over a full year like the device does (one call per interval)
+template <typename Schedule>
+static void BM_GetNextIntervalTimeFullYear(benchmark::State &state)
+{
+    Schedule schedule;
+    const EpochTime yearEnd = yearStart + std::chrono::minutes{minutesPerYear};
+    int64_t calls = 0;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        EpochTime t = yearStart;
+        while (t < yearEnd)
+        {
+            t = schedule.getNextIntervalTime(t) + std::chrono::seconds{1};
+            ++calls;
+        }
+        benchmark::DoNotOptimize(t);
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+    state.counters["ns/call"] = benchmark::Counter((double)calls, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK_TEMPLATE(BM_GetNextIntervalTimeFullYear, TimerSchedule)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_GetNextIntervalTimeFullYear, TimerScheduleReference)->Unit(benchmark::kMillisecond);
+
+// computes the sunrise and sunset table of a location (runs once at setup)
+static void BM_SolarScheduleSetLocation(benchmark::State &state)
+{
+    SolarSchedule schedule;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        schedule.setLocation(47.37f, 8.54f);
+        benchmark::DoNotOptimize(schedule);
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SolarScheduleSetLocation)->Unit(benchmark::kMicrosecond);
+
+// follows the schedule of a location over a full year
+static void BM_GetNextIntervalTimeSolar(benchmark::State &state)
+{
+    SolarSchedule solar;
+    solar.setLocation(47.37f, 8.54f);
+    TimerSchedule schedule;
+    schedule.setSolarSchedule(&solar);
+    const EpochTime yearEnd = yearStart + std::chrono::minutes{minutesPerYear};
+    int64_t calls = 0;
+    for (auto _ : state)
+    {
+        EpochTime t = yearStart;
+        while (t < yearEnd)
+        {
+            t = schedule.getNextIntervalTime(t) + std::chrono::seconds{1};
+            ++calls;
+        }
+        benchmark::DoNotOptimize(t);
+    }
+    state.counters["ns/call"] = benchmark::Counter((double)calls, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.SetItemsProcessed(calls);
+}
+BENCHMARK(BM_GetNextIntervalTimeSolar)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,81 @@
+#include "solarSchedule.hpp"
+#include <math.h>
+
+namespace
+{
+    const float degToRad = 3.14159265f / 180.0f;
+
+    // minutes since UTC midnight rounded to a full hour (0 - 24)
+    uint8_t toHour(int minutes)
+    {
+        if (minutes <= 0)
+        {
+            return 0;
+        }
+        if (minutes >= 24 * 60)
+        {
+            return 24;
+        }
+        return (uint8_t)((minutes + 30) / 60);
+    }
+}
+
+void SolarSchedule::setLocation(float lat, float lon)
+{
+    latitude = lat;
+    longitude = lon;
+    for (int i = 0; i < dayCount; ++i)
+    {
+        // index 0 = 1st of March (day 59 of a common year)
+        int dayOfYear = i < 306 ? i + 59 : i - 306;
+        int sunrise = 0;
+        int sunset = 0;
+        switch (getSunTimes(lat, lon, dayOfYear, &sunrise, &sunset))
+        {
+        case polarNight:
+            dayStartHour[i] = 24;
+            nightStartHour[i] = 24;
+            break;
+
+        case midnightSun:
+            dayStartHour[i] = 0;
+            nightStartHour[i] = 24;
+            break;
+
+        default:
+            dayStartHour[i] = toHour(sunrise);
+            nightStartHour[i] = toHour(sunset);
+            break;
+        }
+    }
+    valid = true;
+}
+
+SolarSchedule::SunState SolarSchedule::getSunTimes(float lat, float lon, int dayOfYear, int *sunrise, int *sunset)
+{
+    // fractional year (radians)
+    float gamma = 2.0f * 3.14159265f / 365.0f * dayOfYear;
+    // equation of time (minutes) and declination of the sun (radians)
+    float eqTime = 229.18f * (0.000075f + 0.001868f * cosf(gamma) - 0.032077f * sinf(gamma) -
+                              0.014615f * cosf(2.0f * gamma) - 0.040849f * sinf(2.0f * gamma));
+    float decl = 0.006918f - 0.399912f * cosf(gamma) + 0.070257f * sinf(gamma) -
+                 0.006758f * cosf(2.0f * gamma) + 0.000907f * sinf(2.0f * gamma) -
+                 0.002697f * cosf(3.0f * gamma) + 0.00148f * sinf(3.0f * gamma);
+
+    // hour angle of the sunrise (zenith 90.833 deg incl. refraction and the radius of the sun)
+    float latRad = lat * degToRad;
+    float cosHa = cosf(90.833f * degToRad) / (cosf(latRad) * cosf(decl)) - tanf(latRad) * tanf(decl);
+    if (cosHa > 1.0f)
+    {
+        return polarNight;
+    }
+    if (cosHa < -1.0f)
+    {
+        return midnightSun;
+    }
+    float ha = acosf(cosHa) / degToRad;
+
+    *sunrise = (int)lroundf(720.0f - 4.0f * (lon + ha) - eqTime);
+    *sunset = (int)lroundf(720.0f - 4.0f * (lon - ha) - eqTime);
+    return normal;
+}
@@ -0,0 +1,60 @@
+#ifndef SOLARSCHEDULE_H
+#define SOLARSCHEDULE_H
+
+#include <stdint.h>
+
+/**
+ * @brief Day and night interval boundaries from the sunrise and sunset at a location
+ * The sunrise and sunset (NOAA solar position approximation) are precomputed for every day of the year
+ * and rounded to full UTC hours, so the TimerSchedule keeps its timer calls at xx:01.
+ * The schedule days are UTC days: a sunrise before or a sunset after UTC midnight is clamped to the day.
+ */
+class SolarSchedule
+{
+public:
+    // table index = days since the 1st of March (leap years have 366 days)
+    static const int dayCount = 366;
+
+    enum SunState
+    {
+        normal,
+        polarNight,
+        midnightSun
+    };
+
+    /**
+     * @brief Computes the table of the location (takes some ms, call at setup or when the location changes)
+     * @param latitude degrees north (-90 - 90)
+     * @param longitude degrees east (-180 - 180)
+     */
+    void setLocation(float latitude, float longitude);
+    /// @brief true if the table was computed
+    bool isValid() const { return valid; }
+    float getLatitude() const { return latitude; }
+    float getLongitude() const { return longitude; }
+
+    /// @brief UTC hour of the day interval start (24 = no day interval)
+    uint8_t getDayStartHour(uint32_t marchDay) const { return dayStartHour[marchDay % dayCount]; }
+    /// @brief UTC hour of the night interval start (24 = no night interval after the day)
+    uint8_t getNightStartHour(uint32_t marchDay) const { return nightStartHour[marchDay % dayCount]; }
+
+    /**
+     * @brief Sunrise and sunset of a day
+     * @param latitude degrees north
+     * @param longitude degrees east
+     * @param dayOfYear day of the year (0 = 1st of January)
+     * @param sunrise sunrise in minutes since UTC midnight (may be negative or > 1440 far from the prime meridian)
+     * @param sunset sunset in minutes since UTC midnight
+     * @return SunState polar night and midnight sun do not set sunrise and sunset
+     */
+    static SunState getSunTimes(float latitude, float longitude, int dayOfYear, int *sunrise, int *sunset);
+
+private:
+    bool valid = false;
+    float latitude = 0.0f;
+    float longitude = 0.0f;
+    uint8_t dayStartHour[dayCount];
+    uint8_t nightStartHour[dayCount];
+};
+
+#endif // SOLARSCHEDULE_H
@@ -1,52 +1,56 @@
 #include "timerSchedule.hpp"
 
-using namespace date;
 using namespace std::chrono;
 
+constexpr uint32_t TimerSchedule::timeSpanIntervals[intervalCount];
+constexpr uint8_t TimerSchedule::IntervalStartUTC[intervalCount][12];
+const uint64_t TimerSchedule::intervalTable[12] = {monthRow(0), monthRow(1), monthRow(2), monthRow(3), monthRow(4), monthRow(5),
+                                                   monthRow(6), monthRow(7), monthRow(8), monthRow(9), monthRow(10), monthRow(11)};
+
 time_point<system_clock, seconds> TimerSchedule::getNextIntervalTime(time_point<system_clock, seconds> currentDateTime)
 {
-    year_month_day cdt_ymd{floor<days>(currentDateTime)};
-    hh_mm_ss<seconds> cdt_hms = make_time(currentDateTime.time_since_epoch() - floor<days>(currentDateTime).time_since_epoch());
-    int cId = getIntervalId(cdt_hms.hours().count(), unsigned{cdt_ymd.month()});
-
-    time_point<system_clock, seconds> new_dt = currentDateTime + seconds{timeSpanIntervals[cId]};
+    // integer epoch arithmetic (valid until 2106)
+    uint32_t epoch = (uint32_t)currentDateTime.time_since_epoch().count();
+    uint32_t day = epoch / secondsPerDay;
+    uint32_t dayStart = day * secondsPerDay;
+    updateDay(day);
+    int cId = getIntervalId((epoch - dayStart) / 3600);
 
-    year_month_day new_dt_ymd{floor<days>(new_dt)};
-    hh_mm_ss<seconds> new_dt_hms = make_time(new_dt.time_since_epoch() - floor<days>(new_dt).time_since_epoch());
+    uint32_t next = epoch + timeSpanIntervals[cId];
 
     // Check if next call is inside same day
-    if ((floor<days>(new_dt) != floor<days>(currentDateTime)) && !isLastCall)
+    if ((next / secondsPerDay != day) && !isLastCall)
     {
-        new_dt = sys_days{cdt_ymd} + hours{23} + minutes{50};
+        next = dayStart + 23 * 3600 + 50 * 60;
         isLastCall = true;
     }
     else
     {
         if (isLastCall)
         {
-            new_dt = sys_days{cdt_ymd} + days{1} + minutes{1};
+            next = dayStart + secondsPerDay + 60;
         }
         else
         {
-            // Check if next call is inside same interval
+            // Check if next call is inside same interval (the next call is on the same day)
             // if not change the next call to the start of the new interval to sync the timing
-            int nId = getIntervalId(new_dt_hms.hours().count(), unsigned{new_dt_ymd.month()});
+            int nId = getIntervalId((next - dayStart) / 3600);
             if (nId != cId)
             {
-                new_dt = floor<days>(currentDateTime) + hours{IntervalStartUTC[nId][unsigned{new_dt_ymd.month()} - 1]} + minutes{1};
+                next = dayStart + cachedStartUTC[nId] * 3600 + 60;
             }
         }
         isLastCall = false;
     }
-    return new_dt;
+    return time_point<system_clock, seconds>{seconds{next}};
 };
 
 uint32_t TimerSchedule::getCurrentIntervalSeconds(time_point<system_clock, seconds> cDT)
 {
-    year_month_day cdt_ymd{floor<days>(cDT)};
-    hh_mm_ss<seconds> cdt_hms = make_time(cDT.time_since_epoch() - floor<days>(cDT).time_since_epoch());
-    int cId = getIntervalId(cdt_hms.hours().count(), unsigned{cdt_ymd.month()});
-    return timeSpanIntervals[cId];
+    uint32_t epoch = (uint32_t)cDT.time_since_epoch().count();
+    uint32_t day = epoch / secondsPerDay;
+    updateDay(day);
+    return timeSpanIntervals[getIntervalId((epoch - day * secondsPerDay) / 3600)];
 };
 
 uint32_t TimerSchedule::getCurrentIntervalMinutes(time_point<system_clock, seconds> cDT)
@@ -54,15 +58,50 @@ uint32_t TimerSchedule::getCurrentIntervalMinutes(time_point<system_clock, secon
     return (uint32_t)(TimerSchedule::getCurrentIntervalSeconds(cDT) / 60);
 };
 
-int TimerSchedule::getIntervalId(int currentHour, int currentMonth)
+uint32_t TimerSchedule::getMonth(uint32_t daysSinceEpoch)
+{
+    uint32_t mp = (5 * getMarchDay(daysSinceEpoch) + 2) / 153;
+    return mp < 10 ? mp + 3 : mp - 9;
+}
+
+uint32_t TimerSchedule::getMarchDay(uint32_t daysSinceEpoch)
+{
+    // civil_from_days (same algorithm as date.h), the year starts in March
+    uint32_t z = daysSinceEpoch + 719468;
+    // day of era [0, 146096]
+    uint32_t doe = z % 146097;
+    // year of era [0, 399]
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    // day of year [0, 365]
+    return doe - (365 * yoe + yoe / 4 - yoe / 100);
+}
+
+void TimerSchedule::setSolarSchedule(const SolarSchedule *schedule)
 {
-    int intervalId = 0;
-    for (int i = 0; i < intervalCount; ++i)
+    solarSchedule = (schedule != nullptr && schedule->isValid()) ? schedule : nullptr;
+    cachedDay = 0xffffffff;
+}
+
+void TimerSchedule::updateDay(uint32_t day)
+{
+    if (day == cachedDay)
+    {
+        return;
+    }
+    cachedDay = day;
+    if (solarSchedule == nullptr)
     {
-        if (currentHour >= IntervalStartUTC[i][currentMonth - 1])
+        cachedMonth = getMonth(day);
+        for (int i = 0; i < intervalCount; ++i)
         {
-            intervalId = i;
+            cachedStartUTC[i] = IntervalStartUTC[i][cachedMonth - 1];
         }
     }
-    return intervalId;
+    else
+    {
+        uint32_t marchDay = getMarchDay(day);
+        cachedStartUTC[0] = 0;
+        cachedStartUTC[1] = solarSchedule->getDayStartHour(marchDay);
+        cachedStartUTC[2] = solarSchedule->getNightStartHour(marchDay);
+    }
 }
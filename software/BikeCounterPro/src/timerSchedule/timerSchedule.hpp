@@ -4,6 +4,7 @@
 #include <chrono>
 #include <stdint.h>
 #include "date.h"
+#include "solarSchedule.hpp"
 
 class TimerSchedule
 {
@@ -12,16 +13,53 @@ public:
     uint32_t getCurrentIntervalSeconds(std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentDateTime);
     uint32_t getCurrentIntervalMinutes(std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> currentDateTime);
 
+    /// @brief Month (1 - 12) of a day since 1970-01-01 (integer version of date::year_month_day)
+    static uint32_t getMonth(uint32_t daysSinceEpoch);
+    /// @brief Day since the 1st of March (0 - 365) of a day since 1970-01-01 (index of the SolarSchedule)
+    static uint32_t getMarchDay(uint32_t daysSinceEpoch);
+
+    /// @brief Uses the day and night intervals of a location instead of the built in table (nullptr = built in table)
+    void setSolarSchedule(const SolarSchedule *schedule);
+
 private:
     static const int intervalCount = 3;
+    static const uint32_t secondsPerDay = 24 * 60 * 60;
     // TimeSpan timeSpanIntervals[intervalCount] = {TimeSpan(0, 6, 0, 0), TimeSpan(0, 2, 0, 0), TimeSpan(0, 6, 0, 0)}; // {dayInterval, nightInterval}
-    uint32_t timeSpanIntervals[intervalCount] = {uint32_t(6 * 60 * 60), uint32_t(2 * 60 * 60), uint32_t(6 * 60 * 60)}; // seconds
-    int IntervalStartUTC[intervalCount][12] = {
+    static constexpr uint32_t timeSpanIntervals[intervalCount] = {uint32_t(6 * 60 * 60), uint32_t(2 * 60 * 60), uint32_t(6 * 60 * 60)}; // seconds
+    static constexpr uint8_t IntervalStartUTC[intervalCount][12] = {
         {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
         {7, 6, 5, 5, 5, 5, 5, 5, 6, 6, 6, 7},              // ZRH (+1) { 8,  7,  6,  6,  6,  6,  6,  6,  7,  7,  7,  8} start day interval
         {16, 17, 19, 20, 21, 21, 21, 20, 19, 18, 16, 16}}; // ZRH (+1) {17, 18, 20, 21, 22, 22, 22, 21, 20, 19, 17, 17} start night interval
+
+    // interval id of an hour (last interval which started before or at the hour)
+    static constexpr uint64_t intervalIdOf(int month, int hour, int id = intervalCount - 1)
+    {
+        return id == 0 || hour >= IntervalStartUTC[id][month] ? id : intervalIdOf(month, hour, id - 1);
+    }
+    // interval ids of all hours of a month (2 bits per hour)
+    static constexpr uint64_t monthRow(int month, int hour = 0)
+    {
+        return hour == 24 ? 0 : (intervalIdOf(month, hour) << (2 * hour)) | monthRow(month, hour + 1);
+    }
+    // month x hour -> interval id (constant initialized from monthRow() in timerSchedule.cpp)
+    static const uint64_t intervalTable[12];
+
     bool isLastCall = false;
-    int getIntervalId(int currentHour, int currentMonth);
+    const SolarSchedule *solarSchedule = nullptr;
+    // the month and the interval starts are only calculated once per day
+    uint32_t cachedDay = 0xffffffff;
+    uint32_t cachedMonth = 1;
+    uint8_t cachedStartUTC[intervalCount] = {0, 0, 0};
+
+    void updateDay(uint32_t day);
+    int getIntervalId(uint32_t hour) const
+    {
+        if (solarSchedule == nullptr)
+        {
+            return (int)((intervalTable[cachedMonth - 1] >> (2 * hour)) & 0x3);
+        }
+        return hour >= cachedStartUTC[2] ? 2 : (hour >= cachedStartUTC[1] ? 1 : 0);
+    }
 };
 
-#endif // TIMERSCHEDULE_H
\ No newline at end of file
+#endif // TIMERSCHEDULE_H
@@ -0,0 +1,91 @@
+#ifndef TIMERSCHEDULEREFERENCE_H
+#define TIMERSCHEDULEREFERENCE_H
+
+// Host only: the date.h based implementation of the TimerSchedule before the lookup table.
+// Used as reference by the property test and the benchmark.
+
+#include <chrono>
+#include <stdint.h>
+#include "date.h"
+
+class TimerScheduleReference
+{
+public:
+    typedef std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds> EpochTime;
+
+    EpochTime getNextIntervalTime(EpochTime currentDateTime)
+    {
+        using namespace date;
+        using namespace std::chrono;
+
+        year_month_day cdt_ymd{floor<days>(currentDateTime)};
+        hh_mm_ss<seconds> cdt_hms = make_time(currentDateTime.time_since_epoch() - floor<days>(currentDateTime).time_since_epoch());
+        int cId = getIntervalId(cdt_hms.hours().count(), unsigned{cdt_ymd.month()});
+
+        EpochTime new_dt = currentDateTime + seconds{timeSpanIntervals[cId]};
+
+        year_month_day new_dt_ymd{floor<days>(new_dt)};
+        hh_mm_ss<seconds> new_dt_hms = make_time(new_dt.time_since_epoch() - floor<days>(new_dt).time_since_epoch());
+
+        // Check if next call is inside same day
+        if ((floor<days>(new_dt) != floor<days>(currentDateTime)) && !isLastCall)
+        {
+            new_dt = sys_days{cdt_ymd} + hours{23} + minutes{50};
+            isLastCall = true;
+        }
+        else
+        {
+            if (isLastCall)
+            {
+                new_dt = sys_days{cdt_ymd} + days{1} + minutes{1};
+            }
+            else
+            {
+                // Check if next call is inside same interval
+                // if not change the next call to the start of the new interval to sync the timing
+                int nId = getIntervalId(new_dt_hms.hours().count(), unsigned{new_dt_ymd.month()});
+                if (nId != cId)
+                {
+                    new_dt = floor<days>(currentDateTime) + hours{IntervalStartUTC[nId][unsigned{new_dt_ymd.month()} - 1]} + minutes{1};
+                }
+            }
+            isLastCall = false;
+        }
+        return new_dt;
+    }
+
+    uint32_t getCurrentIntervalSeconds(EpochTime cDT)
+    {
+        using namespace date;
+        using namespace std::chrono;
+
+        year_month_day cdt_ymd{floor<days>(cDT)};
+        hh_mm_ss<seconds> cdt_hms = make_time(cDT.time_since_epoch() - floor<days>(cDT).time_since_epoch());
+        int cId = getIntervalId(cdt_hms.hours().count(), unsigned{cdt_ymd.month()});
+        return timeSpanIntervals[cId];
+    }
+
+private:
+    static const int intervalCount = 3;
+    uint32_t timeSpanIntervals[intervalCount] = {uint32_t(6 * 60 * 60), uint32_t(2 * 60 * 60), uint32_t(6 * 60 * 60)}; // seconds
+    int IntervalStartUTC[intervalCount][12] = {
+        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+        {7, 6, 5, 5, 5, 5, 5, 5, 6, 6, 6, 7},
+        {16, 17, 19, 20, 21, 21, 21, 20, 19, 18, 16, 16}};
+    bool isLastCall = false;
+
+    int getIntervalId(int currentHour, int currentMonth)
+    {
+        int intervalId = 0;
+        for (int i = 0; i < intervalCount; ++i)
+        {
+            if (currentHour >= IntervalStartUTC[i][currentMonth - 1])
+            {
+                intervalId = i;
+            }
+        }
+        return intervalId;
+    }
+};
+
+#endif // TIMERSCHEDULEREFERENCE_H
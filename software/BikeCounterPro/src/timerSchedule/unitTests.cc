@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "timerSchedule.hpp"
+#include "timerScheduleReference.hpp"
 
 using namespace date;
 using namespace std::chrono;
@@ -106,4 +107,126 @@ TEST_F(TimerScheduleTest, CurrentIntervalTests)
     // 2h
     ASSERT_EQ(ts1.getCurrentIntervalSeconds(t2), 2 * 60 * 60);
     ASSERT_EQ(ts1.getCurrentIntervalMinutes(t2), 2 * 60);
-}
\ No newline at end of file
+}
+
+TEST_F(TimerScheduleTest, MonthTests)
+{
+    // every day from 1970 to 2105
+    for (uint32_t d = 0; d < 49673; ++d)
+    {
+        year_month_day ymd{sys_days{days{d}}};
+        ASSERT_EQ(TimerSchedule::getMonth(d), unsigned{ymd.month()}) << "day " << d;
+    }
+}
+
+TEST_F(TimerScheduleTest, ReferencePropertyTests)
+{
+    // every minute of a leap year and the following new year, the lookup table implementation follows the
+    // same sequence of calls (including the last call state) as the date.h implementation
+    TimerSchedule schedule;
+    TimerScheduleReference reference;
+    const time_point<system_clock, seconds> start = sys_days(year_month_day(year{2024}, month{1}, day{1}));
+    const time_point<system_clock, seconds> end = sys_days(year_month_day(year{2025}, month{1}, day{2}));
+    for (time_point<system_clock, seconds> t = start; t < end; t += minutes{1})
+    {
+        ASSERT_EQ(schedule.getCurrentIntervalSeconds(t), reference.getCurrentIntervalSeconds(t)) << t.time_since_epoch().count();
+        ASSERT_EQ(schedule.getNextIntervalTime(t).time_since_epoch().count(), reference.getNextIntervalTime(t).time_since_epoch().count()) << t.time_since_epoch().count();
+    }
+
+    // the device follows the schedule (next call = returned time)
+    for (time_point<system_clock, seconds> t = start, r = start; t < end;)
+    {
+        t = schedule.getNextIntervalTime(t);
+        r = reference.getNextIntervalTime(r);
+        ASSERT_EQ(t.time_since_epoch().count(), r.time_since_epoch().count());
+    }
+}
+
+TEST_F(TimerScheduleTest, SunTimesTests)
+{
+    int sunrise = 0;
+    int sunset = 0;
+
+    // Zurich (47.37 N, 8.54 E) 21.06. 03:29 - 19:26 UTC
+    ASSERT_EQ(SolarSchedule::getSunTimes(47.37f, 8.54f, 171, &sunrise, &sunset), SolarSchedule::normal);
+    EXPECT_NEAR(sunrise, 3 * 60 + 29, 5);
+    EXPECT_NEAR(sunset, 19 * 60 + 26, 5);
+
+    // Zurich 21.12. 07:12 - 15:38 UTC
+    ASSERT_EQ(SolarSchedule::getSunTimes(47.37f, 8.54f, 354, &sunrise, &sunset), SolarSchedule::normal);
+    EXPECT_NEAR(sunrise, 7 * 60 + 12, 5);
+    EXPECT_NEAR(sunset, 15 * 60 + 38, 5);
+
+    // Tromso (69.65 N, 18.96 E)
+    EXPECT_EQ(SolarSchedule::getSunTimes(69.65f, 18.96f, 354, &sunrise, &sunset), SolarSchedule::polarNight);
+    EXPECT_EQ(SolarSchedule::getSunTimes(69.65f, 18.96f, 171, &sunrise, &sunset), SolarSchedule::midnightSun);
+}
+
+TEST_F(TimerScheduleTest, SolarScheduleTests)
+{
+    SolarSchedule zurich;
+    ASSERT_FALSE(zurich.isValid());
+    zurich.setLocation(47.37f, 8.54f);
+    ASSERT_TRUE(zurich.isValid());
+
+    // 21.06. (day 112 since the 1st of March) and 21.12. (day 295)
+    uint32_t june = TimerSchedule::getMarchDay(sys_days(year_month_day(year{2024}, month{6}, day{21})).time_since_epoch().count());
+    uint32_t december = TimerSchedule::getMarchDay(sys_days(year_month_day(year{2024}, month{12}, day{21})).time_since_epoch().count());
+    ASSERT_EQ(june, 112u);
+    ASSERT_EQ(december, 295u);
+    EXPECT_EQ(zurich.getDayStartHour(june), 3);
+    EXPECT_EQ(zurich.getNightStartHour(june), 19);
+    EXPECT_EQ(zurich.getDayStartHour(december), 7);
+    EXPECT_EQ(zurich.getNightStartHour(december), 16);
+
+    SolarSchedule tromso;
+    tromso.setLocation(69.65f, 18.96f);
+    EXPECT_EQ(tromso.getDayStartHour(june), 0);
+    EXPECT_EQ(tromso.getNightStartHour(june), 24);
+    EXPECT_EQ(tromso.getDayStartHour(december), 24);
+    EXPECT_EQ(tromso.getNightStartHour(december), 24);
+
+    // New York (40.71 N, 74.01 W) 21.06. 09:25 - 00:31 UTC: the sunset after UTC midnight is clamped to the day
+    SolarSchedule newYork;
+    newYork.setLocation(40.71f, -74.01f);
+    EXPECT_EQ(newYork.getDayStartHour(june), 9);
+    EXPECT_EQ(newYork.getNightStartHour(june), 24);
+}
+
+TEST_F(TimerScheduleTest, SolarIntervalTests)
+{
+    SolarSchedule newYork;
+    newYork.setLocation(40.71f, -74.01f);
+    TimerSchedule schedule;
+    schedule.setSolarSchedule(&newYork);
+
+    // 21.12.2024 New York 12:17 - 21:32 UTC -> day interval 12 - 22 UTC
+    const time_point<system_clock, seconds> dec21 = sys_days(year_month_day(year{2024}, month{12}, day{21}));
+    ASSERT_EQ(schedule.getCurrentIntervalSeconds(dec21 + hours{11} + minutes{59}), 6 * 60 * 60);
+    ASSERT_EQ(schedule.getCurrentIntervalSeconds(dec21 + hours{12}), 2 * 60 * 60);
+    ASSERT_EQ(schedule.getCurrentIntervalSeconds(dec21 + hours{21} + minutes{59}), 2 * 60 * 60);
+    ASSERT_EQ(schedule.getCurrentIntervalSeconds(dec21 + hours{22}), 6 * 60 * 60);
+
+    // night interval resyncs to the start of the day interval, the day interval to the start of the night interval
+    ASSERT_EQ(schedule.getNextIntervalTime(dec21 + hours{6} + minutes{1}), dec21 + hours{12} + minutes{1});
+    ASSERT_EQ(schedule.getNextIntervalTime(dec21 + hours{12} + minutes{1}), dec21 + hours{14} + minutes{1});
+    ASSERT_EQ(schedule.getNextIntervalTime(dec21 + hours{20} + minutes{1}), dec21 + hours{22} + minutes{1});
+    ASSERT_EQ(schedule.getNextIntervalTime(dec21 + hours{22} + minutes{1}), dec21 + hours{23} + minutes{50});
+    ASSERT_EQ(schedule.getNextIntervalTime(dec21 + hours{23} + minutes{50}), dec21 + days{1} + minutes{1});
+
+    // the built in table is used again without a solar schedule (December: day interval 7 - 16 UTC)
+    schedule.setSolarSchedule(nullptr);
+    ASSERT_EQ(schedule.getNextIntervalTime(dec21 + hours{6} + minutes{1}), dec21 + hours{7} + minutes{1});
+
+    // midnight sun: 2h intervals all day
+    SolarSchedule tromso;
+    tromso.setLocation(69.65f, 18.96f);
+    schedule.setSolarSchedule(&tromso);
+    const time_point<system_clock, seconds> jun21 = sys_days(year_month_day(year{2024}, month{6}, day{21}));
+    ASSERT_EQ(schedule.getCurrentIntervalSeconds(jun21 + hours{1}), 2 * 60 * 60);
+    ASSERT_EQ(schedule.getNextIntervalTime(jun21 + minutes{1}), jun21 + hours{2} + minutes{1});
+
+    // polar night: 6h intervals all day
+    ASSERT_EQ(schedule.getCurrentIntervalSeconds(dec21 + hours{12}), 6 * 60 * 60);
+    ASSERT_EQ(schedule.getNextIntervalTime(dec21 + hours{12} + minutes{1}), dec21 + hours{18} + minutes{1});
+}
@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+#include "trafficController.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+// one motion per minute (counted in the hourly profile)
+static void BM_AddMotion(benchmark::State &state)
+{
+    TrafficController controller;
+    uint32_t epoch = 1717200000ul;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        controller.addMotion(epoch);
+        epoch += 60;
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_AddMotion);
+
+// next timer call of a learned profile
+static void BM_GetNextCallTime(benchmark::State &state)
+{
+    TrafficController controller;
+    const uint32_t dayStart = 1717200000ul;
+    for (uint32_t m = 0; m < 24ul * 60ul; m += 7)
+    {
+        controller.addMotion(dayStart + m * 60ul);
+    }
+    controller.update(dayStart + 86400ul);
+    uint32_t epoch = dayStart + 86400ul;
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(controller.getNextCallTime(epoch));
+        epoch = (epoch + 3600ul) % 86400ul + dayStart + 86400ul;
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GetNextCallTime);
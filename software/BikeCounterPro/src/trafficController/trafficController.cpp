@@ -0,0 +1,122 @@
+#include "trafficController.hpp"
+#include "../dataPackage/dataPackage.hpp"
+
+TrafficController::TrafficController()
+{
+    setPayloadSize(DataPackage::basePayloadSize);
+    reset();
+}
+
+void TrafficController::setPayloadSize(size_t size)
+{
+    DataPackage package;
+    package.setPayloadSize(size);
+    capacity[0] = 0;
+    for (int hours = 1; hours <= maxIntervalLimit; ++hours)
+    {
+        capacity[hours] = package.getMaxCount(hours * 60);
+    }
+}
+
+void TrafficController::setMaxIntervalHours(int hours)
+{
+    if (hours < 1)
+    {
+        hours = 1;
+    }
+    maxIntervalHours = hours > maxIntervalLimit ? maxIntervalLimit : hours;
+}
+
+void TrafficController::reset()
+{
+    for (int i = 0; i < hoursPerDay; ++i)
+    {
+        profile[i] = 0;
+    }
+    learnedHours = 0;
+    currentHour = 0;
+    currentCount = 0;
+    intervalMinutes = 60;
+}
+
+void TrafficController::addMotion(uint32_t epoch)
+{
+    update(epoch);
+    // motions before the counted hour (RTC correction) are added to it
+    ++currentCount;
+}
+
+void TrafficController::update(uint32_t epoch)
+{
+    uint32_t hour = epoch / 3600ul;
+    if (hour <= currentHour)
+    {
+        return;
+    }
+    if (currentHour != 0 && hour - currentHour <= maxGapHours)
+    {
+        learn((int)(currentHour % hoursPerDay), currentCount);
+        for (uint32_t h = currentHour + 1; h < hour; ++h)
+        {
+            learn((int)(h % hoursPerDay), 0);
+        }
+    }
+    currentHour = hour;
+    currentCount = 0;
+}
+
+void TrafficController::learn(int hour, uint32_t count)
+{
+    uint32_t value = count * profileScale;
+    if (value > 0xffff)
+    {
+        value = 0xffff;
+    }
+    if (learnedHours & (1ul << hour))
+    {
+        // profile += (value - profile) / 2^profileShift
+        int32_t delta = (int32_t)value - (int32_t)profile[hour];
+        profile[hour] = (uint16_t)((int32_t)profile[hour] + delta / (1 << profileShift));
+    }
+    else
+    {
+        profile[hour] = (uint16_t)value;
+        learnedHours |= 1ul << hour;
+    }
+}
+
+int TrafficController::getIntervalHours(int hour) const
+{
+    uint32_t expected = 0;
+    int hours = 1;
+    for (int n = 1; n <= maxIntervalHours && hour + n <= hoursPerDay; ++n)
+    {
+        expected += profile[hour + n - 1];
+        // 50% headroom for bursts, the floating pin detection must not trigger on a busy day
+        uint32_t bound = expected + expected / 2;
+        if (bound > (uint32_t)capacity[n] * profileScale || 2 * bound > (uint32_t)maxCount * profileScale)
+        {
+            break;
+        }
+        hours = n;
+    }
+    return hours;
+}
+
+uint32_t TrafficController::getNextCallTime(uint32_t epoch)
+{
+    uint32_t dayStart = epoch - epoch % secondsPerDay;
+    uint32_t lastCall = dayStart + 23ul * 3600ul + 50ul * 60ul;
+    if (epoch >= lastCall)
+    {
+        // first call of the next day
+        intervalMinutes = 60;
+        return dayStart + secondsPerDay + 60ul;
+    }
+    int hour = (int)((epoch - dayStart) / 3600ul);
+    int hours = getIntervalHours(hour);
+    intervalMinutes = (unsigned int)hours * 60u;
+    uint32_t next = dayStart + (uint32_t)(hour + hours) * 3600ul + 60ul;
+    // the packages do not span two days
+    return next > lastCall ? lastCall : next;
+}
@@ -0,0 +1,97 @@
+#ifndef TRAFFICCONTROLLER_H
+#define TRAFFICCONTROLLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Reporting interval from the traffic profile of the counter
+ * The controller learns the motions per UTC hour as an exponentially weighted moving average (one value per hour
+ * of the day) and picks the longest reporting interval whose expected motion count (plus headroom) fits into the
+ * package of the interval class and stays below the floating pin detection. A quiet trail sends a package every
+ * few hours, a busy one every hour instead of filling the package before the timer call.
+ * The timer calls are at xx:01 and the last call of the day at 23:50 like the TimerSchedule.
+ */
+class TrafficController
+{
+public:
+    // longest reporting interval in hours (the DataPackage supports up to 17h)
+    static const int maxIntervalLimit = 12;
+    // weight of a new hour in the profile = 1 / 2^profileShift
+    static const int profileShift = 2;
+    // fixed point scale of the profile (1/16 motions)
+    static const int profileScale = 16;
+
+    TrafficController();
+    /**
+     * @brief Bounds the reporting latency
+     * @param hours longest interval (1 - maxIntervalLimit, default 8)
+     */
+    void setMaxIntervalHours(int hours);
+    int getMaxIntervalHours() const { return maxIntervalHours; }
+    /**
+     * @brief Max. counts between timer calls of the floating pin detection (see BikeCounter::setMaxCount())
+     * @param count
+     */
+    void setMaxCount(int count) { maxCount = count; }
+    /**
+     * @brief Payload budget of the packages (see DataPackage::setPayloadSize()), the capacities grow with it
+     * @param size bytes
+     */
+    void setPayloadSize(size_t size);
+    /// @brief Forgets the learned profile
+    void reset();
+
+    /**
+     * @brief Counts a motion (in the order of their occurrence)
+     * @param epoch RTC time of the motion
+     */
+    void addMotion(uint32_t epoch);
+    /**
+     * @brief Adds the finished hours to the profile (hours without motions count as zero)
+     * @param epoch current RTC time
+     */
+    void update(uint32_t epoch);
+    /// @brief true if every hour of the day was observed at least once
+    bool isLearned() const { return learnedHours == allHours; }
+    /// @brief expected motions in the hour of the day (1/profileScale)
+    uint16_t getProfile(int hour) const { return profile[hour]; }
+
+    /**
+     * @brief Longest interval starting at the hour which fits into a package (ends at the latest with the day)
+     * @param hour UTC hour of the day
+     * @return int hours (1 - max. interval hours)
+     */
+    int getIntervalHours(int hour) const;
+    /**
+     * @brief Time of the next timer call (plans the interval returned by getIntervalMinutes())
+     * @param epoch current RTC time
+     * @return uint32_t epoch of the next call
+     */
+    uint32_t getNextCallTime(uint32_t epoch);
+    /// @brief Length of the planned interval in minutes (interval class of the package)
+    unsigned int getIntervalMinutes() const { return intervalMinutes; }
+
+private:
+    static const int hoursPerDay = 24;
+    static const uint32_t secondsPerDay = 24ul * 60ul * 60ul;
+    static const uint32_t allHours = (1ul << hoursPerDay) - 1;
+    // hours without an update longer than this are not learned (the device was off or the RTC jumped)
+    static const uint32_t maxGapHours = hoursPerDay;
+
+    // fixedBits package capacity of the interval (index = hours)
+    int capacity[maxIntervalLimit + 1];
+    int maxIntervalHours = 8;
+    int maxCount = 1000;
+    uint16_t profile[hoursPerDay];
+    // bit per hour of the day which was observed
+    uint32_t learnedHours = 0;
+    // hour since epoch which is counted
+    uint32_t currentHour = 0;
+    uint32_t currentCount = 0;
+    unsigned int intervalMinutes = 60;
+
+    void learn(int hour, uint32_t count);
+};
+
+#endif // TRAFFICCONTROLLER_H
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "trafficController.hpp"
+
+namespace
+{
+    // 01.06.2024 00:00:00
+    const uint32_t dayStart = 1717200000ul;
+
+    // one day with the given motions per hour (motions at xx:30)
+    void addDay(TrafficController &controller, uint32_t start, const int motionsPerHour[24])
+    {
+        controller.update(start);
+        for (uint32_t h = 0; h < 24; ++h)
+        {
+            for (int i = 0; i < motionsPerHour[h]; ++i)
+            {
+                controller.addMotion(start + h * 3600ul + 1800ul);
+            }
+        }
+        controller.update(start + 24ul * 3600ul);
+    }
+}
+
+TEST(TrafficControllerTests, LearnTests)
+{
+    TrafficController controller;
+    int traffic[24] = {0};
+    traffic[8] = 10;
+    traffic[17] = 20;
+
+    // the profile is complete after the first day (the update at the start of the next day closes hour 23)
+    addDay(controller, dayStart, traffic);
+    ASSERT_TRUE(controller.isLearned());
+    ASSERT_EQ(controller.getProfile(8), 10 * TrafficController::profileScale);
+    ASSERT_EQ(controller.getProfile(17), 20 * TrafficController::profileScale);
+    ASSERT_EQ(controller.getProfile(12), 0);
+
+    // a new day moves the profile by 1/4
+    traffic[8] = 30;
+    addDay(controller, dayStart + 86400ul, traffic);
+    ASSERT_EQ(controller.getProfile(8), 15 * TrafficController::profileScale);
+
+    // converges to a stable traffic
+    for (uint32_t d = 2; d < 40; ++d)
+    {
+        addDay(controller, dayStart + d * 86400ul, traffic);
+    }
+    ASSERT_NEAR(controller.getProfile(8), 30 * TrafficController::profileScale, TrafficController::profileScale);
+
+    // a device which was off for days does not learn the gap as zero traffic
+    controller.update(dayStart + 45ul * 86400ul + 8ul * 3600ul);
+    controller.update(dayStart + 45ul * 86400ul + 9ul * 3600ul);
+    ASSERT_NEAR(controller.getProfile(8), 30 * TrafficController::profileScale / 4 * 3, TrafficController::profileScale);
+    ASSERT_NEAR(controller.getProfile(7), 0, 1);
+
+    controller.reset();
+    ASSERT_FALSE(controller.isLearned());
+}
+
+TEST(TrafficControllerTests, IntervalTests)
+{
+    TrafficController controller;
+    int traffic[24] = {0};
+    for (int h = 7; h < 19; ++h)
+    {
+        traffic[h] = 6;
+    }
+    traffic[8] = 40;
+    traffic[17] = 30;
+    addDay(controller, dayStart, traffic);
+
+    // quiet night: latency bound (default 8h), the last interval ends with the day
+    ASSERT_EQ(controller.getIntervalHours(0), 8);
+    ASSERT_EQ(controller.getIntervalHours(19), 5);
+    controller.setMaxIntervalHours(4);
+    ASSERT_EQ(controller.getIntervalHours(0), 4);
+    controller.setMaxIntervalHours(8);
+
+    // rush hour: 1h intervals (40 + 50% does not fit into the 57 motions of a 1h package, the package is sent when full)
+    ASSERT_EQ(controller.getIntervalHours(8), 1);
+    ASSERT_EQ(controller.getIntervalHours(7), 1);
+    // 6 motions/h during the day: 4h (36 expected with headroom <= 43)
+    ASSERT_EQ(controller.getIntervalHours(9), 4);
+    ASSERT_EQ(controller.getIntervalHours(17), 1);
+
+    // the larger packages of DR4 - DR7 (222 bytes) hold the rush hour, only the latency bound is left
+    controller.setPayloadSize(222);
+    ASSERT_EQ(controller.getIntervalHours(8), 8);
+    ASSERT_EQ(controller.getIntervalHours(9), 8);
+    controller.setPayloadSize(51);
+    ASSERT_EQ(controller.getIntervalHours(9), 4);
+
+    // the floating pin detection bounds the interval of a busy counter
+    controller.setMaxCount(20);
+    ASSERT_EQ(controller.getIntervalHours(9), 1);
+}
+
+TEST(TrafficControllerTests, NextCallTests)
+{
+    TrafficController controller;
+    int traffic[24] = {0};
+    for (int h = 6; h < 20; ++h)
+    {
+        traffic[h] = 10;
+    }
+    addDay(controller, dayStart, traffic);
+    const uint32_t day = dayStart + 86400ul;
+
+    uint32_t t = day + 60ul;
+    uint32_t calls = 0;
+    while (t < day + 86400ul)
+    {
+        uint32_t next = controller.getNextCallTime(t);
+        ASSERT_GT(next, t);
+        ASSERT_LE((next - t) / 60ul, controller.getIntervalMinutes());
+        t = next;
+        ++calls;
+    }
+    // the last call of the day at 23:50, the next at 00:01
+    ASSERT_EQ(t, day + 86400ul + 60ul);
+    ASSERT_EQ(controller.getNextCallTime(day + 23ul * 3600ul + 1ul * 60ul), day + 23ul * 3600ul + 50ul * 60ul);
+
+    // fewer calls than the fixed schedule (12 - 13 calls per day)
+    ASSERT_LT(calls, 12u);
+}
@@ -0,0 +1,22 @@
+#include <benchmark/benchmark.h>
+#include "uplinkBacklog.hpp"
+#include "../HAL/alloc_counter.hpp"
+
+// enqueue a package and remove it again (one drained package)
+static void BM_PushPop(benchmark::State &state)
+{
+    UplinkBacklog backlog;
+    uint8_t payload[UplinkBacklog::maxPayloadSize] = {0};
+    uint32_t epoch = 1717200000ul;
+
+    uint64_t allocations = allocCounter::allocations();
+    for (auto _ : state)
+    {
+        backlog.push(payload, (size_t)state.range(0), 10);
+        benchmark::DoNotOptimize(backlog.getWaitTime(epoch));
+        backlog.pop();
+        epoch += 60;
+    }
+    state.counters["allocs/op"] = benchmark::Counter((double)(allocCounter::allocations() - allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_PushPop)->Arg(11)->Arg(51)->Arg(222);
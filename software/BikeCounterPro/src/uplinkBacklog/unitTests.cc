@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "uplinkBacklog.hpp"
+
+TEST(UplinkBacklogTests, QueueTests)
+{
+    UplinkBacklog backlog;
+    ASSERT_TRUE(backlog.isEmpty());
+    ASSERT_EQ(backlog.pop(), 1);
+
+    uint8_t payload[UplinkBacklog::maxPayloadSize] = {0};
+    for (int i = 0; i < UplinkBacklog::capacity; ++i)
+    {
+        payload[0] = (uint8_t)i;
+        ASSERT_EQ(backlog.push(payload, 10 + i, i), 0);
+    }
+    ASSERT_TRUE(backlog.isFull());
+    ASSERT_EQ(backlog.push(payload, 10, 1), 1);
+    ASSERT_EQ(backlog.getTotalEventCount(), 120u);
+
+    // oldest first (also after a wrap around)
+    ASSERT_EQ(backlog.pop(), 0);
+    ASSERT_EQ(backlog.push(payload, 8, 3), 0);
+    for (int i = 1; i < UplinkBacklog::capacity; ++i)
+    {
+        ASSERT_EQ(backlog.getPayload()[0], i);
+        ASSERT_EQ(backlog.getPayloadLength(), (size_t)(10 + i));
+        ASSERT_EQ(backlog.getEventCount(), (unsigned int)i);
+        ASSERT_EQ(backlog.pop(), 0);
+    }
+    ASSERT_EQ(backlog.getPayloadLength(), 8u);
+    ASSERT_EQ(backlog.getTotalEventCount(), 3u);
+    ASSERT_EQ(backlog.getSize(), 1);
+
+    // payloads larger than a LoRa package are rejected
+    ASSERT_EQ(backlog.push(payload, UplinkBacklog::maxPayloadSize + 1, 0), 1);
+}
+
+TEST(UplinkBacklogTests, WriteBufferTests)
+{
+    // the package is encoded in place and appended without a copy
+    UplinkBacklog backlog;
+    for (int i = 0; i < UplinkBacklog::capacity; ++i)
+    {
+        ByteSpan buffer = backlog.getWriteBuffer();
+        ASSERT_EQ(buffer.size(), (size_t)UplinkBacklog::maxPayloadSize);
+        buffer[0] = (uint8_t)(0x40 + i);
+        ASSERT_EQ(backlog.commit(5, 2), 0);
+    }
+    ASSERT_TRUE(backlog.getWriteBuffer().empty());
+    ASSERT_EQ(backlog.commit(5, 2), 1);
+    ASSERT_EQ(backlog.getPayload()[0], 0x40);
+    ASSERT_EQ(backlog.getPayloadLength(), 5u);
+    ASSERT_EQ(backlog.getTotalEventCount(), 32u);
+
+    ASSERT_EQ(backlog.pop(), 0);
+    ASSERT_EQ(backlog.commit(UplinkBacklog::maxPayloadSize + 1, 0), 1);
+}
+
+TEST(UplinkBacklogTests, RetryDelayTests)
+{
+    const uint32_t start = 1717200000ul;
+    UplinkBacklog backlog;
+    ASSERT_EQ(backlog.getWaitTime(start), 0u);
+
+    backlog.postpone(start, 60);
+    ASSERT_EQ(backlog.getWaitTime(start), 60u);
+    ASSERT_EQ(backlog.getWaitTime(start + 50), 10u);
+    ASSERT_EQ(backlog.getWaitTime(start + 60), 0u);
+
+    // a shorter delay does not shorten a pending one
+    backlog.postpone(start + 20, 3600);
+    backlog.postpone(start + 20, 60);
+    ASSERT_EQ(backlog.getWaitTime(start + 20), 3600u);
+
+    // a rtc correction to the past does not extend the wait time
+    ASSERT_EQ(backlog.getWaitTime(start - 86400ul), 3600u);
+
+    backlog.clear();
+    ASSERT_EQ(backlog.getWaitTime(start + 20), 0u);
+}
@@ -0,0 +1,81 @@
+#include "uplinkBacklog.hpp"
+#include <string.h>
+
+const int UplinkBacklog::capacity;
+const int UplinkBacklog::maxPayloadSize;
+
+int UplinkBacklog::push(const uint8_t *payload, size_t length, unsigned int eventCount)
+{
+    if (isFull() || length > maxPayloadSize)
+    {
+        return 1;
+    }
+    memcpy(packages[(head + size) % capacity].payload, payload, length);
+    return commit(length, eventCount);
+}
+
+ByteSpan UplinkBacklog::getWriteBuffer()
+{
+    if (isFull())
+    {
+        return ByteSpan();
+    }
+    return ByteSpan(packages[(head + size) % capacity].payload);
+}
+
+int UplinkBacklog::commit(size_t length, unsigned int eventCount)
+{
+    if (isFull() || length > maxPayloadSize)
+    {
+        return 1;
+    }
+    Package &package = packages[(head + size) % capacity];
+    package.length = (uint8_t)length;
+    package.eventCount = eventCount;
+    totalEventCount += eventCount;
+    ++size;
+    return 0;
+}
+
+int UplinkBacklog::pop()
+{
+    if (isEmpty())
+    {
+        return 1;
+    }
+    totalEventCount -= packages[head].eventCount;
+    head = (head + 1) % capacity;
+    --size;
+    return 0;
+}
+
+void UplinkBacklog::clear()
+{
+    head = 0;
+    size = 0;
+    totalEventCount = 0;
+    nextUplinkEpoch = 0;
+    waitSpan = 0;
+}
+
+void UplinkBacklog::postpone(uint32_t epoch, uint32_t seconds)
+{
+    uint32_t wait = getWaitTime(epoch);
+    if (seconds > wait)
+    {
+        wait = seconds;
+    }
+    nextUplinkEpoch = epoch + wait;
+    waitSpan = wait;
+}
+
+uint32_t UplinkBacklog::getWaitTime(uint32_t epoch) const
+{
+    if (epoch >= nextUplinkEpoch)
+    {
+        return 0;
+    }
+    uint32_t wait = nextUplinkEpoch - epoch;
+    // the rtc was set back
+    return wait > waitSpan ? waitSpan : wait;
+}
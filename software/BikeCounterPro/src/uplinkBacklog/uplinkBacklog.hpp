@@ -0,0 +1,94 @@
+#ifndef UPLINKBACKLOG_H
+#define UPLINKBACKLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../dataPackage/byteSpan.hpp"
+
+/**
+ * @brief Queue of encoded packages which are waiting for the transmission
+ * The packages are sent oldest first. A retry after a failed uplink is delayed with postpone(), the duty cycle
+ * of the sent uplinks is accounted by the AirtimeLedger.
+ */
+class UplinkBacklog
+{
+public:
+    // max. number of packages in the backlog
+    static const int capacity = 16;
+    // max. payload size of a package (EU868 DR4 - DR7)
+    static const int maxPayloadSize = 222;
+
+    /**
+     * @brief Appends a package
+     * @param payload encoded package
+     * @param length payload length (max. maxPayloadSize)
+     * @param eventCount number of events of the event log in the package
+     * @return int 0 = ok, 1 = backlog full or invalid length
+     */
+    int push(const uint8_t *payload, size_t length, unsigned int eventCount);
+    /**
+     * @brief Buffer of the next package (the payload is encoded in place and appended with commit())
+     * @return ByteSpan maxPayloadSize bytes, empty if the backlog is full
+     */
+    ByteSpan getWriteBuffer();
+    /**
+     * @brief Appends the package in the buffer of getWriteBuffer()
+     * @param length payload length (max. maxPayloadSize)
+     * @param eventCount number of events of the event log in the package
+     * @return int 0 = ok, 1 = backlog full or invalid length
+     */
+    int commit(size_t length, unsigned int eventCount);
+    /**
+     * @brief Removes the oldest package
+     * @return int 0 = ok, 1 = backlog empty
+     */
+    int pop();
+    /**
+     * @brief Removes all packages
+     */
+    void clear();
+
+    /// @brief payload of the oldest package
+    const uint8_t *getPayload() const { return packages[head].payload; }
+    /// @brief payload of the oldest package (e.g. to update the status before it is sent)
+    uint8_t *getPayload() { return packages[head].payload; }
+    /// @brief payload length of the oldest package
+    size_t getPayloadLength() const { return packages[head].length; }
+    /// @brief number of events of the event log in the oldest package
+    unsigned int getEventCount() const { return packages[head].eventCount; }
+    /// @brief number of events of the event log in all packages
+    unsigned int getTotalEventCount() const { return totalEventCount; }
+    int getSize() const { return size; }
+    bool isEmpty() const { return size == 0; }
+    bool isFull() const { return size == capacity; }
+
+    /**
+     * @brief Delays the next uplink (e.g. after a failed join)
+     * @param epoch current time (RTC)
+     * @param seconds delay
+     */
+    void postpone(uint32_t epoch, uint32_t seconds);
+    /**
+     * @brief Time until the next uplink is allowed (retry delay)
+     * @param epoch current time (RTC)
+     * @return uint32_t seconds (0 = the next uplink can be sent now)
+     */
+    uint32_t getWaitTime(uint32_t epoch) const;
+
+private:
+    struct Package
+    {
+        uint8_t payload[maxPayloadSize];
+        uint8_t length;
+        unsigned int eventCount;
+    };
+    Package packages[capacity];
+    int head = 0;
+    int size = 0;
+    unsigned int totalEventCount = 0;
+    // earliest time of the next uplink and the time span to it (guards against rtc corrections)
+    uint32_t nextUplinkEpoch = 0;
+    uint32_t waitSpan = 0;
+};
+
+#endif // UPLINKBACKLOG_H
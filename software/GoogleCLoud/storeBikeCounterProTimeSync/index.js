@@ -54,7 +54,10 @@ exports.storeBikecounterData = (req, res) => {
     const airtime = payload.uplink_message.consumed_airtime;
 
     // check the time deviation and post the sync downlink if necessary
-    processTimeSync(req, timeDrift);
+    // (a delayed package was sent from the backlog, its device time is not the time of the transmission)
+    if (!devicePayload.delayed) {
+      processTimeSync(req, timeDrift);
+    }
 
     switch (app_id) {
       case "bikecounter":
@@ -139,7 +142,9 @@ exports.storeBikecounterData = (req, res) => {
 
 function processTimeSync(req, timeDrift) {
   // send downlink package with timeDrift information
-  if (Math.abs(timeDrift) > 15 * 60) {
+  // (the device corrects its RTC above 10 min, smaller deviations refine its drift estimate; the device time
+  // has a resolution of one minute)
+  if (Math.abs(timeDrift) > 2 * 60) {
     // create package data
     const data = JSON.stringify({
       downlinks: [
@@ -17,6 +17,11 @@ function decodeUplink(input) {
   data.swVersion = input.bytes[1] & 0x0f;
   data.hwVersion = input.bytes[1] >> 4;
   data.statId = input.bytes[2] & 0x07;
+  // bit 2 marks a package which was sent from the backlog after an outage (7 is the sync call)
+  data.delayed = data.statId !== 7 && (data.statId & 0x04) !== 0;
+  if (data.delayed) {
+    data.statId &= 0x03;
+  }
   data.stat = statusCode[data.statId];
   // battery level
   let batteryIndex = input.bytes[2] >> 3;
@@ -55,7 +60,13 @@ function decodeUplink(input) {
     4: 17,
   };
   var intervalBitSize = [6, 7, 8, 9, 10];
-  data.selectedInterval = "< " + intervalTime[data.intervalId] + "h";
+  if (data.intervalId === 5) {
+    data.selectedInterval = "delta (rice)";
+  } else if (data.intervalId === 6) {
+    data.selectedInterval = "histogram";
+  } else {
+    data.selectedInterval = "< " + intervalTime[data.intervalId] + "h";
+  }
   // start hour of day
   data.hourOfDay = input.bytes[4] >> 3;
   if (data.swVersion > 0) {
@@ -68,7 +79,8 @@ function decodeUplink(input) {
     //calculate time drift in seconds
     var today = new Date();
     var serverEpoch = (today.getTime() / 1000) >> 0; // seconds since 1 Jan 1970
-    data.timeDrift = serverEpoch - data.deviceTime;
+    // the device time of a delayed package is the time of its timer call, not of the transmission
+    data.timeDrift = data.delayed ? 0 : serverEpoch - data.deviceTime;
   } else {
     data.timeDrift = 0;
   }
@@ -80,14 +92,72 @@ function decodeUplink(input) {
   } else {
     offsetBits = 5 * 8;
   }
-  var buffer = new ArrayBuffer(data.count);
-  var absMinArray = new Int8Array(buffer);
+  var absMinArray = [];
   for (var j = 0; j < data.count; j++) {
-    absMinArray[j] = 0;
+    absMinArray.push(0);
+  }
+
+  // reads bitCount bits (lsb first) starting at bitPos
+  function readBits(bitPos, bitCount) {
+    var value = 0;
+    for (var i = 0; i < bitCount; i++) {
+      var bit = bitPos + i;
+      if ((input.bytes[Math.floor(bit / 8)] >> bit % 8) & 0x01) {
+        value |= 1 << i;
+      }
+    }
+    return value;
+  }
+
+  if (data.intervalId === 5) {
+    // sorted minutes as Rice coded gaps:
+    // 3 bits Rice parameter k, per motion the quotient as unary code (ones terminated by a zero)
+    // followed by k bits. 16 ones (no terminating zero) escape a gap which is stored with 11 bits.
+    var bitPos = offsetBits;
+    var k = readBits(bitPos, 3);
+    bitPos += 3;
+    var minute = 0;
+    for (var m = 0; m < data.count; m++) {
+      var quotient = 0;
+      while (quotient < 16 && readBits(bitPos, 1) === 1) {
+        quotient++;
+        bitPos++;
+      }
+      if (quotient < 16) {
+        bitPos++; // terminating zero
+        minute += quotient * (1 << k) + readBits(bitPos, k);
+        bitPos += k;
+      } else {
+        minute += readBits(bitPos, 11);
+        bitPos += 11;
+      }
+      absMinArray[m] = minute;
+    }
+  }
+
+  if (data.intervalId === 6) {
+    // motion count per bin: 2 bits bin width (5, 10, 15 or 30 min), 9 bits bin count,
+    // 4 bits bit count per bin, followed by the bins. Every motion gets the start time of its bin.
+    var binMinutes = [5, 10, 15, 30][readBits(offsetBits, 2)];
+    var binCount = readBits(offsetBits + 2, 9);
+    var binBits = readBits(offsetBits + 11, 4);
+    absMinArray = [];
+    data.histogram = [];
+    for (var n = 0; n < binCount; n++) {
+      var binValue = readBits(offsetBits + 15 + n * binBits, binBits);
+      data.histogram.push(binValue);
+      for (var c = 0; c < binValue; c++) {
+        absMinArray.push(n * binMinutes);
+      }
+    }
+    data.binMinutes = binMinutes;
+    // the count byte is limited to 255
+    data.count = absMinArray.length;
   }
 
   for (
     var payloadBit = offsetBits;
+    data.intervalId < 5 &&
     payloadBit < data.count * intervalBitSize[data.intervalId] + offsetBits;
     payloadBit++
   ) {
@@ -116,10 +186,13 @@ function decodeUplink(input) {
     minArray.push(absMinArray[k] % 60);
   }
   // create output time array
-  var ts = new Date(Date.now());
-  // correct the date if it is the first call of the day
-  if (ts.getUTCHours === 0) {
-    ts.setUTCHours(ts.getUTCHours() - 1);
+  // the events of a delayed package are dated from the device time
+  var ts = data.delayed
+    ? new Date(data.deviceTime * 1000)
+    : new Date(Date.now());
+  // correct the date if it is the first call of the day (the package started on the previous day)
+  if (ts.getUTCHours() < data.hourOfDay) {
+    ts.setUTCDate(ts.getUTCDate() - 1);
   }
   ts.setUTCHours(0);
   ts.setUTCMinutes(0);
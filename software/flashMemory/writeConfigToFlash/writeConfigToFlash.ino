@@ -59,6 +59,14 @@ void setup()
     flash.writeBlock(0, &wBufferSize, 1);
     // write eui and key to flash
     flash.writeBlock(1, (uint8_t *)wBuffer, wBufferSize);
+#ifdef SECRET_LOCATION
+    // location record at 0x800 (same format: size byte followed by the string)
+    Serial.println("Writing location to flash");
+    strcpy(wBuffer, SECRET_LOCATION);
+    wBufferSize = (uint8_t)strlen(wBuffer) + 1;
+    flash.writeBlock(0x800, &wBufferSize, 1);
+    flash.writeBlock(0x801, (uint8_t *)wBuffer, wBufferSize);
+#endif
 
     //
     Serial.println("Read config from flash");